@@ -5,12 +5,21 @@ layout (location = 1) in vec2 aTexCoord;
 
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Affine model matrix as its top three rows, see affine.h
+uniform mat3x4 model;
+
+// Shared by all programs, see frame_uniforms.h
+layout (std140) uniform PerFrame
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	float time;
+};
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = viewProjection * vec4(vec4(aPos, 1.0) * model, 1.0);
 	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
 }
\ No newline at end of file
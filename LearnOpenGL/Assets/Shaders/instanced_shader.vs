@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+// Affine model matrix as its top three rows, see affine.h
+layout (location = 4) in mat3x4 aModel;
+
+out vec2 TexCoord;
+
+// Shared by all programs, see frame_uniforms.h
+layout (std140) uniform PerFrame
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	float time;
+};
+
+void main()
+{
+	gl_Position = viewProjection * vec4(vec4(aPos, 1.0) * aModel, 1.0);
+	TexCoord = aTexCoord;
+}
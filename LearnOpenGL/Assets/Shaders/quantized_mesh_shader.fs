@@ -0,0 +1,17 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoord;
+in vec3 Normal;
+
+// texture samplers
+uniform sampler2D texture1;
+uniform sampler2D texture2;
+
+void main()
+{
+	// Simple directional light so the decoded normals are visible
+	float diffuse = max(dot(normalize(Normal), normalize(vec3(0.4, 0.8, 0.6))), 0.0);
+	vec4 color = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2);
+	FragColor = vec4(color.rgb * (0.3 + 0.7 * diffuse), 1.0);
+}
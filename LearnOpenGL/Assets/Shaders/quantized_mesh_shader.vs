@@ -0,0 +1,42 @@
+#version 330 core
+layout (location = 0) in vec4 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec2 aNormal;
+
+out vec2 TexCoord;
+out vec3 Normal;
+
+// Affine model matrix as its top three rows, see affine.h
+uniform mat3x4 model;
+
+// Shared by all programs, see frame_uniforms.h
+layout (std140) uniform PerFrame
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	float time;
+};
+
+// Dequantization: object space position = positionOffset + aPos.xyz * positionScale
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+// Octahedral normal decode, matches OctahedralDecode in vertex_quantization.h
+vec3 octDecode(vec2 p)
+{
+	vec3 n = vec3(p.xy, 1.0 - abs(p.x) - abs(p.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+void main()
+{
+	vec3 position = positionOffset + aPos.xyz * positionScale;
+	gl_Position = viewProjection * vec4(vec4(position, 1.0) * model, 1.0);
+	TexCoord = aTexCoord;
+	Normal = vec4(octDecode(aNormal), 0.0) * model;
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "affine.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace BenchmarkAffine {
+
+	// Settings
+	const unsigned int OBJECT_COUNT = 1000000;
+	const unsigned int RUNS = 10;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void report(const char* label, double milliseconds)
+	{
+		std::cout << label << milliseconds << " ms, " << OBJECT_COUNT / milliseconds / 1000.0 << " M/s" << std::endl;
+	}
+
+	// Largest difference between affine results and the top three rows of the mat4 results
+	float maxError(const std::vector<glm::mat4>& expected, const std::vector<Affine>& result)
+	{
+		float error = 0.0f;
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+			for (int row = 0; row < 3; row++)
+				for (int column = 0; column < 4; column++)
+					error = glm::max(error, glm::abs(result[i].Rows[row][column] - expected[i][column][row]));
+		return error;
+	}
+
+	void check(const char* label, const std::vector<glm::mat4>& expected, const std::vector<Affine>& result)
+	{
+		float error = maxError(expected, result);
+		if (error > 1e-3f)
+			std::cout << "ERROR::AFFINE::RESULT_MISMATCH: " << label << " differs by " << error << std::endl;
+	}
+
+	// Multiplies and inverts a million random transforms as glm::mat4 and as Affine.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		// Rigid transforms (rotation + translation) and the same with a non-uniform scale
+		std::vector<glm::mat4> rigid(OBJECT_COUNT), scaled(OBJECT_COUNT);
+		std::vector<Affine> rigidAffine(OBJECT_COUNT), scaledAffine(OBJECT_COUNT);
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+			rigid[i] = glm::rotate(glm::translate(glm::mat4(), glm::vec3(position(random), position(random), position(random))), unit(random) * 3.0f, axis);
+			scaled[i] = glm::scale(rigid[i], glm::vec3(scale(random), scale(random), scale(random)));
+			rigidAffine[i] = Affine(rigid[i]);
+			scaledAffine[i] = Affine(scaled[i]);
+		}
+		std::cout << OBJECT_COUNT << " transforms, " << sizeof(glm::mat4) << " bytes as mat4, " << sizeof(Affine) << " bytes as Affine" << std::endl;
+
+		std::vector<glm::mat4> expected(OBJECT_COUNT);
+		std::vector<Affine> result(OBJECT_COUNT);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				expected[i] = rigid[i] * scaled[OBJECT_COUNT - 1 - i];
+		report("Multiply, mat4:        ", elapsedMilliseconds(start) / RUNS);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				result[i] = rigidAffine[i] * scaledAffine[OBJECT_COUNT - 1 - i];
+		report("Multiply, Affine:      ", elapsedMilliseconds(start) / RUNS);
+		check("multiply", expected, result);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				expected[i] = glm::inverse(scaled[i]);
+		report("Inverse, mat4:         ", elapsedMilliseconds(start) / RUNS);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				result[i] = InverseAffine(scaledAffine[i]);
+		report("Inverse, Affine:       ", elapsedMilliseconds(start) / RUNS);
+		check("inverse", expected, result);
+
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+			expected[i] = glm::inverse(rigid[i]);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				result[i] = InverseRigid(rigidAffine[i]);
+		report("Inverse, rigid Affine: ", elapsedMilliseconds(start) / RUNS);
+		check("rigid inverse", expected, result);
+
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkAffine", BenchmarkAffine::main);
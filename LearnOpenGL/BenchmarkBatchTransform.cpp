@@ -0,0 +1,127 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "batch_transform.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace BenchmarkBatchTransform {
+
+	// Settings
+	const unsigned int OBJECT_COUNT = 1000000;
+	const unsigned int RUNS = 20;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void report(const char* label, double milliseconds)
+	{
+		std::cout << label << milliseconds << " ms, " << OBJECT_COUNT / milliseconds / 1000.0 << " M matrices/s" << std::endl;
+	}
+
+	// Largest difference between the batch output and the glm matrices, for either layout
+	float maxError(const std::vector<glm::mat4>& expected, const std::vector<float>& out, Transform_Layout layout)
+	{
+		float error = 0.0f;
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			for (int column = 0; column < 4; column++) {
+				for (int row = 0; row < 4; row++) {
+					float value;
+					if (layout == TRANSFORM_LAYOUT_MAT4)
+						value = out[i * 16 + column * 4 + row];
+					else if (row < 3)
+						value = out[i * 12 + row * 4 + column];
+					else
+						continue;
+					error = glm::max(error, glm::abs(value - expected[i][column][row]));
+				}
+			}
+		}
+		return error;
+	}
+
+	void check(const char* label, const std::vector<glm::mat4>& expected, const std::vector<float>& out, Transform_Layout layout)
+	{
+		float error = maxError(expected, out, layout);
+		if (error > 1e-4f)
+			std::cout << "ERROR::BATCH_TRANSFORM::RESULT_MISMATCH: " << label << " differs by " << error << std::endl;
+	}
+
+	// Builds a million model matrices with the glm::translate / glm::rotate / glm::scale chain
+	// used by the samples and with the batch kernel, in both layouts and on all hardware threads.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> angle(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+		std::vector<glm::vec3> positions(OBJECT_COUNT), axes(OBJECT_COUNT), scales(OBJECT_COUNT);
+		std::vector<float> angles(OBJECT_COUNT);
+		TransformBatch axisAngles(TRANSFORM_ROTATION_AXIS_ANGLE);
+		TransformBatch quaternions(TRANSFORM_ROTATION_QUATERNION);
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			positions[i] = glm::vec3(position(random), position(random), position(random));
+			axes[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+			angles[i] = angle(random);
+			scales[i] = glm::vec3(scale(random), scale(random), scale(random));
+			axisAngles.Add(positions[i], axes[i], angles[i], scales[i]);
+			quaternions.Add(positions[i], glm::angleAxis(angles[i], axes[i]), scales[i]);
+		}
+		std::cout << "Building " << OBJECT_COUNT << " matrices, " << TRANSFORM_BATCH << " per SIMD batch, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+		std::vector<glm::mat4> expected(OBJECT_COUNT);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+				glm::mat4 model;
+				model = glm::translate(model, positions[i]);
+				model = glm::rotate(model, angles[i], axes[i]);
+				model = glm::scale(model, scales[i]);
+				expected[i] = model;
+			}
+		}
+		report("glm chain:              ", elapsedMilliseconds(start) / RUNS);
+
+		std::vector<float> out(OBJECT_COUNT * 16);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			BuildTransforms(axisAngles, &out[0], TRANSFORM_LAYOUT_MAT4);
+		report("Axis-angle, mat4:       ", elapsedMilliseconds(start) / RUNS);
+		check("axis-angle mat4", expected, out, TRANSFORM_LAYOUT_MAT4);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			BuildTransforms(quaternions, &out[0], TRANSFORM_LAYOUT_MAT4);
+		report("Quaternion, mat4:       ", elapsedMilliseconds(start) / RUNS);
+		check("quaternion mat4", expected, out, TRANSFORM_LAYOUT_MAT4);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			BuildTransforms(axisAngles, &out[0], TRANSFORM_LAYOUT_MAT3X4);
+		report("Axis-angle, mat3x4:     ", elapsedMilliseconds(start) / RUNS);
+		check("axis-angle mat3x4", expected, out, TRANSFORM_LAYOUT_MAT3X4);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			BuildTransformsParallel(axisAngles, &out[0], TRANSFORM_LAYOUT_MAT4);
+		report("Axis-angle, mat4, all threads:   ", elapsedMilliseconds(start) / RUNS);
+		check("parallel axis-angle mat4", expected, out, TRANSFORM_LAYOUT_MAT4);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			BuildTransformsParallel(axisAngles, &out[0], TRANSFORM_LAYOUT_MAT3X4);
+		report("Axis-angle, mat3x4, all threads: ", elapsedMilliseconds(start) / RUNS);
+		check("parallel axis-angle mat3x4", expected, out, TRANSFORM_LAYOUT_MAT3X4);
+
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkBatchTransform", BenchmarkBatchTransform::main);
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include "bvh.h"
+#include "camera.h"
+#include "culling.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace BenchmarkBvh {
+
+	// Settings
+	const unsigned int OBJECT_COUNT = 1000000;
+	const float WORLD_SIZE = 500.0f;
+	const unsigned int RAY_COUNT = 10000;
+	const unsigned int RUNS = 10;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Closest hit by testing every box, to check Bvh::Raycast (which multiplies by the inverse
+	// direction instead, so distances may differ in the last bits)
+	bool raycastLinear(const std::vector<glm::vec3>& boxMin, const std::vector<glm::vec3>& boxMax, glm::vec3 origin, glm::vec3 direction, float maxDistance, BvhHit& hit)
+	{
+		bool found = false;
+		hit.Distance = maxDistance;
+		for (unsigned int i = 0; i < boxMin.size(); i++) {
+			glm::vec3 t1 = (boxMin[i] - origin) / direction;
+			glm::vec3 t2 = (boxMax[i] - origin) / direction;
+			float entry = glm::max(glm::max(glm::min(t1.x, t2.x), glm::min(t1.y, t2.y)), glm::max(glm::min(t1.z, t2.z), 0.0f));
+			float exit = glm::min(glm::min(glm::max(t1.x, t2.x), glm::max(t1.y, t2.y)), glm::min(glm::max(t1.z, t2.z), hit.Distance));
+			if (entry <= exit && (!found || entry < hit.Distance)) {
+				hit.Object = i;
+				hit.Distance = entry;
+				found = true;
+			}
+		}
+		return found;
+	}
+
+	// Builds a BVH over a million randomly placed unit cubes and compares frustum queries with
+	// the linear batch culler and ray picks with testing every box. Runs on the CPU only.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-WORLD_SIZE, WORLD_SIZE);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> scale(0.5f, 3.0f);
+
+		// World boxes of rotated, scaled unit cubes
+		std::vector<glm::vec3> boxMin(OBJECT_COUNT), boxMax(OBJECT_COUNT);
+		BoundingBoxes boxes;
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(), glm::vec3(position(random), position(random) * 0.1f, position(random)));
+			model = glm::rotate(model, glm::radians(angle(random)), glm::vec3(1.0f, 0.3f, 0.5f));
+			model = glm::scale(model, glm::vec3(scale(random)));
+			TransformBounds(glm::vec3(-0.5f), glm::vec3(0.5f), model, boxMin[i], boxMax[i]);
+			boxes.Add(boxMin[i], boxMax[i]);
+		}
+
+		// Build
+		Bvh bvh;
+		unsigned int maxThreads = glm::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			bvh.Build(&boxMin[0], &boxMax[0], OBJECT_COUNT, threads);
+			std::cout << "Build, " << threads << " thread(s): " << elapsedMilliseconds(start) << " ms, " << bvh.Nodes.size() << " nodes" << std::endl;
+		}
+
+		// Frustum queries
+		Camera camera(glm::vec3(0.0f, 5.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 200.0f);
+		Frustum frustum = camera.GetFrustum(projection);
+
+		std::vector<unsigned int> linearVisible, bvhVisible;
+		unsigned int linearCount = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			linearCount = CullBoxes(frustum, boxes, linearVisible);
+		double linearMilliseconds = elapsedMilliseconds(start) / RUNS;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			bvh.CullFrustum(frustum, bvhVisible);
+		double bvhMilliseconds = elapsedMilliseconds(start) / RUNS;
+
+		linearVisible.resize(linearCount);
+		std::sort(linearVisible.begin(), linearVisible.end());
+		std::sort(bvhVisible.begin(), bvhVisible.end());
+		if (linearVisible != bvhVisible)
+			std::cout << "ERROR::BVH::FRUSTUM_MISMATCH: " << bvhVisible.size() << " != " << linearCount << std::endl;
+		std::cout << "Frustum, linear SIMD: " << linearMilliseconds << " ms, BVH: " << bvhMilliseconds << " ms, " << bvhVisible.size() << " visible" << std::endl;
+
+		// Ray picks from the camera in random directions
+		std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+		std::vector<glm::vec3> directions(RAY_COUNT);
+		for (unsigned int i = 0; i < RAY_COUNT; i++)
+			directions[i] = glm::normalize(glm::vec3(direction(random), direction(random) * 0.05f, direction(random)));
+
+		unsigned int hits = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < RAY_COUNT; i++) {
+			BvhHit hit;
+			hits += bvh.Raycast(camera.Position, directions[i], 1000.0f, hit) ? 1 : 0;
+		}
+		double rayMilliseconds = elapsedMilliseconds(start);
+		std::cout << "Raycast: " << RAY_COUNT / rayMilliseconds << " rays/ms, " << hits << " hits" << std::endl;
+
+		// What the camera looks at
+		BvhHit picked;
+		if (bvh.Raycast(camera.Position, camera.Front, 1000.0f, picked))
+			std::cout << "Picked object " << picked.Object << " at distance " << picked.Distance << std::endl;
+
+		for (unsigned int i = 0; i < 10; i++) {
+			BvhHit expected, hit;
+			bool expectedFound = raycastLinear(boxMin, boxMax, camera.Position, directions[i], 1000.0f, expected);
+			bool found = bvh.Raycast(camera.Position, directions[i], 1000.0f, hit);
+			if (expectedFound != found || (found && expected.Object != hit.Object))
+				std::cout << "ERROR::BVH::RAYCAST_MISMATCH: ray " << i << std::endl;
+		}
+
+		// Move everything a little and refit
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			glm::vec3 offset(direction(random), 0.0f, direction(random));
+			boxMin[i] += offset;
+			boxMax[i] += offset;
+			boxes.Set(i, boxMin[i], boxMax[i]);
+		}
+		start = std::chrono::high_resolution_clock::now();
+		bvh.Refit(&boxMin[0], &boxMax[0]);
+		std::cout << "Refit: " << elapsedMilliseconds(start) << " ms" << std::endl;
+
+		linearCount = CullBoxes(frustum, boxes, linearVisible);
+		bvh.CullFrustum(frustum, bvhVisible);
+		if (linearCount != bvhVisible.size())
+			std::cout << "ERROR::BVH::REFIT_MISMATCH: " << bvhVisible.size() << " != " << linearCount << std::endl;
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkBvh", BenchmarkBvh::main);
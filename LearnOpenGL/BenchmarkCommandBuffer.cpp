@@ -0,0 +1,112 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "command_buffer.h"
+#include "scene_runner.h"
+
+namespace BenchmarkCommandBuffer {
+
+	// Settings
+	const unsigned int MAX_THREADS = 64;
+	const unsigned int BUFFERS_PER_THREAD = 4;
+	const unsigned int OBJECT_COUNT = 1000000;
+	const unsigned int PROGRAM_COUNT = 4;
+	const unsigned int RUNS = 10;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Replays into a checksum instead of GL, to show the parallel recording produced the same
+	// uniforms and draws in the same order. Each buffer starts with its own state commands, so
+	// those are only counted.
+	struct ChecksumBackend
+	{
+		unsigned long long Checksum;
+		unsigned int Commands;
+		unsigned int StateCommands;
+
+		ChecksumBackend() : Checksum(0), Commands(0), StateCommands(0) {}
+
+		void add(unsigned long long value) { Checksum = Checksum * 1099511628211ull + value; Commands++; }
+		void UseProgram(GLuint) { StateCommands++; }
+		void BindVertexArray(GLuint) { StateCommands++; }
+		void BindTexture(GLuint, GLuint) { StateCommands++; }
+		void SetInt(GLint location, const int* value) { add(location + *value); }
+		void SetFloat(GLint location, const float* value) { add(location + (unsigned long long) *value); }
+		void SetVec4(GLint location, const float* value) { add(location + (unsigned long long) value[0]); }
+		void SetMat3x4(GLint location, const float* value) { add(location + (unsigned long long) value[3]); }
+		void SetMat4(GLint location, const float* value) { add(location + (unsigned long long) value[12]); }
+		void DrawArrays(const CommandDrawArrays& draw) { add(draw.First + draw.Count); }
+		void DrawElements(const CommandDrawElements& draw) { add(draw.FirstIndex + draw.Count); }
+	};
+
+	// Records a program switch every so often and a model matrix and an indexed draw for each of
+	// a million objects, on job systems of 1, 2, 4, ... threads up to the hardware threads or
+	// MAX_THREADS, then replays the buffers in order.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::vector<glm::vec3> positions(OBJECT_COUNT);
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+			positions[i] = glm::vec3(position(random), position(random), position(random));
+
+		auto record = [&](CommandBuffer& commands, size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				if (i == first || i % 4096 == 0) {
+					commands.UseProgram((GLuint)(i / 4096 % PROGRAM_COUNT + 1));
+					commands.BindVertexArray(1);
+				}
+				glm::mat4 model;
+				model[3] = glm::vec4(positions[i], 1.0f);
+				commands.SetMat4(0, model);
+				commands.DrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (GLuint)(i % 64) * 36);
+			}
+		};
+
+		unsigned int maxThreads = glm::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREADS);
+		std::cout << "Recording " << OBJECT_COUNT << " objects on 1 to " << maxThreads << " threads" << std::endl;
+
+		double baseline = 0.0;
+		unsigned long long expectedChecksum = 0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			JobSystem jobs(threads);
+			std::vector<CommandBuffer> buffers(threads * BUFFERS_PER_THREAD);
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int run = 0; run < RUNS; run++)
+				RecordCommandsParallel(buffers, OBJECT_COUNT, record, jobs);
+			double milliseconds = elapsedMilliseconds(start) / RUNS;
+			if (threads == 1)
+				baseline = milliseconds;
+
+			size_t bytes = 0;
+			unsigned int commandCount = 0;
+			for (size_t b = 0; b < buffers.size(); b++) {
+				bytes += buffers[b].GetSize();
+				commandCount += buffers[b].GetCommandCount();
+			}
+
+			ChecksumBackend backend;
+			start = std::chrono::high_resolution_clock::now();
+			ReplayCommands(buffers, backend);
+			double replayMilliseconds = elapsedMilliseconds(start);
+
+			std::cout << threads << " threads: recorded in " << milliseconds << " ms (" << commandCount / milliseconds / 1000.0 << " M commands/s, "
+				<< baseline / milliseconds << "x), " << (double) bytes / commandCount << " bytes per command, replayed in " << replayMilliseconds << " ms" << std::endl;
+
+			if (backend.Commands + backend.StateCommands != commandCount)
+				std::cout << "ERROR::COMMAND_BUFFER::REPLAY_COUNT: " << backend.Commands + backend.StateCommands << " of " << commandCount << " replayed" << std::endl;
+			if (threads == 1)
+				expectedChecksum = backend.Checksum;
+			else if (backend.Checksum != expectedChecksum)
+				std::cout << "ERROR::COMMAND_BUFFER::ORDER_MISMATCH: " << threads << " threads" << std::endl;
+		}
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkCommandBuffer", BenchmarkCommandBuffer::main);
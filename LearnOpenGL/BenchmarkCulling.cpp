@@ -0,0 +1,91 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "camera.h"
+#include "culling.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace BenchmarkCulling {
+
+	// Settings
+	const unsigned int OBJECT_COUNT = 1000000;
+	const float WORLD_SIZE = 200.0f;
+	const unsigned int RUNS = 20;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void report(const char* label, double milliseconds, unsigned int visible)
+	{
+		std::cout << label << milliseconds << " ms, " << OBJECT_COUNT / milliseconds << " objects/ms, " << visible << " visible" << std::endl;
+	}
+
+	// Culls a million random spheres and boxes with the batch culler and with a plain loop over
+	// IsSphereInFrustum / IsBoxInFrustum. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-WORLD_SIZE, WORLD_SIZE);
+		std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+		std::vector<glm::vec3> centers(OBJECT_COUNT);
+		std::vector<float> radii(OBJECT_COUNT);
+		BoundingSpheres spheres;
+		BoundingBoxes boxes;
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			centers[i] = glm::vec3(position(random), position(random), position(random));
+			radii[i] = size(random);
+			spheres.Add(centers[i], radii[i]);
+			boxes.Add(centers[i] - glm::vec3(radii[i]), centers[i] + glm::vec3(radii[i]));
+		}
+
+		Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+		Frustum frustum = camera.GetFrustum(projection);
+		std::cout << "Culling " << OBJECT_COUNT << " objects, " << CULLING_BATCH << " per SIMD batch" << std::endl;
+
+		std::vector<unsigned int> visible;
+		unsigned int count = 0;
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			visible.clear();
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				if (IsSphereInFrustum(frustum, centers[i], radii[i]))
+					visible.push_back(i);
+		}
+		report("Spheres, scalar: ", elapsedMilliseconds(start) / RUNS, (unsigned int) visible.size());
+		unsigned int scalarSpheres = (unsigned int) visible.size();
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			count = CullSpheres(frustum, spheres, visible);
+		report("Spheres, SIMD:   ", elapsedMilliseconds(start) / RUNS, count);
+		if (count != scalarSpheres)
+			std::cout << "ERROR::CULLING::RESULT_MISMATCH: spheres" << std::endl;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			visible.clear();
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				if (IsBoxInFrustum(frustum, centers[i] - glm::vec3(radii[i]), centers[i] + glm::vec3(radii[i])))
+					visible.push_back(i);
+		}
+		report("Boxes, scalar:   ", elapsedMilliseconds(start) / RUNS, (unsigned int) visible.size());
+		unsigned int scalarBoxes = (unsigned int) visible.size();
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++)
+			count = CullBoxes(frustum, boxes, visible);
+		report("Boxes, SIMD:     ", elapsedMilliseconds(start) / RUNS, count);
+		if (count != scalarBoxes)
+			std::cout << "ERROR::CULLING::RESULT_MISMATCH: boxes" << std::endl;
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkCulling", BenchmarkCulling::main);
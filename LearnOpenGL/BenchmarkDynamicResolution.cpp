@@ -0,0 +1,63 @@
+#include <iostream>
+#include <random>
+#include "dynamic_resolution.h"
+#include "scene_runner.h"
+
+namespace BenchmarkDynamicResolution {
+
+	// Settings
+	const unsigned int FRAMES = 1800;
+	const unsigned int QUERY_LATENCY = 3;	// Frames until a GPU time is read back
+	const double FIXED_MILLISECONDS = 2.0;	// GPU time that doesn't depend on the resolution
+	const double FULL_RESOLUTION_MILLISECONDS = 12.0;	// The rest, at scale 1
+	const double NOISE = 0.08;	// Relative frame to frame jitter
+
+	// A scene that costs twice as much between frames 600 and 1200, e.g. the camera turning
+	// towards a crowd
+	double sceneLoad(unsigned int frame)
+	{
+		return frame >= 600 && frame < 1200 ? 2.0 : 1.0;
+	}
+
+	void simulate(const char* label, const DynamicResolutionSettings& settings)
+	{
+		std::mt19937 random(42);
+		std::normal_distribution<double> jitter(1.0, NOISE);
+		DynamicResolutionController controller;
+		controller.Reset(settings);
+
+		std::vector<double> measured(FRAMES);
+		unsigned int overBudget = 0;
+		double scaleSum = 0.0;
+		for (unsigned int frame = 0; frame < FRAMES; frame++) {
+			float scale = controller.GetScale();
+			measured[frame] = (FIXED_MILLISECONDS + FULL_RESOLUTION_MILLISECONDS * sceneLoad(frame) * scale * scale) * jitter(random);
+			overBudget += measured[frame] > settings.TargetMilliseconds;
+			scaleSum += scale;
+			if (frame >= QUERY_LATENCY)
+				controller.Update(measured[frame - QUERY_LATENCY]);
+		}
+		std::cout << label << controller.GetChanges() << " scale changes, " << overBudget << " of " << FRAMES << " frames over "
+			<< settings.TargetMilliseconds << " ms, mean scale " << scaleSum / FRAMES << std::endl;
+	}
+
+	// Feeds the controller the GPU times of a simulated scene whose cost grows with the pixel
+	// count, with jitter, a load spike and results arriving QUERY_LATENCY frames late, with the
+	// default settings and with the hysteresis and cooldown switched off.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		DynamicResolutionSettings settings;
+		settings.TargetMilliseconds = 12.0;
+		simulate("Hysteresis:    ", settings);
+
+		DynamicResolutionSettings noHysteresis = settings;
+		noHysteresis.IncreaseThreshold = noHysteresis.DecreaseThreshold = 0.9f;
+		noHysteresis.CooldownFrames = 0;
+		noHysteresis.Smoothing = 1.0f;
+		simulate("No hysteresis: ", noHysteresis);
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkDynamicResolution", BenchmarkDynamicResolution::main);
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include "gpu_heap.h"
+#include "scene_runner.h"
+
+namespace BenchmarkGpuHeap {
+
+	// Settings
+	const uint32_t HEAP_SIZE = 256 * 1024 * 1024;
+	const unsigned int LIVE_ALLOCATIONS = 20000;
+	const unsigned int OPERATIONS = 1000000;
+	const unsigned int FIRST_FIT_OPERATIONS = 20000;	// Its linear search makes the full run take minutes
+	const uint32_t MIN_SIZE = 64;
+	const uint32_t MAX_SIZE = 64 * 1024;
+
+	const unsigned int FIRST_FIT_INVALID = 0xFFFFFFFFu;
+
+	// The baseline: first fit over the free ranges kept sorted by offset, the way the mesh pool
+	// allocated before it moved onto GpuHeap
+	class FirstFitAllocator
+	{
+	public:
+		void Reset(unsigned int capacity)
+		{
+			freeRanges.clear();
+			freeRanges[0] = capacity;
+		}
+
+		unsigned int Allocate(unsigned int size)
+		{
+			for (std::map<unsigned int, unsigned int>::iterator range = freeRanges.begin(); range != freeRanges.end(); ++range) {
+				if (range->second < size)
+					continue;
+				unsigned int offset = range->first;
+				unsigned int rest = range->second - size;
+				freeRanges.erase(range);
+				if (rest > 0)
+					freeRanges[offset + size] = rest;
+				return offset;
+			}
+			return FIRST_FIT_INVALID;
+		}
+
+		// Merges the range with its free neighbours
+		void Free(unsigned int offset, unsigned int size)
+		{
+			std::map<unsigned int, unsigned int>::iterator next = freeRanges.lower_bound(offset);
+			if (next != freeRanges.begin()) {
+				std::map<unsigned int, unsigned int>::iterator previous = next;
+				--previous;
+				if (previous->first + previous->second == offset) {
+					offset = previous->first;
+					size += previous->second;
+					freeRanges.erase(previous);
+				}
+			}
+			if (next != freeRanges.end() && offset + size == next->first) {
+				size += next->second;
+				freeRanges.erase(next);
+			}
+			freeRanges[offset] = size;
+		}
+
+	private:
+		std::map<unsigned int, unsigned int> freeRanges;	// Offset -> size
+	};
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Sizes spread evenly over the powers of two between MIN_SIZE and MAX_SIZE, like a mix of
+	// small props and large meshes
+	std::vector<uint32_t> makeSizes(unsigned int count)
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> exponent(glm::log2((float) MIN_SIZE), glm::log2((float) MAX_SIZE));
+		std::vector<uint32_t> sizes(count);
+		for (unsigned int i = 0; i < count; i++)
+			sizes[i] = (uint32_t) glm::exp2(exponent(random)) / 4 * 4;
+		return sizes;
+	}
+
+	// Walks the TLSF blocks in address order and checks they tile the heap without gaps or overlaps
+	bool validate(const TlsfAllocator& tlsf)
+	{
+		uint32_t end = tlsf.GetCapacity(), used = 0;
+		for (uint32_t block = tlsf.GetLastBlock(); block != TLSF_INVALID; block = tlsf.GetPreviousBlock(block)) {
+			if (tlsf.GetOffset(block) + tlsf.GetSize(block) != end)
+				return false;
+			end = tlsf.GetOffset(block);
+			if (!tlsf.IsFree(block))
+				used += tlsf.GetSize(block);
+		}
+		return end == 0 && used == tlsf.GetUsed();
+	}
+
+	// Keeps LIVE_ALLOCATIONS ranges alive while freeing a random one and allocating a new one
+	// OPERATIONS times with the TLSF allocator, checks the blocks still tile the heap, and times
+	// the first FIRST_FIT_OPERATIONS of the same pairs on FirstFitAllocator.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::vector<uint32_t> sizes = makeSizes(LIVE_ALLOCATIONS + OPERATIONS);
+		std::mt19937 random(7);
+		std::vector<unsigned int> victims(OPERATIONS);
+		for (unsigned int i = 0; i < OPERATIONS; i++)
+			victims[i] = random() % LIVE_ALLOCATIONS;
+		std::cout << LIVE_ALLOCATIONS << " live allocations of " << MIN_SIZE << " to " << MAX_SIZE << " bytes, " << OPERATIONS << " free + allocate pairs" << std::endl;
+
+		TlsfAllocator tlsf;
+		tlsf.Reset(HEAP_SIZE);
+		std::vector<uint32_t> blocks(LIVE_ALLOCATIONS);
+		unsigned int failures = 0;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < LIVE_ALLOCATIONS; i++)
+			blocks[i] = tlsf.Allocate(sizes[i], i % 8 == 0 ? 256 : TLSF_GRANULARITY);
+		for (unsigned int i = 0; i < OPERATIONS; i++) {
+			unsigned int victim = victims[i];
+			tlsf.Free(blocks[victim]);
+			blocks[victim] = tlsf.Allocate(sizes[LIVE_ALLOCATIONS + i], victim % 8 == 0 ? 256 : TLSF_GRANULARITY);
+			failures += blocks[victim] == TLSF_INVALID;
+		}
+		double milliseconds = elapsedMilliseconds(start);
+		uint32_t freeBytes = tlsf.GetCapacity() - tlsf.GetUsed();
+		std::cout << "TLSF:      " << milliseconds * 1000000.0 / OPERATIONS << " ns per pair, " << tlsf.GetFreeBlockCount() << " free blocks, fragmentation "
+			<< 1.0f - (float) tlsf.GetLargestFreeBlock() / freeBytes << ", " << failures << " failed" << std::endl;
+		if (!validate(tlsf))
+			std::cout << "ERROR::GPU_HEAP::CORRUPT_BLOCKS" << std::endl;
+		for (unsigned int i = 0; i < LIVE_ALLOCATIONS; i++) {
+			if (blocks[i] != TLSF_INVALID && tlsf.GetOffset(blocks[i]) % (i % 8 == 0 ? 256 : TLSF_GRANULARITY) != 0) {
+				std::cout << "ERROR::GPU_HEAP::MISALIGNED: allocation " << i << std::endl;
+				break;
+			}
+		}
+		for (unsigned int i = 0; i < LIVE_ALLOCATIONS; i++)
+			tlsf.Free(blocks[i]);
+		if (tlsf.GetUsed() != 0 || tlsf.GetFreeBlockCount() != 1)
+			std::cout << "ERROR::GPU_HEAP::NOT_COALESCED: " << tlsf.GetFreeBlockCount() << " free blocks left" << std::endl;
+
+		// The start of the same sequence, sizes rounded the same way, on the first fit allocator
+		FirstFitAllocator firstFit;
+		firstFit.Reset(HEAP_SIZE);
+		std::vector<unsigned int> offsets(LIVE_ALLOCATIONS);
+		std::vector<unsigned int> allocated(LIVE_ALLOCATIONS);
+		failures = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < LIVE_ALLOCATIONS; i++) {
+			allocated[i] = (sizes[i] + TLSF_GRANULARITY - 1) / TLSF_GRANULARITY * TLSF_GRANULARITY;
+			offsets[i] = firstFit.Allocate(allocated[i]);
+		}
+		for (unsigned int i = 0; i < FIRST_FIT_OPERATIONS; i++) {
+			unsigned int victim = victims[i];
+			if (offsets[victim] != FIRST_FIT_INVALID)
+				firstFit.Free(offsets[victim], allocated[victim]);
+			allocated[victim] = (sizes[LIVE_ALLOCATIONS + i] + TLSF_GRANULARITY - 1) / TLSF_GRANULARITY * TLSF_GRANULARITY;
+			offsets[victim] = firstFit.Allocate(allocated[victim]);
+			failures += offsets[victim] == FIRST_FIT_INVALID;
+		}
+		milliseconds = elapsedMilliseconds(start);
+		std::cout << "First fit: " << milliseconds * 1000000.0 / FIRST_FIT_OPERATIONS << " ns per pair, " << failures << " failed" << std::endl;
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkGpuHeap", BenchmarkGpuHeap::main);
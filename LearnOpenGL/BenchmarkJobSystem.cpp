@@ -0,0 +1,109 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "batch_transform.h"
+#include "job_system.h"
+#include "scene_runner.h"
+
+namespace BenchmarkJobSystem {
+
+	// Settings
+	const unsigned int MAX_THREADS = 64;
+	const unsigned int OBJECT_COUNT = 1000000;
+	const unsigned int SMALL_JOBS = 100000;
+	const unsigned int SPAWN_WAVE = 500;
+	const unsigned int SPIN_ITERATIONS = 2000;
+	const unsigned int RUNS = 20;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void report(const char* label, unsigned int threads, double milliseconds, double baseline)
+	{
+		std::cout << label << threads << " threads: " << milliseconds << " ms, " << baseline / milliseconds << "x" << std::endl;
+	}
+
+	// Some arithmetic the compiler can't drop, standing in for real per item work
+	float spin(unsigned int seed)
+	{
+		float value = (float) seed;
+		for (unsigned int i = 0; i < SPIN_ITERATIONS; i++)
+			value = value * 0.999f + 1.0f;
+		return value;
+	}
+
+	// Times the engine workloads on job systems of 1, 2, 4, ... threads, up to the hardware
+	// threads or MAX_THREADS: building a million matrices, ParallelFor over items of uneven cost,
+	// and spawning many tiny jobs under parent jobs (pure scheduling overhead).
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		TransformBatch transforms(TRANSFORM_ROTATION_AXIS_ANGLE);
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			glm::vec3 axis = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+			transforms.Add(glm::vec3(position(random), position(random), position(random)), axis, unit(random) * 3.0f, glm::vec3(1.0f));
+		}
+		std::vector<float> out(OBJECT_COUNT * 12);
+		std::vector<float> results(SMALL_JOBS);
+
+		unsigned int maxThreads = glm::clamp(std::thread::hardware_concurrency(), 1u, MAX_THREADS);
+		std::cout << "Scaling over 1 to " << maxThreads << " threads" << std::endl;
+
+		double transformBaseline = 0.0, unevenBaseline = 0.0, spawnBaseline = 0.0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			JobSystem jobs(threads);
+
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			for (unsigned int run = 0; run < RUNS; run++)
+				BuildTransformsParallel(transforms, &out[0], TRANSFORM_LAYOUT_MAT3X4, jobs);
+			double milliseconds = elapsedMilliseconds(start) / RUNS;
+			if (threads == 1)
+				transformBaseline = milliseconds;
+			report("Batch transforms, ", threads, milliseconds, transformBaseline);
+
+			// Every 16th item costs 16 times as much, so static splits would leave threads idle
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int run = 0; run < RUNS; run++) {
+				jobs.ParallelFor(0, SMALL_JOBS / 16, [&](size_t first, size_t last) {
+					for (size_t i = first; i < last; i++)
+						for (unsigned int repeat = 0; repeat < (i % 16 == 0 ? 16u : 1u); repeat++)
+							results[i] = spin((unsigned int) i + repeat);
+				});
+			}
+			milliseconds = elapsedMilliseconds(start) / RUNS;
+			if (threads == 1)
+				unevenBaseline = milliseconds;
+			report("Uneven ParallelFor, ", threads, milliseconds, unevenBaseline);
+
+			std::atomic<unsigned int> done(0);
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int run = 0; run < RUNS; run++) {
+				// In waves, a thread may only have JOB_POOL_SIZE jobs alive at once
+				for (unsigned int wave = 0; wave < SMALL_JOBS; wave += SPAWN_WAVE) {
+					Job* root = jobs.Create([]() {});
+					for (unsigned int i = 0; i < SPAWN_WAVE; i++)
+						jobs.Run(jobs.Create([&done]() { done.fetch_add(1, std::memory_order_relaxed); }, root));
+					jobs.Run(root);
+					jobs.Wait(root);
+				}
+			}
+			milliseconds = elapsedMilliseconds(start) / RUNS;
+			if (threads == 1)
+				spawnBaseline = milliseconds;
+			report("Empty job spawn + wait, ", threads, milliseconds, spawnBaseline);
+			std::cout << "  " << milliseconds * 1e6 / SMALL_JOBS << " ns per job" << std::endl;
+
+			if (done.load() != SMALL_JOBS * RUNS)
+				std::cout << "ERROR::JOB_SYSTEM::LOST_JOBS: " << done.load() << " of " << SMALL_JOBS * RUNS << " ran" << std::endl;
+		}
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkJobSystem", BenchmarkJobSystem::main);
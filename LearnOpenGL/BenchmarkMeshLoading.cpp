@@ -0,0 +1,85 @@
+#include <chrono>
+#include <iostream>
+#include "obj_loader.h"
+#include "mesh_binary.h"
+#include "mesh_primitives.h"
+#include "scene_runner.h"
+
+namespace BenchmarkMeshLoading {
+
+	// Settings
+	const char* OBJ_PATH = "benchmark_sphere.obj";
+	const char* MESH_PATH = "benchmark_sphere.mesh";
+	const unsigned int RUNS = 5;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Touches every byte of a view the way an upload would, so mapped pages really get read
+	unsigned int checksum(const MeshView& view)
+	{
+		const unsigned char* vertices = (const unsigned char*) view.Vertices;
+		const unsigned char* indices = (const unsigned char*) view.Indices;
+		size_t vertexBytes = (size_t) view.VertexCount * view.VertexStride;
+		size_t indexBytes = (size_t) view.IndexCount * IndexTypeSize(view.IndexType);
+
+		unsigned int sum = 0;
+		for (size_t i = 0; i < vertexBytes; i += 4)
+			sum += vertices[i];
+		for (size_t i = 0; i < indexBytes; i += 4)
+			sum += indices[i];
+		return sum;
+	}
+
+	// Compares loading the same mesh from OBJ text and from the mapped binary format.
+	// Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		// Generate the test assets on first run
+		{
+			MeshData sphere = GenerateSphere(512, 1024);
+			std::ifstream existing(OBJ_PATH);
+			if (!existing && !SaveObj(OBJ_PATH, sphere))
+				return -1;
+		}
+
+		MeshData converted;
+		if (!LoadObj(OBJ_PATH, converted) || !SaveMeshFile(MESH_PATH, converted))
+			return -1;
+
+		std::cout << "Mesh: " << converted.VertexCount << " vertices, " << converted.Indices.size() / 3 << " triangles" << std::endl;
+
+		// Text parsing
+		double objTotal = 0.0;
+		unsigned int sum = 0;
+		for (unsigned int run = 0; run < RUNS; run++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			MeshData mesh;
+			LoadObj(OBJ_PATH, mesh);
+			sum += checksum(mesh.View());
+			objTotal += elapsedMilliseconds(start);
+		}
+
+		// Binary mapping
+		double binaryTotal = 0.0;
+		for (unsigned int run = 0; run < RUNS; run++) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			MeshFile file;
+			file.Load(MESH_PATH);
+			sum += checksum(file.View());
+			binaryTotal += elapsedMilliseconds(start);
+		}
+
+		double objAverage = objTotal / RUNS;
+		double binaryAverage = binaryTotal / RUNS;
+		std::cout << "OBJ text parse:  " << objAverage << " ms" << std::endl;
+		std::cout << "Binary mmap:     " << binaryAverage << " ms" << std::endl;
+		std::cout << "Speedup:         " << objAverage / binaryAverage << "x" << std::endl;
+		std::cout << "(checksum " << sum << ")" << std::endl;
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkMeshLoading", BenchmarkMeshLoading::main);
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "mesh_optimizer.h"
+#include "mesh_primitives.h"
+#include "scene_runner.h"
+
+namespace BenchmarkMeshOptimizer {
+
+	// Settings
+	const unsigned int CACHE_SIZES[] = { 16, 32 };
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Randomizes the triangle order, like a mesh exported without any care for the GPU
+	void shuffleTriangles(MeshData& mesh)
+	{
+		size_t triangleCount = mesh.Indices.size() / 3;
+		std::vector<unsigned int> order(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			order[t] = (unsigned int) t;
+		std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+		std::vector<unsigned int> indices(mesh.Indices.size());
+		for (size_t t = 0; t < triangleCount; t++)
+			for (int k = 0; k < 3; k++)
+				indices[t * 3 + k] = mesh.Indices[order[t] * 3 + k];
+		mesh.Indices.swap(indices);
+	}
+
+	void printStatistics(const char* label, const MeshData& mesh)
+	{
+		std::cout << "  " << label;
+		for (unsigned int cacheSize : CACHE_SIZES) {
+			VertexCacheStatistics cache = AnalyzeVertexCache(&mesh.Indices[0], mesh.Indices.size(), mesh.VertexCount, cacheSize);
+			std::cout << "  ACMR(" << cacheSize << ") " << cache.ACMR << "  ATVR(" << cacheSize << ") " << cache.ATVR;
+		}
+		std::cout << "  overdraw " << AnalyzeOverdraw(mesh).Overdraw << std::endl;
+	}
+
+	void benchmark(const char* name, MeshData mesh)
+	{
+		std::cout << name << ": " << mesh.VertexCount << " vertices, " << mesh.Indices.size() / 3 << " triangles" << std::endl;
+		printStatistics("before", mesh);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		OptimizeMesh(mesh);
+		double milliseconds = elapsedMilliseconds(start);
+
+		printStatistics("after ", mesh);
+		std::cout << "  optimized in " << milliseconds << " ms" << std::endl;
+	}
+
+	// Reports vertex cache efficiency (FIFO cache simulator) and overdraw (software rasterizer)
+	// before and after OptimizeMesh. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		MeshData sphere = GenerateSphere(128, 256);
+		benchmark("Sphere, generated order", sphere);
+
+		shuffleTriangles(sphere);
+		benchmark("Sphere, shuffled triangles", sphere);
+
+		MeshData torus = GenerateTorus(128, 64, 1.0f, 0.4f);
+		shuffleTriangles(torus);
+		benchmark("Torus, shuffled triangles", torus);
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkMeshOptimizer", BenchmarkMeshOptimizer::main);
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "camera.h"
+#include "meshlet.h"
+#include "mesh_optimizer.h"
+#include "mesh_primitives.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace BenchmarkMeshletCulling {
+
+	// Settings
+	const unsigned int GRID_SIZE = 32;
+	const float SPACING = 3.0f;
+	const unsigned int RUNS = 20;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Straightforward one meshlet at a time version of CullMeshlets, for checking and comparison
+	unsigned int cullScalar(const MeshletMesh& mesh, const Frustum& frustum, glm::vec3 cameraPosition)
+	{
+		unsigned int visibleTriangles = 0;
+		for (unsigned int i = 0; i < mesh.Meshlets.size(); i++) {
+			MeshletBounds bounds = mesh.GetBounds(i);
+			if (!IsSphereInFrustum(frustum, bounds.Center, bounds.Radius))
+				continue;
+			glm::vec3 toCenter = bounds.Center - cameraPosition;
+			if (glm::dot(toCenter, bounds.ConeAxis) >= bounds.ConeCutoff * glm::length(toCenter) + bounds.Radius)
+				continue;
+			visibleTriangles += mesh.Meshlets[i].TriangleCount;
+		}
+		return visibleTriangles;
+	}
+
+	// Builds meshlets for a torus, places a grid of them in front of the camera and times the
+	// per-frame culling pass. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		MeshData torus = GenerateTorus(256, 128, 1.0f, 0.4f);
+		OptimizeVertexCache(&torus.Indices[0], torus.Indices.size(), torus.VertexCount);
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		MeshletMesh meshlets = BuildMeshlets(torus);
+		double buildMilliseconds = elapsedMilliseconds(start);
+
+		std::cout << "Mesh: " << torus.VertexCount << " vertices, " << torus.Indices.size() / 3 << " triangles" << std::endl;
+		std::cout << "Meshlets: " << meshlets.Meshlets.size() << ", " << (float) meshlets.Vertices.size() / meshlets.Meshlets.size() << " vertices and "
+			<< (float) meshlets.Triangles.size() / 3 / meshlets.Meshlets.size() << " triangles on average, built in " << buildMilliseconds << " ms" << std::endl;
+
+		// Grid of instances on the xz plane, camera in the middle looking down -z
+		std::vector<MeshletInstance> instances;
+		for (unsigned int x = 0; x < GRID_SIZE; x++) {
+			for (unsigned int z = 0; z < GRID_SIZE; z++) {
+				MeshletInstance instance;
+				instance.Mesh = &meshlets;
+				glm::mat4 model = glm::translate(glm::mat4(), glm::vec3((x - GRID_SIZE / 2.0f) * SPACING, 0.0f, (z - GRID_SIZE / 2.0f) * SPACING));
+				instance.Model = glm::rotate(model, glm::radians(17.0f * (x + z)), glm::vec3(1.0f, 0.3f, 0.5f));
+				instances.push_back(instance);
+			}
+		}
+
+		Camera camera(glm::vec3(0.0f, 2.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 100.0f);
+		Frustum frustum = ExtractFrustum(projection * camera.GetViewMatrix());
+
+		size_t totalMeshlets = instances.size() * meshlets.Meshlets.size();
+		size_t totalTriangles = instances.size() * (torus.Indices.size() / 3);
+		std::vector<MeshletCullResult> results(instances.size());
+
+		// Scalar reference
+		unsigned int scalarTriangles = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			scalarTriangles = 0;
+			for (size_t i = 0; i < instances.size(); i++) {
+				glm::vec3 objectCamera = InverseAffine(instances[i].Model).TransformPoint(camera.Position);
+				scalarTriangles += cullScalar(meshlets, TransformFrustum(frustum, instances[i].Model), objectCamera);
+			}
+		}
+		double scalarMilliseconds = elapsedMilliseconds(start) / RUNS;
+		std::cout << "Scalar:            " << scalarMilliseconds << " ms, " << totalMeshlets / scalarMilliseconds << " meshlets/ms" << std::endl;
+
+		unsigned int maxThreads = glm::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			JobSystem jobs(threads);
+			start = std::chrono::high_resolution_clock::now();
+			for (unsigned int run = 0; run < RUNS; run++)
+				CullMeshletInstances(&instances[0], instances.size(), frustum, camera.Position, &results[0], MESHLET_OUTPUT_COMMANDS, jobs);
+			double milliseconds = elapsedMilliseconds(start) / RUNS;
+
+			unsigned int visibleTriangles = 0;
+			size_t commands = 0;
+			for (size_t i = 0; i < results.size(); i++) {
+				visibleTriangles += results[i].VisibleTriangles;
+				commands += results[i].Commands.size();
+			}
+			if (visibleTriangles != scalarTriangles)
+				std::cout << "ERROR::MESHLET::RESULT_MISMATCH: " << visibleTriangles << " != " << scalarTriangles << std::endl;
+
+			std::cout << "SSE, " << threads << " thread(s):   " << milliseconds << " ms, " << totalMeshlets / milliseconds << " meshlets/ms, "
+				<< visibleTriangles << " / " << totalTriangles << " triangles in " << commands << " draw commands" << std::endl;
+		}
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkMeshletCulling", BenchmarkMeshletCulling::main);
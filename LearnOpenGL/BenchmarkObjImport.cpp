@@ -0,0 +1,79 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "obj_loader.h"
+#include "obj_importer.h"
+#include "mesh_primitives.h"
+#include "scene_runner.h"
+
+namespace BenchmarkObjImport {
+
+	// Settings
+	const char* OBJ_PATH = "benchmark_sphere.obj";
+	const unsigned int RUNS = 3;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Measures import throughput of the threaded importer for 1..N threads against the
+	// istream based LoadObj. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		// Generate the test asset on first run
+		{
+			std::ifstream existing(OBJ_PATH);
+			if (!existing && !SaveObj(OBJ_PATH, GenerateSphere(512, 1024)))
+				return -1;
+		}
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		MeshData reference;
+		if (!LoadObj(OBJ_PATH, reference))
+			return -1;
+		double referenceTime = elapsedMilliseconds(start);
+
+		ObjImportStats stats;
+		MeshData mesh;
+		ImportObj(OBJ_PATH, mesh, 1, &stats);
+		double megabytes = stats.FileBytes / (1024.0 * 1024.0);
+
+		std::cout << "File: " << megabytes << " MB, " << reference.VertexCount << " vertices, " << reference.Indices.size() / 3 << " triangles" << std::endl;
+		std::cout << "LoadObj (istream): " << referenceTime << " ms, " << megabytes / referenceTime * 1000.0 << " MB/s" << std::endl;
+
+		bool matches = mesh.VertexCount == reference.VertexCount && mesh.Indices == reference.Indices;
+		std::cout << "ImportObj output matches LoadObj: " << (matches ? "yes" : "NO") << std::endl;
+
+		unsigned int maxThreads = std::thread::hardware_concurrency();
+		if (maxThreads == 0)
+			maxThreads = 1;
+
+		double singleThreaded = 0.0;
+		for (unsigned int threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads != maxThreads ? maxThreads : threads * 2) {
+			double best = 1e30;
+			ObjImportStats bestStats = stats;
+			for (unsigned int run = 0; run < RUNS; run++) {
+				MeshData imported;
+				ImportObj(OBJ_PATH, imported, threads, &stats);
+				if (stats.TotalMilliseconds < best) {
+					best = stats.TotalMilliseconds;
+					bestStats = stats;
+				}
+			}
+			if (threads == 1)
+				singleThreaded = best;
+
+			std::cout << "ImportObj " << bestStats.Threads << " threads: " << best << " ms ("
+				<< "parse " << bestStats.ParseMilliseconds << ", merge " << bestStats.MergeMilliseconds << ", weld " << bestStats.WeldMilliseconds << "), "
+				<< megabytes / best * 1000.0 << " MB/s, scaling " << singleThreaded / best << "x" << std::endl;
+
+			if (threads == maxThreads)
+				break;
+		}
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkObjImport", BenchmarkObjImport::main);
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "render_queue.h"
+#include "scene_runner.h"
+
+namespace BenchmarkRenderQueue {
+
+	// Settings
+	const unsigned int DRAW_COUNT = 100000;
+	const unsigned int PROGRAM_COUNT = 8;
+	const unsigned int TEXTURE_SET_COUNT = 64;
+	const unsigned int VERTEX_ARRAY_COUNT = 256;
+	const unsigned int RUNS = 20;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	struct Draw
+	{
+		unsigned int Program;
+		unsigned int TextureSet;
+		unsigned int VertexArray;
+		float Depth;
+	};
+
+	// State changes a caching backend would make drawing in the given order
+	void countChanges(const char* label, const std::vector<Draw>& draws, const std::vector<uint32_t>& order)
+	{
+		unsigned int programChanges = 0, textureChanges = 0, vertexArrayChanges = 0, depthInversions = 0;
+		for (size_t i = 1; i < order.size(); i++) {
+			const Draw& previous = draws[order[i - 1]];
+			const Draw& current = draws[order[i]];
+			programChanges += previous.Program != current.Program;
+			textureChanges += previous.TextureSet != current.TextureSet;
+			vertexArrayChanges += previous.VertexArray != current.VertexArray;
+			// Drawn behind the previous draw of the same state, which early-z can't reject against
+			bool sameState = previous.Program == current.Program && previous.TextureSet == current.TextureSet && previous.VertexArray == current.VertexArray;
+			depthInversions += sameState && current.Depth < previous.Depth;
+		}
+		std::cout << label << programChanges << " program, " << textureChanges << " texture, " << vertexArrayChanges << " vertex array changes, "
+			<< depthInversions << " back to front pairs" << std::endl;
+	}
+
+	// Records DRAW_COUNT opaque draws with random state and depth, sorts their keys with the
+	// radix sort and with std::sort, and counts the state changes of submission order versus key
+	// order. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::vector<Draw> draws(DRAW_COUNT);
+		std::vector<uint64_t> keys(DRAW_COUNT);
+		std::vector<uint32_t> submissionOrder(DRAW_COUNT);
+		for (unsigned int i = 0; i < DRAW_COUNT; i++) {
+			Draw& draw = draws[i];
+			draw.Program = random() % PROGRAM_COUNT;
+			draw.TextureSet = random() % TEXTURE_SET_COUNT;
+			draw.VertexArray = random() % VERTEX_ARRAY_COUNT;
+			draw.Depth = std::uniform_real_distribution<float>(0.1f, 500.0f)(random);
+			keys[i] = MakeSortKey(RENDER_LAYER_OPAQUE, draw.Program, draw.TextureSet, draw.VertexArray, draw.Depth);
+			submissionOrder[i] = i;
+		}
+		std::cout << "Sorting " << DRAW_COUNT << " draw keys" << std::endl;
+
+		std::vector<uint64_t> sortedKeys, scratchKeys;
+		std::vector<uint32_t> sortedIndices, scratchIndices;
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			sortedKeys = keys;
+			sortedIndices = submissionOrder;
+			RenderQueue::SortKeys(sortedKeys, sortedIndices, scratchKeys, scratchIndices);
+		}
+		std::cout << "Radix sort: " << elapsedMilliseconds(start) / RUNS << " ms" << std::endl;
+
+		std::vector<std::pair<uint64_t, uint32_t> > pairs(DRAW_COUNT);
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int run = 0; run < RUNS; run++) {
+			for (unsigned int i = 0; i < DRAW_COUNT; i++)
+				pairs[i] = std::make_pair(keys[i], i);
+			std::sort(pairs.begin(), pairs.end());
+		}
+		std::cout << "std::sort:  " << elapsedMilliseconds(start) / RUNS << " ms" << std::endl;
+
+		for (unsigned int i = 0; i < DRAW_COUNT; i++) {
+			if (pairs[i].first != sortedKeys[i]) {
+				std::cout << "ERROR::RENDER_QUEUE::SORT_MISMATCH: at " << i << std::endl;
+				break;
+			}
+		}
+
+		countChanges("Submission order: ", draws, submissionOrder);
+		countChanges("Key order:        ", draws, sortedIndices);
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkRenderQueue", BenchmarkRenderQueue::main);
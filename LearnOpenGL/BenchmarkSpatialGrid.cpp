@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include "camera.h"
+#include "spatial_grid.h"
+#include "scene_runner.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace BenchmarkSpatialGrid {
+
+	// Settings
+	const unsigned int OBJECT_COUNT = 200000;
+	const float WORLD_SIZE = 200.0f;
+	const float CELL_SIZE = 8.0f;
+	const unsigned int FRAMES = 60;
+	const unsigned int SPHERE_QUERIES = 1000;
+
+	double elapsedMilliseconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Moves 200k objects around every frame with MoveBatch and checks frustum / sphere queries
+	// against testing every object. Runs on the CPU only, no GL context is needed.
+	int main()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<float> position(-WORLD_SIZE, WORLD_SIZE);
+		std::uniform_real_distribution<float> velocity(-20.0f, 20.0f);
+		std::uniform_real_distribution<float> size(0.25f, 2.0f);
+
+		std::vector<glm::vec3> centers(OBJECT_COUNT), velocities(OBJECT_COUNT);
+		std::vector<float> radii(OBJECT_COUNT);
+		std::vector<unsigned int> ids(OBJECT_COUNT);
+
+		SpatialGrid grid(CELL_SIZE);
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+			centers[i] = glm::vec3(position(random), position(random), position(random));
+			velocities[i] = glm::vec3(velocity(random), velocity(random), velocity(random));
+			radii[i] = size(random);
+			ids[i] = grid.Insert(centers[i], radii[i]);
+		}
+		std::cout << "Insert: " << OBJECT_COUNT / elapsedMilliseconds(start) << " objects/ms" << std::endl;
+
+		// Simulate at 60 Hz, bouncing off the world bounds
+		unsigned int maxThreads = glm::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+			double total = 0.0;
+			for (unsigned int frame = 0; frame < FRAMES; frame++) {
+				for (unsigned int i = 0; i < OBJECT_COUNT; i++) {
+					centers[i] += velocities[i] * (1.0f / 60.0f);
+					for (int axis = 0; axis < 3; axis++)
+						if (glm::abs(centers[i][axis]) > WORLD_SIZE)
+							velocities[i][axis] = -velocities[i][axis];
+				}
+				start = std::chrono::high_resolution_clock::now();
+				grid.MoveBatch(&ids[0], &centers[0], &radii[0], OBJECT_COUNT, threads);
+				total += elapsedMilliseconds(start);
+			}
+			std::cout << "MoveBatch, " << threads << " thread(s): " << total / FRAMES << " ms/frame, " << OBJECT_COUNT * FRAMES / total << " objects/ms" << std::endl;
+		}
+
+		// Frustum query from a camera in the middle of the world
+		Camera camera(glm::vec3(0.0f, 0.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 800.0f / 600.0f, 0.1f, 200.0f);
+		Frustum frustum = camera.GetFrustum(projection);
+
+		std::vector<unsigned int> found, expected;
+		grid.ResetQueryCounters();
+		start = std::chrono::high_resolution_clock::now();
+		grid.QueryFrustum(frustum, found);
+		double gridMilliseconds = elapsedMilliseconds(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+			if (IsSphereInFrustum(frustum, centers[i], radii[i]))
+				expected.push_back(ids[i]);
+		double linearMilliseconds = elapsedMilliseconds(start);
+
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		if (found != expected)
+			std::cout << "ERROR::SPATIAL_GRID::FRUSTUM_MISMATCH: " << found.size() << " != " << expected.size() << std::endl;
+		std::cout << "Frustum: grid " << gridMilliseconds << " ms, linear " << linearMilliseconds << " ms, " << found.size() << " visible" << std::endl;
+
+		// The same view with reverse-Z projections, with and without clip control: the far plane is at
+		// infinity, so everything visible above stays visible, and the grid has to agree
+		size_t standardVisible = found.size();
+		for (int zeroToOne = 0; zeroToOne < 2; zeroToOne++) {
+			float focal = 1.0f / tan(glm::radians(camera.Zoom) * 0.5f);
+			glm::mat4 reverseZ(0.0f);
+			reverseZ[0][0] = focal / (800.0f / 600.0f);
+			reverseZ[1][1] = focal;
+			reverseZ[2][3] = -1.0f;
+			reverseZ[2][2] = zeroToOne ? 0.0f : 1.0f;
+			reverseZ[3][2] = zeroToOne ? 0.1f : 0.2f;
+			Frustum reversed = ExtractFrustum(reverseZ * camera.GetViewMatrix(), zeroToOne != 0, true);
+
+			found.clear();
+			expected.clear();
+			grid.QueryFrustum(reversed, found);
+			for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+				if (IsSphereInFrustum(reversed, centers[i], radii[i]))
+					expected.push_back(ids[i]);
+			std::sort(found.begin(), found.end());
+			std::sort(expected.begin(), expected.end());
+			if (found != expected || expected.size() < standardVisible || !IsSphereInFrustum(reversed, camera.Position + camera.Front * 50.0f, 1.0f)
+				|| IsSphereInFrustum(reversed, camera.Position - camera.Front * 50.0f, 1.0f))
+				std::cout << "ERROR::SPATIAL_GRID::REVERSE_Z_FRUSTUM_MISMATCH: " << found.size() << " != " << expected.size() << " (" << standardVisible << " with a far plane)" << std::endl;
+		}
+
+		// Sphere queries around random objects
+		size_t foundTotal = 0;
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int q = 0; q < SPHERE_QUERIES; q++) {
+			found.clear();
+			grid.QuerySphere(centers[q], 10.0f, found);
+			foundTotal += found.size();
+		}
+		std::cout << "Sphere: " << SPHERE_QUERIES / elapsedMilliseconds(start) << " queries/ms, " << (double) foundTotal / SPHERE_QUERIES << " objects per query" << std::endl;
+
+		found.clear();
+		expected.clear();
+		grid.QuerySphere(centers[0], 10.0f, found);
+		for (unsigned int i = 0; i < OBJECT_COUNT; i++)
+			if (glm::length(centers[i] - centers[0]) <= radii[i] + 10.0f)
+				expected.push_back(ids[i]);
+		std::sort(found.begin(), found.end());
+		std::sort(expected.begin(), expected.end());
+		if (found != expected)
+			std::cout << "ERROR::SPATIAL_GRID::SPHERE_MISMATCH: " << found.size() << " != " << expected.size() << std::endl;
+
+		// Remove half and release what emptied out
+		for (unsigned int i = 0; i < OBJECT_COUNT; i += 2)
+			grid.Remove(ids[i]);
+		grid.ReleaseEmptyCells();
+
+		SpatialGridStats stats = grid.GetStats();
+		std::cout << "Objects " << stats.Objects << ", cells " << stats.Cells << " (" << stats.OccupiedCells << " occupied), " << stats.MemoryBytes / 1024 << " KB" << std::endl;
+		std::cout << "Queries " << stats.Queries << ": " << stats.CellsVisited << " cells visited, " << stats.ObjectsTested << " objects tested, " << stats.ObjectsReturned << " returned" << std::endl;
+		return 0;
+	}
+}
+
+static BenchmarkRegistrar registrar("BenchmarkSpatialGrid", BenchmarkSpatialGrid::main);
@@ -4,18 +4,26 @@
 #include "shader_m.h"
 #include "stb_image.h"
 #include "camera.h"
+#include "culling.h"
+#include "batch_transform.h"
+#include "frame_loop.h"
+#include "input_queue.h"
+#include "frame_uniforms.h"
+#include "render_queue.h"
+#include "frame_pacer.h"
+#include "scene_runner.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <string>
+
 namespace HelloCamera {
 
 	// Functions
 	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-	void mouse_callback(GLFWwindow* window, double xpos, double ypos);
-	void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-	void processInput(GLFWwindow *window);
+	void processInput(GLFWwindow *window, float deltaTime);
 
 	// Settings
 	const unsigned int SCR_WIDTH = 800;
@@ -23,13 +31,15 @@ namespace HelloCamera {
 
 	// Camera
 	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-	float lastX = SCR_WIDTH / 2.0f;
-	float lastY = SCR_HEIGHT / 2.0f;
-	bool firstMouse = true;
+
+	// Keyboard, mouse and scroll events recorded by the GLFW callbacks
+	InputQueue input;
 	
-	// Timing
-	float deltaTime = 0.0f;
-	float lastFrame = 0.0f;
+	// Simulated state, advanced at a fixed tick rate and interpolated between ticks for rendering
+	struct SceneState
+	{
+		glm::vec3 CameraPosition;
+	};
 
 	int main()
 	{
@@ -46,11 +56,11 @@ namespace HelloCamera {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -62,9 +72,8 @@ namespace HelloCamera {
 		// window, the viewport is adjusted as well.
 		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-		// Set camera callbacks
-		glfwSetCursorPosCallback(window, mouse_callback);
-		glfwSetScrollCallback(window, scroll_callback);
+		// Queue up input events for the simulation ticks
+		input.Attach(window);
 
 		// Tell GLFW to capture our mouse
 		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -74,12 +83,17 @@ namespace HelloCamera {
 		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 		{
 			std::cout << "Failed to initialize GLAD" << std::endl;
+			ReleaseScene();
 			return -1;
 		}
 
 		// Enable depth checking
 		glEnable(GL_DEPTH_TEST);
 
+		// View and projection go to the shader through the PerFrame uniform block
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
 		// Build shaders
 		Shader ourShader("Assets//Shaders//hello_coordinate_systems_shader.vs", "Assets//Shaders//hello_coordinate_systems_shader.fs");
 
@@ -141,6 +155,20 @@ namespace HelloCamera {
 			glm::vec3(-1.3f,  1.0f, -1.5f)
 		};
 
+		// Bounding spheres of the boxes for frustum culling. The sphere around a unit cube
+		// holds it in any orientation, so the rotation doesn't matter.
+		BoundingSpheres cubeBounds;
+		for (unsigned int i = 0; i < 10; i++)
+			cubeBounds.Add(cubePositions[i], 0.8660254f);
+		std::vector<unsigned int> visibleCubes;
+
+		// The boxes don't move, so their model matrices are built once up front
+		TransformBatch cubeTransforms;
+		for (unsigned int i = 0; i < 10; i++)
+			cubeTransforms.Add(cubePositions[i], glm::vec3(1.0f, 0.3f, 0.5f), glm::radians(20.0f * i));
+		std::vector<Affine> cubeModels(10);
+		BuildTransforms(cubeTransforms, &cubeModels[0]);
+
 		// Generate IDs for Vertex Array Objects and vertex buffer objects
 		unsigned int VBO, VAO;
 		glGenVertexArrays(1, &VAO);
@@ -222,63 +250,95 @@ namespace HelloCamera {
 		ourShader.setInt("texture1", 0);
 		ourShader.setInt("texture2", 1);
 
-		// game / render loop
-		while (!glfwWindowShouldClose(window))
-		{
-			// Per-frame time logic
-			float currentFrame = (float) glfwGetTime();
-			deltaTime = currentFrame - lastFrame;
-			lastFrame = currentFrame;
+		// The camera caches its projection and only rebuilds it when Zoom changes
+		int sceneWidth, sceneHeight;
+		GetSceneSize(window, sceneWidth, sceneHeight);
+		camera.SetPerspective((float) sceneWidth / (float) sceneHeight, 0.1f, 100.0f);
+
+		// Draws go through a render queue, which sorts them by state and front to back and only
+		// binds what changed
+		RenderQueue queue;
+		GLStateCache stateCache;
+		unsigned int cubeTextures[] = { texture1, texture2 };
+		unsigned int cubeProgram = queue.AddProgram(ourShader.ID);
+		unsigned int cubeTextureSet = queue.AddTextureSet(cubeTextures, 2);
+		unsigned int cubeVertexArray = queue.AddVertexArray(VAO);
+
+		// At most two frames are queued on the GPU; each frame first waits until one of them is
+		// done and only then polls the events, so the ticks right after see the latest input
+		FramePacer pacer;
+		pacer.Create(2);
+		double lastTitleUpdate = 0.0;
+		auto beginFrame = [&]() {
+			pacer.BeginFrame();
+			glfwPollEvents();
+			pacer.InputSampled();
+			return SceneRunning(window);
+		};
+
+		// Input moves the camera once per tick
+		auto simulate = [&](SceneState& state, double tickSeconds) {
+			camera.Position = state.CameraPosition;
+			processInput(window, (float) tickSeconds);
+			state.CameraPosition = camera.Position;
+		};
 
-			// Input
-			processInput(window);
+		// Rendering happens once per frame, with the camera placed between the last two ticks
+		auto render = [&](const SceneState& previous, const SceneState& current, float alpha) {
+			camera.Position = glm::mix(previous.CameraPosition, current.CameraPosition, alpha);
 
 			// Rendering
 			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-			// Bind textures on corresponding texture units
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, texture1);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, texture2);
-
-			// Activate shader
-			ourShader.use();
-
+			// Pass the camera matrices to all shaders at once (the projection could change every frame,
+			// the camera rebuilds it when it does)
+			frameUniforms.Upload(MakePerFrameUniforms(camera, (float) glfwGetTime()));
 
-			// Pass projection matrix to shader (note that in this case it could change every frame)
-			glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-			ourShader.setMat4("projection", projection);
+			// Only boxes inside the view frustum get drawn
+			unsigned int visibleCount = CullSpheres(camera.GetFrustum(), cubeBounds, visibleCubes);
 
-			// Camera/View transformation
-			glm::mat4 view = camera.GetViewMatrix();
-			ourShader.setMat4("view", view);
-
-			// Render boxes
-			glBindVertexArray(VAO);
-			for (unsigned int i = 0; i < 10; i++) {
-				// Calculate the model matrix for each object and pass it to the shader before drawing
-				glm::mat4 model;
-				model = glm::translate(model, cubePositions[i]);
-				float angle = 20.0f * i;
-				model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-				ourShader.setMat4("model", model);
-
-				glDrawArrays(GL_TRIANGLES, 0, 36);
+			// Record the boxes with their distance to the camera, then draw them in key order. The
+			// queue passes the model matrix of each object to the shader before drawing it.
+			queue.Begin();
+			for (unsigned int v = 0; v < visibleCount; v++) {
+				unsigned int i = visibleCubes[v];
+				RenderItem item = { GL_TRIANGLES, 0, 36, 0, 0, 1, cubeModels[i] };
+				queue.Add(RENDER_LAYER_OPAQUE, cubeProgram, cubeTextureSet, cubeVertexArray, glm::distance(camera.Position, cubePositions[i]), item);
+			}
+			queue.Sort();
+			queue.Execute(stateCache);
+
+			// Show the pacing in the title: frame time and its spread, and how long input takes
+			// to reach a finished frame
+			double now = glfwGetTime();
+			if (now - lastTitleUpdate > 0.5) {
+				FramePacerStats pacing = pacer.GetStats();
+				std::string title = "LearnOpenGL - " + std::to_string(pacing.MeanFrameMilliseconds) + " ms +- " + std::to_string(pacing.FrameTimeDeviation)
+					+ ", latency " + std::to_string(pacing.MeanLatencyMilliseconds) + " ms, " + std::to_string(pacer.MaxFramesInFlight) + " frames in flight";
+				glfwSetWindowTitle(window, title.c_str());
+				lastTitleUpdate = now;
 			}
 
-			// Check/call events and swap the buffers
+			// Swap the buffers and fence the frame
 			glfwSwapBuffers(window);
-			glfwPollEvents();
-		}
+			pacer.EndFrame();
+		};
+
+		// game / render loop
+		SceneState initial;
+		initial.CameraPosition = camera.Position;
+		FrameLoop<SceneState> loop;
+		loop.Run(initial, simulate, render, beginFrame);
 
 		// Clean up
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
+		frameUniforms.Release();
+		pacer.Release();
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -290,56 +350,33 @@ namespace HelloCamera {
 		glViewport(0, 0, width, height);
 	}
 
-	// Process all input : query GLFW whether relevant keys are pressed / released this frame and react accordingly
-	void processInput(GLFWwindow *window)
+	// Process all input : apply the events queued since the last tick and react to the keys held down
+	void processInput(GLFWwindow *window, float deltaTime)
 	{
-		
-		if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+		input.Drain();
+
+		if (input.IsKeyDown(GLFW_KEY_ESCAPE))
 			glfwSetWindowShouldClose(window, true);
 
-		// Control camrea
-		if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+		// Control camera
+		if (input.IsKeyDown(GLFW_KEY_W))
 			camera.ProcessKeyboard(FORWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+		if (input.IsKeyDown(GLFW_KEY_S))
 			camera.ProcessKeyboard(BACKWARD, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+		if (input.IsKeyDown(GLFW_KEY_A))
 			camera.ProcessKeyboard(LEFT, deltaTime);
-		if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+		if (input.IsKeyDown(GLFW_KEY_D))
 			camera.ProcessKeyboard(RIGHT, deltaTime);
-	}
 
-	// GLFW: Whenever the mouse moves, this callback is called
-	void mouse_callback(GLFWwindow* window, double xpos, double ypos)
-	{
-		float xposf = (float) xpos;
-		float yposf = (float) ypos;
+		// All mouse movement since the last tick turns the camera at once
+		glm::vec2 mouse = input.TakeMouseDelta();
+		if (mouse.x != 0.0f || mouse.y != 0.0f)
+			camera.ProcessMouseMovement(mouse.x, -mouse.y); // Reversed since y-coordinates go from bottom to top
 
-		if (firstMouse)
-		{
-			lastX = xposf;
-			lastY = yposf;
-			firstMouse = false;
-		}
-
-		float xoffset = xposf - lastX;
-		float yoffset = lastY - yposf; // Reversed since y-coordinates go from bottom to top
-
-		lastX = xposf;
-		lastY = yposf;
-
-		camera.ProcessMouseMovement(xoffset, yoffset);
-	}
-
-	// GLFW: Whenever the mouse scroll wheel scrolls, this callback is called
-	void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
-	{
-		camera.ProcessMouseScroll((float) yoffset);
+		glm::vec2 scroll = input.TakeScrollDelta();
+		if (scroll.y != 0.0f)
+			camera.ProcessMouseScroll(scroll.y);
 	}
 }
 
-int main()
-{
-
-	return HelloCamera::main();
-
-}
\ No newline at end of file
+static SceneRegistrar registrar("HelloCamera", HelloCamera::main);
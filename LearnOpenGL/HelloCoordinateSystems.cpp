@@ -3,6 +3,9 @@
 #include <iostream>
 #include "shader_m.h"
 #include "stb_image.h"
+#include "affine.h"
+#include "frame_uniforms.h"
+#include "scene_runner.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,11 +36,11 @@ namespace HelloCoordinateSystems {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -60,6 +63,10 @@ namespace HelloCoordinateSystems {
 		// Enable depth checking
 		glEnable(GL_DEPTH_TEST);
 
+		// View and projection go to the shader through the PerFrame uniform block
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
 		// Build shaders
 		Shader ourShader("Assets//Shaders//hello_coordinate_systems_shader.vs", "Assets//Shaders//hello_coordinate_systems_shader.fs");
 
@@ -211,8 +218,12 @@ namespace HelloCoordinateSystems {
 		ourShader.setInt("texture1", 0);
 		ourShader.setInt("texture2", 1);
 
+		// The size of the window, or of the scene runner's when it runs this scene
+		int sceneWidth, sceneHeight;
+		GetSceneSize(window, sceneWidth, sceneHeight);
+
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -235,13 +246,12 @@ namespace HelloCoordinateSystems {
 
 			// Note that we're translating the scene in the reverse direction of where we want to move
 			view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
-			projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+			projection = glm::perspective(glm::radians(45.0f), (float)sceneWidth / (float)sceneHeight, 0.1f, 100.0f);
 
-			// Pass transformation matrices to the shader
-			ourShader.setMat4("view", view);
-			// Note: currently we set the projection matrix each frame, but since the
+			// Pass transformation matrices to the shader through the uniform block
+			// Note: currently we upload the projection matrix each frame, but since the
 			// projection matrix rarely changes it's often best practive to set it outside the main loop only once.
-			ourShader.setMat4("projection", projection);
+			frameUniforms.Upload(MakePerFrameUniforms(view, projection, glm::vec3(0.0f, 0.0f, 3.0f), (float)glfwGetTime()));
 
 			// Render boxes
 			glBindVertexArray(VAO);
@@ -255,7 +265,7 @@ namespace HelloCoordinateSystems {
 				else
 					angle = (float)glfwGetTime() * 25.0f;
 				model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-				ourShader.setMat4("model", model);
+				ourShader.setMat3x4("model", Affine(model).Rows);
 
 				glDrawArrays(GL_TRIANGLES, 0, 36);
 			}
@@ -268,9 +278,10 @@ namespace HelloCoordinateSystems {
 		// Clean up
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
+		frameUniforms.Release();
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -291,9 +302,4 @@ namespace HelloCoordinateSystems {
 
 }
 
-//int main()
-//{
-//
-//	return HelloCoordinateSystems::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloCoordinateSystems", HelloCoordinateSystems::main);
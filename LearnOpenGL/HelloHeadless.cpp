@@ -0,0 +1,194 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include "shader_m.h"
+#include "camera.h"
+#include "texture.h"
+#include "mesh.h"
+#include "mesh_primitives.h"
+#include "affine.h"
+#include "culling.h"
+#include "frame_ring_buffer.h"
+#include "frame_uniforms.h"
+#include "indirect_draw.h"
+#include "headless.h"
+#include "scene_runner.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace HelloHeadless {
+
+	// Settings
+	const int GRID_SIZE = 16;
+	const unsigned int MESH_COUNT = 16;
+	const float PATH_SECONDS = 10.0f;	// Length of the camera flight, spread over all frames
+
+	// Renders the multi-draw indirect scene without a window: a fixed number of frames along a
+	// scripted camera path into an offscreen target, read back asynchronously, every 60th frame
+	// saved as a PNG, and the frames per second of the whole pipeline printed at the end.
+	int main()
+	{
+		HeadlessSettings settings;
+		settings.Width = 1280;
+		settings.Height = 720;
+		settings.Frames = 600;
+		settings.WriteEvery = 60;
+		settings.OutputPrefix = "headless_";
+
+		// Under the scene runner, its window (hidden with --headless) provides the context and it
+		// decides size and frames
+		SceneRunner* runner = SceneRunner::GetActive();
+		GLFWwindow* window;
+		if (runner != NULL) {
+			window = CreateSceneWindow(settings.Width, settings.Height, "LearnOpenGL");
+			settings.Width = runner->Settings.Width;
+			settings.Height = runner->Settings.Height;
+			settings.Egl = runner->Settings.Egl;
+			if (runner->Settings.Frames > 0)
+				settings.Frames = runner->Settings.Frames;
+		}
+		else
+			window = CreateHeadlessContext(settings.Egl);
+		if (window == NULL) {
+			ReleaseScene();
+			return -1;
+		}
+
+		HeadlessRenderer renderer;
+		if (!renderer.Create(settings)) {
+			renderer.Release();
+			ReleaseScene();
+			return -1;
+		}
+
+		// Enable depth checking
+		glEnable(GL_DEPTH_TEST);
+
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
+		// Build shaders
+		Shader ourShader("Assets//Shaders//instanced_shader.vs", "Assets//Shaders//hello_coordinate_systems_shader.fs");
+
+		// Spheres and tori in one pool, a cube of objects cycling through them
+		std::vector<MeshData> meshData;
+		unsigned int vertexCount = 0, indexCount = 0;
+		for (unsigned int i = 0; i < MESH_COUNT; i++) {
+			unsigned int detail = 6 + i % 8 * 3;
+			if (i % 2 == 0)
+				meshData.push_back(GenerateSphere(detail, detail * 2, 0.3f + i % 5 * 0.05f));
+			else
+				meshData.push_back(GenerateTorus(detail * 2, detail, 0.35f + i % 3 * 0.05f, 0.1f + i % 4 * 0.02f));
+			vertexCount += meshData.back().VertexCount;
+			indexCount += (unsigned int) meshData.back().Indices.size();
+		}
+		MeshPool pool;
+		FrameRingBuffer frameData;
+		unsigned int textures[2] = { 0, 0 };
+
+		// Releases everything the scene created, on every way out
+		auto release = [&]() {
+			renderer.Release();
+			pool.Release();
+			frameData.Release();
+			frameUniforms.Release();
+			glDeleteProgram(ourShader.ID);
+			glDeleteTextures(2, textures);
+			ReleaseScene();
+		};
+
+		const MeshData& first = meshData[0];
+		pool.Create(&first.Attributes[0], (unsigned int) first.Attributes.size(), first.VertexStride, vertexCount, indexCount, MESH_COUNT);
+		std::vector<int> meshes;
+		for (unsigned int i = 0; i < MESH_COUNT; i++)
+			meshes.push_back(pool.Add(meshData[i].View()));
+		meshData.clear();
+
+		std::vector<int> objectMeshes;
+		std::vector<Affine> objectModels;
+		BoundingSpheres objectBounds;
+		for (int x = 0; x < GRID_SIZE; x++) {
+			for (int y = 0; y < GRID_SIZE; y++) {
+				for (int z = 0; z < GRID_SIZE; z++) {
+					int mesh = meshes[(x * 7 + y * 3 + z) % MESH_COUNT];
+					glm::vec3 position = glm::vec3(x, y, z) * 1.5f - glm::vec3(GRID_SIZE * 0.75f);
+					glm::mat3 rotation = glm::mat3(glm::rotate(glm::mat4(), (x + y + z) * 0.3f, glm::normalize(glm::vec3(sin(x * 0.7f), cos(y * 1.3f), sin(z * 2.1f) + 0.1f))));
+					objectMeshes.push_back(mesh);
+					objectModels.push_back(Affine(rotation, position));
+
+					const PooledMesh& pooled = pool.Get(mesh);
+					objectBounds.Add(position + rotation * ((pooled.BoundsMin + pooled.BoundsMax) * 0.5f), glm::length(pooled.BoundsMax - pooled.BoundsMin) * 0.5f);
+				}
+			}
+		}
+		std::vector<unsigned int> visibleObjects;
+
+		if (!frameData.Create((GLsizeiptr) objectMeshes.size() * (sizeof(DrawElementsIndirectCommand) + sizeof(Affine)) + 4096)) {
+			release();
+			return -1;
+		}
+		IndirectBatch batch;
+
+		// Textures, decoded in parallel
+		const char* texturePaths[] = { "Assets//Textures//container.jpg", "Assets//Textures//awesomeface.png" };
+		LoadTextures(texturePaths, 2, textures);
+
+		// Tell openGL for each sampler to which texure unit it belongs to
+		ourShader.use();
+		ourShader.setInt("texture1", 0);
+		ourShader.setInt("texture2", 1);
+
+		// Around the cube, then through it
+		float extent = GRID_SIZE * 0.75f;
+		Camera camera;
+		camera.SetPerspective((float) settings.Width / (float) settings.Height, 0.1f, 100.0f);
+		CameraPath path;
+		path.Add(0.0f, glm::vec3(0.0f, 0.0f, extent * 2.5f), glm::vec3(0.0f));
+		path.Add(2.5f, glm::vec3(extent * 2.5f, extent, 0.0f), glm::vec3(0.0f));
+		path.Add(5.0f, glm::vec3(0.0f, extent * 0.5f, -extent * 2.5f), glm::vec3(0.0f));
+		path.Add(7.5f, glm::vec3(-extent * 0.5f, 0.0f, 0.0f), glm::vec3(extent, 0.0f, 0.0f));
+		path.Add(PATH_SECONDS, glm::vec3(extent * 2.0f, 0.0f, extent), glm::vec3(0.0f));
+
+		for (unsigned int frame = 0; SceneRunning(window) && frame < settings.Frames; frame++) {
+			// Time follows the frame number, not the clock, so every run renders the same images
+			float time = PATH_SECONDS * frame / glm::max(settings.Frames - 1, 1u);
+			path.Apply(camera, time);
+
+			unsigned int visibleCount = CullSpheres(camera.GetFrustum(), objectBounds, visibleObjects);
+			batch.Begin();
+			for (unsigned int v = 0; v < visibleCount; v++) {
+				unsigned int i = visibleObjects[v];
+				batch.Add(pool, objectMeshes[i], objectModels[i]);
+			}
+			frameData.BeginFrame();
+			batch.Upload(frameData);
+			frameUniforms.Upload(MakePerFrameUniforms(camera, time), frameData);
+			frameData.FinishWrites();
+
+			renderer.BeginFrame();
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, textures[0]);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, textures[1]);
+			ourShader.use();
+			batch.Draw(pool, frameData);
+			frameData.EndFrame();
+			pool.EndFrame();
+			renderer.EndFrame();
+		}
+
+		HeadlessStats stats = renderer.Finish();
+		std::cout << stats.Frames << " frames at " << settings.Width << "x" << settings.Height << " in " << stats.Seconds << " s: " << stats.FramesPerSecond << " frames/s, "
+			<< stats.ReadbackStalls << " readback stalls, " << stats.FilesWritten << " files written (" << stats.BytesWritten / (1024 * 1024) << " MB), "
+			<< stats.WriterWaits << " writer waits" << std::endl;
+
+		// Clean up, and clear all previously allocated GLFW resources
+		release();
+		return 0;
+	}
+}
+
+static SceneRegistrar registrar("HelloHeadless", HelloHeadless::main);
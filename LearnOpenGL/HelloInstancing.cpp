@@ -0,0 +1,298 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <string>
+#include "shader_m.h"
+#include "camera.h"
+#include "texture.h"
+#include "mesh.h"
+#include "mesh_primitives.h"
+#include "batch_transform.h"
+#include "affine.h"
+#include "dynamic_resolution.h"
+#include "frame_ring_buffer.h"
+#include "frame_uniforms.h"
+#include "frame_loop.h"
+#include "input_queue.h"
+#include "scene_runner.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace HelloInstancing {
+
+	// Functions
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+	void processInput(GLFWwindow *window, float deltaTime);
+
+	// Settings
+	const unsigned int SCR_WIDTH = 800;
+	const unsigned int SCR_HEIGHT = 600;
+	const int GRID_SIZE = 32;
+	const float SPIN_SPEED = 1.0f;
+
+	// Camera
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+	// The scene's offscreen target, scaled to hold the GPU budget
+	DynamicResolution resolution;
+
+	// Keyboard, mouse and scroll events recorded by the GLFW callbacks
+	InputQueue input;
+
+	// Simulated state, advanced at a fixed tick rate and interpolated between ticks for rendering
+	struct SceneState
+	{
+		glm::vec3 CameraPosition;
+	};
+
+	int main()
+	{
+		// Initialize the GLFW library
+		glfwInit();
+
+		// Tell GLFW  that the major and minor version of OpenGL to use is 3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create a window and it's context
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
+
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Set the current context
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		// Queue up input events for the simulation ticks
+		input.Attach(window);
+
+		// Tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		// Initialize GLAD before we call any OpenGL function
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Enable depth checking
+		glEnable(GL_DEPTH_TEST);
+
+		// The camera matrices go to all shaders through the PerFrame uniform block, written into the
+		// frame ring buffer along with the instances
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
+		// Build shaders
+		Shader ourShader("Assets//Shaders//instanced_shader.vs", "Assets//Shaders//hello_coordinate_systems_shader.fs");
+
+		MeshData torus = GenerateTorus(16, 8, 0.4f, 0.15f);
+		Mesh mesh;
+		mesh.Upload(torus.View());
+		FrameRingBuffer frameData;
+		unsigned int textures[2] = { 0, 0 };
+
+		// Releases everything the scene created, on every way out
+		auto release = [&]() {
+			mesh.Release();
+			resolution.Release();
+			frameData.Release();
+			frameUniforms.Release();
+			glDeleteProgram(ourShader.ID);
+			glDeleteTextures(2, textures);
+			ReleaseScene();
+		};
+
+		// Reverse-Z with a float depth buffer, so nothing is clipped in the distance. The window
+		// framebuffer can't be asked for float depth, so the scene is drawn offscreen and upscaled,
+		// at a resolution between half and full window size that keeps it within 12 ms on the GPU.
+		camera.SetDepthMode(DEPTH_REVERSE_Z);
+		int sceneWidth, sceneHeight;
+		GetSceneSize(window, sceneWidth, sceneHeight);
+		DynamicResolutionSettings resolutionSettings;
+		resolutionSettings.TargetMilliseconds = 12.0;
+		if (!resolution.Create(sceneWidth, sceneHeight, resolutionSettings)) {
+			release();
+			return -1;
+		}
+
+		// A cube of tori, each spinning around its own axis
+		TransformBatch transforms;
+		std::vector<float> startAngles;
+		for (int x = 0; x < GRID_SIZE; x++) {
+			for (int y = 0; y < GRID_SIZE; y++) {
+				for (int z = 0; z < GRID_SIZE; z++) {
+					glm::vec3 position = glm::vec3(x, y, z) * 1.5f - glm::vec3(GRID_SIZE * 0.75f, GRID_SIZE * 0.75f, GRID_SIZE * 1.5f);
+					glm::vec3 axis(sin(x * 0.7f), cos(y * 1.3f), sin(z * 2.1f) + 0.1f);
+					startAngles.push_back((x + y + z) * 0.3f);
+					transforms.Add(position, axis, startAngles.back());
+				}
+			}
+		}
+
+		// The instance data is one affine model matrix (three rows, 48 bytes) per torus, rebuilt
+		// every frame into the frame ring buffer. The VAO reads it as a mat3x4 attribute occupying
+		// three locations, advanced once per instance.
+		GLsizeiptr instanceBytes = (GLsizeiptr) transforms.Count * sizeof(Affine);
+		if (!frameData.Create(instanceBytes + 4096)) {
+			release();
+			return -1;
+		}
+
+		glBindVertexArray(mesh.VAO);
+		for (GLuint row = 0; row < 3; row++) {
+			glEnableVertexAttribArray(ATTRIBUTE_INSTANCE_MODEL + row);
+			glVertexAttribDivisor(ATTRIBUTE_INSTANCE_MODEL + row, 1);
+		}
+		glBindVertexArray(0);
+		float lastTitleUpdate = 0.0f;
+
+		// Textures, decoded in parallel
+		const char* texturePaths[] = { "Assets//Textures//container.jpg", "Assets//Textures//awesomeface.png" };
+		LoadTextures(texturePaths, 2, textures);
+		unsigned int texture1 = textures[0];
+		unsigned int texture2 = textures[1];
+
+		// Tell openGL for each sampler to which texure unit it belongs to
+		ourShader.use();
+		ourShader.setInt("texture1", 0);
+		ourShader.setInt("texture2", 1);
+
+		// The camera caches its projection and only rebuilds it when Zoom changes
+		camera.SetPerspective((float) sceneWidth / (float) sceneHeight, 0.1f, 100.0f);
+
+		// Each frame polls the events first, so the ticks right after see the latest input
+		auto beginFrame = [&]() {
+			glfwPollEvents();
+			return SceneRunning(window);
+		};
+
+		// Input moves the camera once per tick
+		auto simulate = [&](SceneState& state, double tickSeconds) {
+			camera.Position = state.CameraPosition;
+			processInput(window, (float) tickSeconds);
+			state.CameraPosition = camera.Position;
+		};
+
+		// Rendering happens once per frame, with the camera placed between the last two ticks
+		auto render = [&](const SceneState& previous, const SceneState& current, float alpha) {
+			camera.Position = glm::mix(previous.CameraPosition, current.CameraPosition, alpha);
+			float currentFrame = (float) glfwGetTime();
+
+			// Spin every torus and build all model matrices straight into this frame's slice of
+			// the ring buffer, then point the instance attributes at it. The slice was last read
+			// FRAME_RING_FRAMES frames ago, so there is normally nothing to wait for.
+			for (unsigned int i = 0; i < transforms.Count; i++)
+				transforms.RotationW[i] = startAngles[i] + currentFrame * SPIN_SPEED;
+
+			double buildStart = glfwGetTime();
+			frameData.BeginFrame();
+			GLintptr instanceOffset;
+			Affine* instances = (Affine*) frameData.Allocate(instanceBytes, 16, instanceOffset);
+			if (instances != NULL)
+				BuildTransformsParallel(transforms, instances);
+			frameUniforms.Upload(MakePerFrameUniforms(camera, currentFrame), frameData);
+			frameData.FinishWrites();
+			double buildTime = glfwGetTime() - buildStart;
+
+			glBindVertexArray(mesh.VAO);
+			glBindBuffer(GL_ARRAY_BUFFER, frameData.Buffer);
+			for (GLuint row = 0; row < 3; row++)
+				glVertexAttribPointer(ATTRIBUTE_INSTANCE_MODEL + row, 4, GL_FLOAT, GL_FALSE, sizeof(Affine), (void*)(instanceOffset + row * sizeof(glm::vec4)));
+
+			// Rendering
+			resolution.BeginScene();
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Bind textures on corresponding texture units
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2);
+
+			// Activate shader
+			ourShader.use();
+
+			// All tori in one draw
+			if (instances != NULL)
+				glDrawElementsInstanced(GL_TRIANGLES, mesh.IndexCount, mesh.IndexType, 0, transforms.Count);
+			glBindVertexArray(0);
+			resolution.EndScene();
+			frameData.EndFrame();
+
+			resolution.BlitToScreen();
+
+			// Show how long building and uploading the matrices took, and how often the CPU had to
+			// wait for the GPU to release a slice
+			if (currentFrame - lastTitleUpdate > 0.5f) {
+				FrameRingStats ringStats = frameData.GetStats();
+				DynamicResolutionStats resolutionStats = resolution.GetStats();
+				std::string title = "LearnOpenGL - " + std::to_string(transforms.Count) + " matrices in " + std::to_string(buildTime * 1000.0) + " ms, "
+					+ std::to_string(ringStats.Stalls) + " stalls (" + std::to_string(ringStats.StallMilliseconds) + " ms)" + (frameData.Persistent ? ", persistent" : "")
+					+ ", " + std::to_string(resolutionStats.RenderWidth) + "x" + std::to_string(resolutionStats.RenderHeight) + " at " + std::to_string(resolutionStats.GpuMilliseconds) + " ms GPU";
+				glfwSetWindowTitle(window, title.c_str());
+				lastTitleUpdate = currentFrame;
+			}
+
+			// Swap the buffers
+			glfwSwapBuffers(window);
+		};
+
+		// game / render loop
+		SceneState initial;
+		initial.CameraPosition = camera.Position;
+		FrameLoop<SceneState> loop;
+		loop.Run(initial, simulate, render, beginFrame);
+
+		// Clean up, and clear all previously allocated GLFW resources
+		release();
+		return 0;
+	}
+
+	// GLFW: Whenever the window size changed (by OS or user resize) this callback function executes
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+	{
+		glViewport(0, 0, width, height);
+		resolution.Resize(width, height);
+	}
+
+	// Process all input : apply the events queued since the last tick and react to the keys held down
+	void processInput(GLFWwindow *window, float deltaTime)
+	{
+		input.Drain();
+
+		if (input.IsKeyDown(GLFW_KEY_ESCAPE))
+			glfwSetWindowShouldClose(window, true);
+
+		// Control camera
+		if (input.IsKeyDown(GLFW_KEY_W))
+			camera.ProcessKeyboard(FORWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_S))
+			camera.ProcessKeyboard(BACKWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_A))
+			camera.ProcessKeyboard(LEFT, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_D))
+			camera.ProcessKeyboard(RIGHT, deltaTime);
+
+		// All mouse movement since the last tick turns the camera at once
+		glm::vec2 mouse = input.TakeMouseDelta();
+		if (mouse.x != 0.0f || mouse.y != 0.0f)
+			camera.ProcessMouseMovement(mouse.x, -mouse.y); // Reversed since y-coordinates go from bottom to top
+
+		glm::vec2 scroll = input.TakeScrollDelta();
+		if (scroll.y != 0.0f)
+			camera.ProcessMouseScroll(scroll.y);
+	}
+}
+
+static SceneRegistrar registrar("HelloInstancing", HelloInstancing::main);
@@ -0,0 +1,282 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <string>
+#include "shader_m.h"
+#include "camera.h"
+#include "texture.h"
+#include "mesh.h"
+#include "mesh_primitives.h"
+#include "affine.h"
+#include "culling.h"
+#include "frame_ring_buffer.h"
+#include "frame_uniforms.h"
+#include "indirect_draw.h"
+#include "frame_loop.h"
+#include "input_queue.h"
+#include "scene_runner.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace HelloMultiDrawIndirect {
+
+	// Functions
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+	void processInput(GLFWwindow *window, float deltaTime);
+
+	// Settings
+	const unsigned int SCR_WIDTH = 800;
+	const unsigned int SCR_HEIGHT = 600;
+	const int GRID_SIZE = 24;
+	const unsigned int MESH_COUNT = 64;
+
+	// Camera
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+	// Keyboard, mouse and scroll events recorded by the GLFW callbacks
+	InputQueue input;
+
+	// Simulated state, advanced at a fixed tick rate and interpolated between ticks for rendering
+	struct SceneState
+	{
+		glm::vec3 CameraPosition;
+	};
+
+	int main()
+	{
+		// Initialize the GLFW library
+		glfwInit();
+
+		// Tell GLFW  that the major and minor version of OpenGL to use is 3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create a window and it's context
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
+
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Set the current context
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		// Queue up input events for the simulation ticks
+		input.Attach(window);
+
+		// Tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		// Initialize GLAD before we call any OpenGL function
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Enable depth checking
+		glEnable(GL_DEPTH_TEST);
+
+		// The camera matrices go to all shaders through the PerFrame uniform block, written into the
+		// frame ring buffer along with the draw commands
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
+		// Build shaders
+		Shader ourShader("Assets//Shaders//instanced_shader.vs", "Assets//Shaders//hello_coordinate_systems_shader.fs");
+
+		// Many different meshes, spheres and tori of all sizes and tessellations, all copied into
+		// one pool so any mix of them is drawn with a single call
+		std::vector<MeshData> meshData;
+		unsigned int vertexCount = 0, indexCount = 0;
+		for (unsigned int i = 0; i < MESH_COUNT; i++) {
+			unsigned int detail = 6 + i % 8 * 3;
+			if (i % 2 == 0)
+				meshData.push_back(GenerateSphere(detail, detail * 2, 0.3f + i % 5 * 0.05f));
+			else
+				meshData.push_back(GenerateTorus(detail * 2, detail, 0.35f + i % 3 * 0.05f, 0.1f + i % 4 * 0.02f));
+			vertexCount += meshData.back().VertexCount;
+			indexCount += (unsigned int) meshData.back().Indices.size();
+		}
+		MeshPool pool;
+		FrameRingBuffer frameData;
+		unsigned int textures[2] = { 0, 0 };
+
+		// Releases everything the scene created, on every way out
+		auto release = [&]() {
+			pool.Release();
+			frameData.Release();
+			frameUniforms.Release();
+			glDeleteProgram(ourShader.ID);
+			glDeleteTextures(2, textures);
+			ReleaseScene();
+		};
+
+		const MeshData& first = meshData[0];
+		pool.Create(&first.Attributes[0], (unsigned int) first.Attributes.size(), first.VertexStride, vertexCount, indexCount, MESH_COUNT);
+		std::vector<int> meshes;
+		for (unsigned int i = 0; i < MESH_COUNT; i++)
+			meshes.push_back(pool.Add(meshData[i].View()));
+		meshData.clear();
+
+		// A cube of objects cycling through the meshes, so neighbours never share one
+		std::vector<int> objectMeshes;
+		std::vector<Affine> objectModels;
+		BoundingSpheres objectBounds;
+		for (int x = 0; x < GRID_SIZE; x++) {
+			for (int y = 0; y < GRID_SIZE; y++) {
+				for (int z = 0; z < GRID_SIZE; z++) {
+					int mesh = meshes[(x * 7 + y * 3 + z) % MESH_COUNT];
+					glm::vec3 position = glm::vec3(x, y, z) * 1.5f - glm::vec3(GRID_SIZE * 0.75f, GRID_SIZE * 0.75f, GRID_SIZE * 1.5f);
+					glm::mat3 rotation = glm::mat3(glm::rotate(glm::mat4(), (x + y + z) * 0.3f, glm::normalize(glm::vec3(sin(x * 0.7f), cos(y * 1.3f), sin(z * 2.1f) + 0.1f))));
+					objectMeshes.push_back(mesh);
+					objectModels.push_back(Affine(rotation, position));
+
+					const PooledMesh& pooled = pool.Get(mesh);
+					objectBounds.Add(position + rotation * ((pooled.BoundsMin + pooled.BoundsMax) * 0.5f), glm::length(pooled.BoundsMax - pooled.BoundsMin) * 0.5f);
+				}
+			}
+		}
+		std::vector<unsigned int> visibleObjects;
+
+		// Each frame's commands (20 bytes) and model matrices (48 bytes) go through the ring
+		if (!frameData.Create((GLsizeiptr) objectMeshes.size() * (sizeof(DrawElementsIndirectCommand) + sizeof(Affine)) + 4096)) {
+			release();
+			return -1;
+		}
+		IndirectBatch batch;
+		float lastTitleUpdate = 0.0f;
+
+		// Textures, decoded in parallel
+		const char* texturePaths[] = { "Assets//Textures//container.jpg", "Assets//Textures//awesomeface.png" };
+		LoadTextures(texturePaths, 2, textures);
+		unsigned int texture1 = textures[0];
+		unsigned int texture2 = textures[1];
+
+		// Tell openGL for each sampler to which texure unit it belongs to
+		ourShader.use();
+		ourShader.setInt("texture1", 0);
+		ourShader.setInt("texture2", 1);
+
+		// The camera caches its projection and only rebuilds it when Zoom changes
+		int sceneWidth, sceneHeight;
+		GetSceneSize(window, sceneWidth, sceneHeight);
+		camera.SetPerspective((float) sceneWidth / (float) sceneHeight, 0.1f, 100.0f);
+
+		// Each frame polls the events first, so the ticks right after see the latest input
+		auto beginFrame = [&]() {
+			glfwPollEvents();
+			return SceneRunning(window);
+		};
+
+		// Input moves the camera once per tick
+		auto simulate = [&](SceneState& state, double tickSeconds) {
+			camera.Position = state.CameraPosition;
+			processInput(window, (float) tickSeconds);
+			state.CameraPosition = camera.Position;
+		};
+
+		// Rendering happens once per frame, with the camera placed between the last two ticks
+		auto render = [&](const SceneState& previous, const SceneState& current, float alpha) {
+			camera.Position = glm::mix(previous.CameraPosition, current.CameraPosition, alpha);
+			float currentFrame = (float) glfwGetTime();
+
+			// Cull, then turn the visible objects into draw commands and hand them to the GPU
+			double submitStart = glfwGetTime();
+			unsigned int visibleCount = CullSpheres(camera.GetFrustum(), objectBounds, visibleObjects);
+			batch.Begin();
+			for (unsigned int v = 0; v < visibleCount; v++) {
+				unsigned int i = visibleObjects[v];
+				batch.Add(pool, objectMeshes[i], objectModels[i]);
+			}
+
+			frameData.BeginFrame();
+			batch.Upload(frameData);
+			frameUniforms.Upload(MakePerFrameUniforms(camera, currentFrame), frameData);
+			frameData.FinishWrites();
+			double submitTime = glfwGetTime() - submitStart;
+
+			// Rendering
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Bind textures on corresponding texture units
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2);
+
+			// Activate shader
+			ourShader.use();
+
+			// Every visible object, whatever its mesh, in one call
+			batch.Draw(pool, frameData);
+			frameData.EndFrame();
+			pool.EndFrame();
+
+			// Show how many draws the single call replaced and what building them cost
+			if (currentFrame - lastTitleUpdate > 0.5f) {
+				std::string title = "LearnOpenGL - " + std::to_string(batch.GetCommandCount()) + " draws of " + std::to_string(MESH_COUNT) + " meshes in "
+					+ (IndirectBatch::IsMultiDrawSupported() ? "1 call" : std::to_string(batch.GetCommandCount()) + " calls") + ", built in " + std::to_string(submitTime * 1000.0) + " ms";
+				glfwSetWindowTitle(window, title.c_str());
+				lastTitleUpdate = currentFrame;
+			}
+
+			// Swap the buffers
+			glfwSwapBuffers(window);
+		};
+
+		// game / render loop
+		SceneState initial;
+		initial.CameraPosition = camera.Position;
+		FrameLoop<SceneState> loop;
+		loop.Run(initial, simulate, render, beginFrame);
+
+		// Clean up, and clear all previously allocated GLFW resources
+		release();
+		return 0;
+	}
+
+	// GLFW: Whenever the window size changed (by OS or user resize) this callback function executes
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+	{
+		glViewport(0, 0, width, height);
+	}
+
+	// Process all input : apply the events queued since the last tick and react to the keys held down
+	void processInput(GLFWwindow *window, float deltaTime)
+	{
+		input.Drain();
+
+		if (input.IsKeyDown(GLFW_KEY_ESCAPE))
+			glfwSetWindowShouldClose(window, true);
+
+		// Control camera
+		if (input.IsKeyDown(GLFW_KEY_W))
+			camera.ProcessKeyboard(FORWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_S))
+			camera.ProcessKeyboard(BACKWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_A))
+			camera.ProcessKeyboard(LEFT, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_D))
+			camera.ProcessKeyboard(RIGHT, deltaTime);
+
+		// All mouse movement since the last tick turns the camera at once
+		glm::vec2 mouse = input.TakeMouseDelta();
+		if (mouse.x != 0.0f || mouse.y != 0.0f)
+			camera.ProcessMouseMovement(mouse.x, -mouse.y); // Reversed since y-coordinates go from bottom to top
+
+		glm::vec2 scroll = input.TakeScrollDelta();
+		if (scroll.y != 0.0f)
+			camera.ProcessMouseScroll(scroll.y);
+	}
+}
+
+static SceneRegistrar registrar("HelloMultiDrawIndirect", HelloMultiDrawIndirect::main);
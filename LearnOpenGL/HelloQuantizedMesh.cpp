@@ -0,0 +1,231 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include "shader_m.h"
+#include "camera.h"
+#include "texture.h"
+#include "mesh.h"
+#include "mesh_primitives.h"
+#include "vertex_quantization.h"
+#include "affine.h"
+#include "frame_uniforms.h"
+#include "frame_loop.h"
+#include "input_queue.h"
+#include "scene_runner.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace HelloQuantizedMesh {
+
+	// Functions
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+	void processInput(GLFWwindow *window, float deltaTime);
+
+	// Settings
+	const unsigned int SCR_WIDTH = 800;
+	const unsigned int SCR_HEIGHT = 600;
+
+	// Camera
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+
+	// Keyboard, mouse and scroll events recorded by the GLFW callbacks
+	InputQueue input;
+
+	// Simulated state, advanced at a fixed tick rate and interpolated between ticks for rendering
+	struct SceneState
+	{
+		glm::vec3 CameraPosition;
+	};
+
+	int main()
+	{
+		// Initialize the GLFW library
+		glfwInit();
+
+		// Tell GLFW  that the major and minor version of OpenGL to use is 3
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		// Create a window and it's context
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
+
+		if (window == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Set the current context
+		glfwMakeContextCurrent(window);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		// Queue up input events for the simulation ticks
+		input.Attach(window);
+
+		// Tell GLFW to capture our mouse
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+		// Initialize GLAD before we call any OpenGL function
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cout << "Failed to initialize GLAD" << std::endl;
+			ReleaseScene();
+			return -1;
+		}
+
+		// Enable depth checking
+		glEnable(GL_DEPTH_TEST);
+
+		// The camera matrices go to all shaders through the PerFrame uniform block
+		PerFrameUniformBuffer frameUniforms;
+		frameUniforms.Create();
+
+		// Build shaders
+		Shader ourShader("Assets//Shaders//quantized_mesh_shader.vs", "Assets//Shaders//quantized_mesh_shader.fs");
+
+		// Build a float mesh and its compressed version
+		MeshData sphere = GenerateSphere(64, 128, 0.5f);
+		MeshData quantized = QuantizeMesh(sphere, POSITION_UNORM16);
+
+		std::cout << "Float vertices:     " << sphere.VertexStride << " bytes/vertex, " << sphere.Vertices.size() << " bytes" << std::endl;
+		std::cout << "Quantized vertices: " << quantized.VertexStride << " bytes/vertex, " << quantized.Vertices.size() << " bytes" << std::endl;
+
+		Mesh mesh;
+		mesh.Upload(quantized.View());
+
+		glm::vec3 positionOffset, positionScale;
+		GetPositionDequantization(quantized, positionOffset, positionScale);
+
+		glm::vec3 spherePositions[] = {
+			glm::vec3(0.0f,  0.0f,  0.0f),
+			glm::vec3(2.0f,  5.0f, -15.0f),
+			glm::vec3(-1.5f, -2.2f, -2.5f),
+			glm::vec3(-3.8f, -2.0f, -12.3f),
+			glm::vec3(2.4f, -0.4f, -3.5f),
+			glm::vec3(-1.7f,  3.0f, -7.5f),
+			glm::vec3(1.3f, -2.0f, -2.5f),
+			glm::vec3(1.5f,  2.0f, -2.5f),
+			glm::vec3(1.5f,  0.2f, -1.5f),
+			glm::vec3(-1.3f,  1.0f, -1.5f)
+		};
+
+		// Textures
+		unsigned int texture1 = LoadTexture("Assets//Textures//container.jpg");
+		unsigned int texture2 = LoadTexture("Assets//Textures//awesomeface.png");
+
+		// Tell openGL for each sampler to which texure unit it belongs to
+		ourShader.use();
+		ourShader.setInt("texture1", 0);
+		ourShader.setInt("texture2", 1);
+		ourShader.setVec3("positionOffset", positionOffset);
+		ourShader.setVec3("positionScale", positionScale);
+
+		// The camera caches its projection and only rebuilds it when Zoom changes
+		int sceneWidth, sceneHeight;
+		GetSceneSize(window, sceneWidth, sceneHeight);
+		camera.SetPerspective((float) sceneWidth / (float) sceneHeight, 0.1f, 100.0f);
+
+		// Each frame polls the events first, so the ticks right after see the latest input
+		auto beginFrame = [&]() {
+			glfwPollEvents();
+			return SceneRunning(window);
+		};
+
+		// Input moves the camera once per tick
+		auto simulate = [&](SceneState& state, double tickSeconds) {
+			camera.Position = state.CameraPosition;
+			processInput(window, (float) tickSeconds);
+			state.CameraPosition = camera.Position;
+		};
+
+		// Rendering happens once per frame, with the camera placed between the last two ticks
+		auto render = [&](const SceneState& previous, const SceneState& current, float alpha) {
+			camera.Position = glm::mix(previous.CameraPosition, current.CameraPosition, alpha);
+			float currentFrame = (float) glfwGetTime();
+
+			// Rendering
+			glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Bind textures on corresponding texture units
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, texture1);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2);
+
+			// Activate shader
+			ourShader.use();
+
+			frameUniforms.Upload(MakePerFrameUniforms(camera, currentFrame));
+
+			// Render spheres
+			for (unsigned int i = 0; i < 10; i++) {
+				glm::mat4 model;
+				model = glm::translate(model, spherePositions[i]);
+				float angle = 20.0f * i;
+				model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+				ourShader.setMat3x4("model", Affine(model).Rows);
+
+				mesh.Draw();
+			}
+
+			// Swap the buffers
+			glfwSwapBuffers(window);
+		};
+
+		// game / render loop
+		SceneState initial;
+		initial.CameraPosition = camera.Position;
+		FrameLoop<SceneState> loop;
+		loop.Run(initial, simulate, render, beginFrame);
+
+		// Clean up
+		mesh.Release();
+		frameUniforms.Release();
+		glDeleteTextures(1, &texture1);
+		glDeleteTextures(1, &texture2);
+
+		// clear all previously allocated GLFW resources
+		ReleaseScene();
+		return 0;
+	}
+
+	// GLFW: Whenever the window size changed (by OS or user resize) this callback function executes
+	void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+	{
+		glViewport(0, 0, width, height);
+	}
+
+	// Process all input : apply the events queued since the last tick and react to the keys held down
+	void processInput(GLFWwindow *window, float deltaTime)
+	{
+		input.Drain();
+
+		if (input.IsKeyDown(GLFW_KEY_ESCAPE))
+			glfwSetWindowShouldClose(window, true);
+
+		// Control camera
+		if (input.IsKeyDown(GLFW_KEY_W))
+			camera.ProcessKeyboard(FORWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_S))
+			camera.ProcessKeyboard(BACKWARD, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_A))
+			camera.ProcessKeyboard(LEFT, deltaTime);
+		if (input.IsKeyDown(GLFW_KEY_D))
+			camera.ProcessKeyboard(RIGHT, deltaTime);
+
+		// All mouse movement since the last tick turns the camera at once
+		glm::vec2 mouse = input.TakeMouseDelta();
+		if (mouse.x != 0.0f || mouse.y != 0.0f)
+			camera.ProcessMouseMovement(mouse.x, -mouse.y); // Reversed since y-coordinates go from bottom to top
+
+		glm::vec2 scroll = input.TakeScrollDelta();
+		if (scroll.y != 0.0f)
+			camera.ProcessMouseScroll(scroll.y);
+	}
+}
+
+static SceneRegistrar registrar("HelloQuantizedMesh", HelloQuantizedMesh::main);
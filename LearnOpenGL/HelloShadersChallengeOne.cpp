@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "shader_s.h"
+#include "scene_runner.h"
 
 namespace HelloShadersChallengeOne {
 
@@ -28,11 +29,11 @@ namespace HelloShadersChallengeOne {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -101,7 +102,7 @@ namespace HelloShadersChallengeOne {
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -124,7 +125,7 @@ namespace HelloShadersChallengeOne {
 		glDeleteBuffers(1, &VBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -145,9 +146,4 @@ namespace HelloShadersChallengeOne {
 
 }
 
-//int main()
-//{
-//
-//	return HelloShadersChallengeOne::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloShadersChallengeOne", HelloShadersChallengeOne::main);
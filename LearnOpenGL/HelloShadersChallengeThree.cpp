@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "shader_s.h"
+#include "scene_runner.h"
 
 namespace HelloShadersChallengeThree {
 
@@ -28,11 +29,11 @@ namespace HelloShadersChallengeThree {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -101,7 +102,7 @@ namespace HelloShadersChallengeThree {
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -125,7 +126,7 @@ namespace HelloShadersChallengeThree {
 		glDeleteBuffers(1, &VBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -146,9 +147,4 @@ namespace HelloShadersChallengeThree {
 
 }
 
-//int main()
-//{
-//
-//	return HelloShadersChallengeThree::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloShadersChallengeThree", HelloShadersChallengeThree::main);
@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "shader_s.h"
+#include "scene_runner.h"
 
 namespace HelloShadersChallengeTwo {
 
@@ -28,11 +29,11 @@ namespace HelloShadersChallengeTwo {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -103,7 +104,7 @@ namespace HelloShadersChallengeTwo {
 		float offset = 0.5f;
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -128,7 +129,7 @@ namespace HelloShadersChallengeTwo {
 		glDeleteBuffers(1, &VBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -149,9 +150,4 @@ namespace HelloShadersChallengeTwo {
 
 }
 
-//int main()
-//{
-//
-//	return HelloShadersChallengeTwo::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloShadersChallengeTwo", HelloShadersChallengeTwo::main);
@@ -3,6 +3,7 @@
 #include <iostream>
 #include "shader_s.h"
 #include "stb_image.h"
+#include "scene_runner.h"
 
 namespace HelloTextures {
 
@@ -29,11 +30,11 @@ namespace HelloTextures {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -160,7 +161,7 @@ namespace HelloTextures {
 		ourShader.setInt("texture2", 1);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -191,7 +192,7 @@ namespace HelloTextures {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -212,9 +213,4 @@ namespace HelloTextures {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTextures::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTextures", HelloTextures::main);
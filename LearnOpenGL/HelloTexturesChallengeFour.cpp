@@ -3,6 +3,7 @@
 #include <iostream>
 #include "shader_s.h"
 #include "stb_image.h"
+#include "scene_runner.h"
 
 namespace HelloTexturesChallengeFour {
 
@@ -32,11 +33,11 @@ namespace HelloTexturesChallengeFour {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -165,7 +166,7 @@ namespace HelloTexturesChallengeFour {
 		ourShader.setInt("texture2", 1);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -199,7 +200,7 @@ namespace HelloTexturesChallengeFour {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -232,9 +233,4 @@ namespace HelloTexturesChallengeFour {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTexturesChallengeFour::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTexturesChallengeFour", HelloTexturesChallengeFour::main);
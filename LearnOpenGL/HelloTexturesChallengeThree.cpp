@@ -3,6 +3,7 @@
 #include <iostream>
 #include "shader_s.h"
 #include "stb_image.h"
+#include "scene_runner.h"
 
 namespace HelloTexturesChallengeThree {
 
@@ -29,11 +30,11 @@ namespace HelloTexturesChallengeThree {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -162,7 +163,7 @@ namespace HelloTexturesChallengeThree {
 		ourShader.setInt("texture2", 1);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -193,7 +194,7 @@ namespace HelloTexturesChallengeThree {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -214,9 +215,4 @@ namespace HelloTexturesChallengeThree {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTexturesChallengeThree::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTexturesChallengeThree", HelloTexturesChallengeThree::main);
@@ -3,6 +3,7 @@
 #include <iostream>
 #include "shader_s.h"
 #include "stb_image.h"
+#include "scene_runner.h"
 
 namespace HelloTexturesChallengeOne {
 
@@ -29,11 +30,11 @@ namespace HelloTexturesChallengeOne {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -162,7 +163,7 @@ namespace HelloTexturesChallengeOne {
 		ourShader.setInt("texture2", 1);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -193,7 +194,7 @@ namespace HelloTexturesChallengeOne {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -214,9 +215,4 @@ namespace HelloTexturesChallengeOne {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTexturesChallengeOne::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTexturesChallengeTwo", HelloTexturesChallengeOne::main);
@@ -3,6 +3,7 @@
 #include <iostream>
 #include "shader_s.h"
 #include "stb_image.h"
+#include "scene_runner.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -33,11 +34,11 @@ namespace HelloTransformations {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -161,7 +162,7 @@ namespace HelloTransformations {
 		ourShader.setInt("texture2", 1);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -201,7 +202,7 @@ namespace HelloTransformations {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -222,9 +223,4 @@ namespace HelloTransformations {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTransformations::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTransformations", HelloTransformations::main);
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "scene_runner.h"
 
 namespace HelloTriangle {
 
@@ -42,11 +43,11 @@ namespace HelloTriangle {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -177,7 +178,7 @@ namespace HelloTriangle {
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -202,7 +203,7 @@ namespace HelloTriangle {
 		glDeleteBuffers(1, &EBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -223,9 +224,4 @@ namespace HelloTriangle {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTriangle::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTriangle", HelloTriangle::main);
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "scene_runner.h"
 
 namespace HelloTriangleChallegeOne {
 
@@ -42,11 +43,11 @@ namespace HelloTriangleChallegeOne {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -168,7 +169,7 @@ namespace HelloTriangleChallegeOne {
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -191,7 +192,7 @@ namespace HelloTriangleChallegeOne {
 		glDeleteBuffers(1, &VBO);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -212,9 +213,4 @@ namespace HelloTriangleChallegeOne {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTriangleChallegeOne::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTriangleChallengeOne", HelloTriangleChallegeOne::main);
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "scene_runner.h"
 
 namespace HelloTriangleChallegeThree {
 
@@ -49,11 +50,11 @@ namespace HelloTriangleChallegeThree {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -209,7 +210,7 @@ namespace HelloTriangleChallegeThree {
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -233,7 +234,7 @@ namespace HelloTriangleChallegeThree {
 		}
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -254,9 +255,4 @@ namespace HelloTriangleChallegeThree {
 
 }
 
-//int main() {
-//{
-//
-//	return HelloTriangleChallegeThree::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTriangleChallengeThree", HelloTriangleChallegeThree::main);
@@ -1,6 +1,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include "scene_runner.h"
 
 namespace HelloTriangleChallegeTwo {
 
@@ -42,11 +43,11 @@ namespace HelloTriangleChallegeTwo {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -174,7 +175,7 @@ namespace HelloTriangleChallegeTwo {
 		//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -200,7 +201,7 @@ namespace HelloTriangleChallegeTwo {
 		glDeleteBuffers(2, VBOs);
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -221,9 +222,4 @@ namespace HelloTriangleChallegeTwo {
 
 }
 
-//int main()
-//{
-//
-//	return HelloTriangleChallegeTwo::main();
-//
-//}
\ No newline at end of file
+static SceneRegistrar registrar("HelloTriangleChallengeTwo", HelloTriangleChallegeTwo::main);
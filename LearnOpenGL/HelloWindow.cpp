@@ -2,6 +2,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "HelperFunctions.h"
+#include "scene_runner.h"
 
 // Constants
 const unsigned int SCR_WIDTH = 800;
@@ -33,11 +34,11 @@ namespace HelloWindow {
 		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 		// Create a window and it's context
-		GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");
 
 		if (window == NULL) {
 			std::cout << "Failed to create GLFW window" << std::endl;
-			glfwTerminate();
+			ReleaseScene();
 			return -1;
 		}
 
@@ -58,7 +59,7 @@ namespace HelloWindow {
 		}
 
 		// game / render loop
-		while (!glfwWindowShouldClose(window))
+		while (SceneRunning(window))
 		{
 			// Input
 			processInput(window);
@@ -73,7 +74,7 @@ namespace HelloWindow {
 		}
 
 		// clear all previously allocated GLFW resources
-		glfwTerminate();
+		ReleaseScene();
 		return 0;
 	}
 
@@ -92,4 +93,6 @@ namespace HelloWindow {
 			glfwSetWindowShouldClose(window, true);
 	}
 
-}
\ No newline at end of file
+}
+
+static SceneRegistrar registrar("HelloWindow", HelloWindow::main);
@@ -0,0 +1,41 @@
+#include <iostream>
+#include <string>
+#include "obj_importer.h"
+#include "mesh_binary.h"
+#include "vertex_quantization.h"
+#include "scene_runner.h"
+
+namespace MeshConverter {
+
+	// Converts a Wavefront OBJ file to the binary mesh format read by MeshFile.
+	// -q stores the compressed vertex layout from vertex_quantization.h.
+	int main(int argc, char** argv)
+	{
+		bool quantize = argc > 1 && std::string(argv[1]) == "-q";
+		int first = quantize ? 2 : 1;
+		if (argc < first + 2) {
+			std::cout << "Usage: MeshConverter [-q] <input.obj> <output.mesh>" << std::endl;
+			return -1;
+		}
+		const char* input = argv[first];
+		const char* output = argv[first + 1];
+
+		MeshData mesh;
+		if (!ImportObj(input, mesh))
+			return -1;
+
+		if (quantize)
+			mesh = QuantizeMesh(mesh);
+
+		if (!SaveMeshFile(output, mesh))
+			return -1;
+
+		std::cout << input << " -> " << output << ": "
+			<< mesh.VertexCount << " vertices, "
+			<< mesh.Indices.size() / 3 << " triangles, "
+			<< mesh.VertexStride << " byte stride" << std::endl;
+		return 0;
+	}
+}
+
+static ToolRegistrar registrar("MeshConverter", MeshConverter::main);
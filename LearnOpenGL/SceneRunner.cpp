@@ -0,0 +1,172 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "scene_runner.h"
+
+namespace SceneRunnerMain {
+
+	// Settings
+	const char* DEFAULT_SCENE = "HelloCamera";
+
+	void printUsage()
+	{
+		std::cout << "Usage: LearnOpenGL [--scene <name>|all] [--frames <count>] [--width <pixels>] [--height <pixels>] [--no-vsync] [--headless] [--egl] [--csv <file>] [--list]" << std::endl
+			<< "       LearnOpenGL --benchmark <name>|all" << std::endl
+			<< "       LearnOpenGL --tool <name> [arguments]" << std::endl
+			<< "  Runs " << DEFAULT_SCENE << " until its window is closed without arguments. --frames stops each scene after that many frames." << std::endl
+			<< "  --headless runs the scenes in a hidden window, --egl creates its context through EGL (and implies --headless)." << std::endl
+			<< "  --benchmark and --tool run without a window, --tool passes the arguments after its name on." << std::endl;
+	}
+
+	// Runs one or all benchmarks, each prints its own results
+	int runBenchmarks(const std::string& name)
+	{
+		std::vector<const SceneEntry*> benchmarks;
+		if (name == "all") {
+			for (const SceneEntry& benchmark : GetBenchmarks())
+				benchmarks.push_back(&benchmark);
+		}
+		else {
+			const SceneEntry* benchmark = FindEntry(GetBenchmarks(), name);
+			if (benchmark == NULL) {
+				std::cout << "ERROR::SCENE_RUNNER::UNKNOWN_BENCHMARK: " << name << ", --list shows the benchmarks" << std::endl;
+				return -1;
+			}
+			benchmarks.push_back(benchmark);
+		}
+
+		int result = 0;
+		for (const SceneEntry* benchmark : benchmarks) {
+			std::cout << benchmark->Name << ":" << std::endl;
+			if (benchmark->Main() != 0) {
+				std::cout << benchmark->Name << ": FAILED" << std::endl;
+				result = -1;
+			}
+		}
+		return result;
+	}
+
+	// Runs one or all registered scenes back to back in one window and prints how long each took.
+	// With a frame count and without vsync that is a repeatable performance run, --csv keeps the
+	// numbers for comparing runs.
+	int main(int argc, char** argv)
+	{
+		// Registration follows the link order, list and run the scenes by name instead
+		std::vector<SceneEntry>& registered = GetScenes();
+		std::sort(registered.begin(), registered.end(), [](const SceneEntry& a, const SceneEntry& b) { return a.Name < b.Name; });
+		std::vector<SceneEntry>& benchmarks = GetBenchmarks();
+		std::sort(benchmarks.begin(), benchmarks.end(), [](const SceneEntry& a, const SceneEntry& b) { return a.Name < b.Name; });
+		std::vector<ToolEntry>& tools = GetTools();
+		std::sort(tools.begin(), tools.end(), [](const ToolEntry& a, const ToolEntry& b) { return a.Name < b.Name; });
+
+		SceneRunSettings settings;
+		std::string sceneName = DEFAULT_SCENE;
+		std::string csvPath;
+		for (int i = 1; i < argc; i++) {
+			std::string argument = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (argument == "--list") {
+				for (const SceneEntry& scene : GetScenes())
+					std::cout << scene.Name << std::endl;
+				for (const SceneEntry& benchmark : GetBenchmarks())
+					std::cout << "--benchmark " << benchmark.Name << std::endl;
+				for (const ToolEntry& tool : GetTools())
+					std::cout << "--tool " << tool.Name << std::endl;
+				return 0;
+			}
+			else if (argument == "--benchmark" && hasValue)
+				return runBenchmarks(argv[i + 1]);
+			else if (argument == "--tool" && hasValue) {
+				// The tool takes the rest of the command line, its name in place of the program's
+				const ToolEntry* tool = FindEntry(GetTools(), argv[i + 1]);
+				if (tool == NULL) {
+					std::cout << "ERROR::SCENE_RUNNER::UNKNOWN_TOOL: " << argv[i + 1] << ", --list shows the tools" << std::endl;
+					return -1;
+				}
+				return tool->Main(argc - i - 1, argv + i + 1);
+			}
+			else if (argument == "--scene" && hasValue)
+				sceneName = argv[++i];
+			else if (argument == "--frames" && hasValue)
+				settings.Frames = (unsigned int) std::strtoul(argv[++i], NULL, 10);
+			else if (argument == "--width" && hasValue)
+				settings.Width = std::atoi(argv[++i]);
+			else if (argument == "--height" && hasValue)
+				settings.Height = std::atoi(argv[++i]);
+			else if (argument == "--no-vsync")
+				settings.VSync = false;
+			else if (argument == "--headless")
+				settings.Headless = true;
+			else if (argument == "--egl")
+				settings.Headless = settings.Egl = true;
+			else if (argument == "--csv" && hasValue)
+				csvPath = argv[++i];
+			else {
+				printUsage();
+				return -1;
+			}
+		}
+		if (settings.Width <= 0 || settings.Height <= 0) {
+			printUsage();
+			return -1;
+		}
+
+		std::vector<const SceneEntry*> scenes;
+		if (sceneName == "all") {
+			for (const SceneEntry& scene : GetScenes())
+				scenes.push_back(&scene);
+		}
+		else {
+			const SceneEntry* scene = FindScene(sceneName);
+			if (scene == NULL) {
+				std::cout << "ERROR::SCENE_RUNNER::UNKNOWN_SCENE: " << sceneName << ", --list shows the scenes" << std::endl;
+				return -1;
+			}
+			scenes.push_back(scene);
+		}
+
+		SceneRunner runner;
+		if (!runner.Create(settings))
+			return -1;
+
+		std::vector<SceneTiming> timings;
+		for (const SceneEntry* scene : scenes) {
+			SceneTiming timing = runner.Run(*scene);
+			std::cout << timing.Name << ": " << timing.Frames << " frames in " << timing.Seconds << " s, " << timing.FramesPerSecond << " frames/s, "
+				<< timing.MeanFrameMilliseconds << " ms mean, " << timing.PercentileFrameMilliseconds << " ms 95th percentile, " << timing.MaxFrameMilliseconds << " ms max, "
+				<< timing.SetupMilliseconds << " ms setup" << (timing.Result != 0 ? ", FAILED" : "") << std::endl;
+			timings.push_back(timing);
+		}
+		runner.Release();
+
+		if (!csvPath.empty()) {
+			std::ofstream csv(csvPath);
+			if (!csv) {
+				std::cout << "ERROR::SCENE_RUNNER::CSV_NOT_WRITTEN: " << csvPath << std::endl;
+				return -1;
+			}
+			csv << "scene,result,width,height,frames,seconds,frames_per_second,mean_ms,p95_ms,max_ms,setup_ms" << std::endl;
+			for (const SceneTiming& timing : timings)
+				csv << timing.Name << "," << timing.Result << "," << settings.Width << "," << settings.Height << "," << timing.Frames << "," << timing.Seconds << ","
+					<< timing.FramesPerSecond << "," << timing.MeanFrameMilliseconds << "," << timing.PercentileFrameMilliseconds << "," << timing.MaxFrameMilliseconds << ","
+					<< timing.SetupMilliseconds << std::endl;
+		}
+
+		for (const SceneTiming& timing : timings)
+			if (timing.Result != 0)
+				return -1;
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+
+	return SceneRunnerMain::main(argc, argv);
+
+}
@@ -0,0 +1,125 @@
+#pragma once
+#ifndef AFFINE_H
+#define AFFINE_H
+
+#include <glm/glm.hpp>
+#include <emmintrin.h>
+
+// Affine transform (rotation / scale / shear plus translation) stored as the top three rows of
+// its 4x4 matrix; the bottom row is always (0, 0, 0, 1) so it is left out. That is 48 bytes
+// instead of 64, and products and inverses skip the work the constant row would cost.
+//
+// Rows is laid out exactly like a GLSL mat3x4 uploaded without transposing, and like
+// TRANSFORM_LAYOUT_MAT3X4 in batch_transform.h. Shaders apply it as `vec4(p, 1.0) * model`.
+struct Affine
+{
+	// Rows[i] is row i of the 4x4 matrix: the linear part in xyz, the translation in w
+	glm::mat3x4 Rows;
+
+	Affine() : Rows(glm::vec4(1.0f, 0.0f, 0.0f, 0.0f), glm::vec4(0.0f, 1.0f, 0.0f, 0.0f), glm::vec4(0.0f, 0.0f, 1.0f, 0.0f))
+	{
+	}
+
+	// Drops the bottom row, which must be (0, 0, 0, 1)
+	Affine(const glm::mat4& matrix)
+	{
+		for (int row = 0; row < 3; row++)
+			Rows[row] = glm::vec4(matrix[0][row], matrix[1][row], matrix[2][row], matrix[3][row]);
+	}
+
+	Affine(const glm::mat3& linear, glm::vec3 translation)
+	{
+		for (int row = 0; row < 3; row++)
+			Rows[row] = glm::vec4(linear[0][row], linear[1][row], linear[2][row], translation[row]);
+	}
+
+	glm::mat4 ToMat4() const
+	{
+		glm::mat4 matrix;
+		for (int row = 0; row < 3; row++)
+			for (int column = 0; column < 4; column++)
+				matrix[column][row] = Rows[row][column];
+		return matrix;
+	}
+
+	glm::mat3 GetLinear() const
+	{
+		return glm::mat3(Rows[0].x, Rows[1].x, Rows[2].x, Rows[0].y, Rows[1].y, Rows[2].y, Rows[0].z, Rows[1].z, Rows[2].z);
+	}
+
+	glm::vec3 GetTranslation() const
+	{
+		return glm::vec3(Rows[0].w, Rows[1].w, Rows[2].w);
+	}
+
+	glm::vec3 TransformPoint(glm::vec3 point) const
+	{
+		glm::vec4 p(point, 1.0f);
+		return glm::vec3(glm::dot(Rows[0], p), glm::dot(Rows[1], p), glm::dot(Rows[2], p));
+	}
+
+	glm::vec3 TransformVector(glm::vec3 vector) const
+	{
+		return glm::vec3(glm::dot(glm::vec3(Rows[0]), vector), glm::dot(glm::vec3(Rows[1]), vector), glm::dot(glm::vec3(Rows[2]), vector));
+	}
+};
+
+// a * b, applying b first. Each result row is a row of a times the rows of b, 36 multiplies
+// instead of the 64 of a full 4x4 product.
+inline Affine operator*(const Affine& a, const Affine& b)
+{
+	__m128 b0 = _mm_loadu_ps(&b.Rows[0][0]);
+	__m128 b1 = _mm_loadu_ps(&b.Rows[1][0]);
+	__m128 b2 = _mm_loadu_ps(&b.Rows[2][0]);
+	__m128 translationMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+	Affine result;
+	for (int row = 0; row < 3; row++) {
+		__m128 r = _mm_loadu_ps(&a.Rows[row][0]);
+		__m128 sum = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+		sum = _mm_add_ps(sum, _mm_and_ps(r, translationMask));
+		_mm_storeu_ps(&result.Rows[row][0], sum);
+	}
+	return result;
+}
+
+// General inverse: the 3x3 linear part is inverted through the cross products of its columns
+// (one division), and the translation is the inverted linear part applied to the negated
+// translation. A full 4x4 inverse needs the cofactors of the whole matrix instead.
+inline Affine InverseAffine(const Affine& transform)
+{
+	glm::vec3 x(transform.Rows[0].x, transform.Rows[1].x, transform.Rows[2].x);
+	glm::vec3 y(transform.Rows[0].y, transform.Rows[1].y, transform.Rows[2].y);
+	glm::vec3 z(transform.Rows[0].z, transform.Rows[1].z, transform.Rows[2].z);
+
+	// The rows of the inverse are the cross products of the columns over the determinant
+	glm::vec3 yz = glm::cross(y, z);
+	glm::vec3 zx = glm::cross(z, x);
+	glm::vec3 xy = glm::cross(x, y);
+	float inverseDeterminant = 1.0f / glm::dot(x, yz);
+	yz *= inverseDeterminant;
+	zx *= inverseDeterminant;
+	xy *= inverseDeterminant;
+
+	glm::vec3 translation = transform.GetTranslation();
+	Affine inverse;
+	inverse.Rows[0] = glm::vec4(yz, -glm::dot(yz, translation));
+	inverse.Rows[1] = glm::vec4(zx, -glm::dot(zx, translation));
+	inverse.Rows[2] = glm::vec4(xy, -glm::dot(xy, translation));
+	return inverse;
+}
+
+// Inverse of a rotation plus translation (no scale): the transposed rotation, no division at all
+inline Affine InverseRigid(const Affine& transform)
+{
+	glm::vec3 translation = transform.GetTranslation();
+	Affine inverse;
+	for (int row = 0; row < 3; row++) {
+		glm::vec3 column(transform.Rows[0][row], transform.Rows[1][row], transform.Rows[2][row]);
+		inverse.Rows[row] = glm::vec4(column, -glm::dot(column, translation));
+	}
+	return inverse;
+}
+#endif
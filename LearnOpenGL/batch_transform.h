@@ -0,0 +1,341 @@
+#pragma once
+#ifndef BATCH_TRANSFORM_H
+#define BATCH_TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#else
+#include <emmintrin.h>
+#endif
+
+#include <cstring>
+#include <vector>
+
+#include "affine.h"
+#include "job_system.h"
+
+// Builds model matrices (translate * rotate * scale, the same as the glm::translate / glm::rotate /
+// glm::scale chain) for many objects at once. Positions, rotations and scales are stored as
+// structure of arrays and TRANSFORM_BATCH objects are built per instruction: 8 with AVX2
+// (/arch:AVX2), 4 with SSE2 otherwise. The sine and cosine of axis-angle rotations are computed
+// in the same registers, so there is no scalar trig and no 4x4 multiply per object.
+//
+// The matrices are written straight to a destination pointer such as a mapped instance buffer.
+// When it is 16 byte aligned the writes are non-temporal, which is what write-combined GPU memory
+// wants and keeps large outputs from flushing the cache.
+
+#if defined(__AVX2__)
+const unsigned int TRANSFORM_BATCH = 8;
+#else
+const unsigned int TRANSFORM_BATCH = 4;
+#endif
+
+enum Transform_Rotation {
+	TRANSFORM_ROTATION_AXIS_ANGLE,	// RotationX/Y/Z is a unit axis, RotationW the angle in radians
+	TRANSFORM_ROTATION_QUATERNION	// RotationX/Y/Z/W is a unit quaternion
+};
+
+enum Transform_Layout {
+	TRANSFORM_LAYOUT_MAT4,	// 16 floats per object, column major glm::mat4 / GLSL mat4
+	TRANSFORM_LAYOUT_MAT3X4	// 12 floats per object, the first three rows (GLSL mat3x4, applied as vec4(p, 1.0) * model)
+};
+
+inline unsigned int GetTransformFloats(Transform_Layout layout)
+{
+	return layout == TRANSFORM_LAYOUT_MAT4 ? 16 : 12;
+}
+
+// Transforms, padded to a multiple of TRANSFORM_BATCH. The arrays can be written directly between
+// builds (e.g. only RotationW to spin objects); Add and Set normalize the axis / quaternion.
+struct TransformBatch
+{
+	std::vector<float> PositionX, PositionY, PositionZ;
+	std::vector<float> RotationX, RotationY, RotationZ, RotationW;
+	std::vector<float> ScaleX, ScaleY, ScaleZ;
+	Transform_Rotation Rotation;
+	unsigned int Count;
+
+	TransformBatch(Transform_Rotation rotation = TRANSFORM_ROTATION_AXIS_ANGLE) : Rotation(rotation), Count(0)
+	{
+	}
+
+	unsigned int Add(glm::vec3 position, glm::vec4 rotation, glm::vec3 scale = glm::vec3(1.0f))
+	{
+		if (Count == PositionX.size()) {
+			std::vector<float>* arrays[] = { &PositionX, &PositionY, &PositionZ, &RotationX, &RotationY, &RotationZ, &RotationW, &ScaleX, &ScaleY, &ScaleZ };
+			for (int a = 0; a < 10; a++)
+				arrays[a]->resize(Count + TRANSFORM_BATCH, 0.0f);
+		}
+		SetPosition(Count, position);
+		SetScale(Count, scale);
+		setRotation(Count, rotation);
+		return Count++;
+	}
+
+	unsigned int Add(glm::vec3 position, glm::vec3 axis, float angle, glm::vec3 scale = glm::vec3(1.0f))
+	{
+		return Add(position, glm::vec4(glm::normalize(axis), angle), scale);
+	}
+
+	unsigned int Add(glm::vec3 position, glm::quat rotation, glm::vec3 scale = glm::vec3(1.0f))
+	{
+		rotation = glm::normalize(rotation);
+		return Add(position, glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w), scale);
+	}
+
+	void SetPosition(unsigned int index, glm::vec3 position)
+	{
+		PositionX[index] = position.x;
+		PositionY[index] = position.y;
+		PositionZ[index] = position.z;
+	}
+
+	void SetScale(unsigned int index, glm::vec3 scale)
+	{
+		ScaleX[index] = scale.x;
+		ScaleY[index] = scale.y;
+		ScaleZ[index] = scale.z;
+	}
+
+	void SetRotation(unsigned int index, glm::vec3 axis, float angle)
+	{
+		setRotation(index, glm::vec4(glm::normalize(axis), angle));
+	}
+
+	void SetRotation(unsigned int index, glm::quat rotation)
+	{
+		rotation = glm::normalize(rotation);
+		setRotation(index, glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w));
+	}
+
+	void Clear()
+	{
+		std::vector<float>* arrays[] = { &PositionX, &PositionY, &PositionZ, &RotationX, &RotationY, &RotationZ, &RotationW, &ScaleX, &ScaleY, &ScaleZ };
+		for (int a = 0; a < 10; a++)
+			arrays[a]->clear();
+		Count = 0;
+	}
+
+private:
+	void setRotation(unsigned int index, glm::vec4 rotation)
+	{
+		RotationX[index] = rotation.x;
+		RotationY[index] = rotation.y;
+		RotationZ[index] = rotation.z;
+		RotationW[index] = rotation.w;
+	}
+};
+
+namespace BatchTransform {
+
+#if defined(__AVX2__)
+	typedef __m256 Batch;
+	typedef __m256i BatchInt;
+	inline Batch load(const float* p) { return _mm256_loadu_ps(p); }
+	inline Batch broadcast(float value) { return _mm256_set1_ps(value); }
+	inline Batch add(Batch a, Batch b) { return _mm256_add_ps(a, b); }
+	inline Batch sub(Batch a, Batch b) { return _mm256_sub_ps(a, b); }
+	inline Batch mul(Batch a, Batch b) { return _mm256_mul_ps(a, b); }
+	inline Batch bitXor(Batch a, Batch b) { return _mm256_xor_ps(a, b); }
+	inline Batch select(Batch mask, Batch a, Batch b) { return _mm256_blendv_ps(b, a, mask); }
+	inline BatchInt roundToInt(Batch a) { return _mm256_cvtps_epi32(a); }
+	inline Batch toFloat(BatchInt a) { return _mm256_cvtepi32_ps(a); }
+	inline BatchInt intAnd(BatchInt a, int value) { return _mm256_and_si256(a, _mm256_set1_epi32(value)); }
+	inline BatchInt intAdd(BatchInt a, int value) { return _mm256_add_epi32(a, _mm256_set1_epi32(value)); }
+	inline Batch intEqual(BatchInt a, int value) { return _mm256_castsi256_ps(_mm256_cmpeq_epi32(a, _mm256_set1_epi32(value))); }
+	inline Batch signBit(BatchInt a) { return _mm256_castsi256_ps(_mm256_slli_epi32(a, 30)); }
+	inline __m128 lanes(Batch a, int half) { return half == 0 ? _mm256_castps256_ps128(a) : _mm256_extractf128_ps(a, 1); }
+#else
+	typedef __m128 Batch;
+	typedef __m128i BatchInt;
+	inline Batch load(const float* p) { return _mm_loadu_ps(p); }
+	inline Batch broadcast(float value) { return _mm_set1_ps(value); }
+	inline Batch add(Batch a, Batch b) { return _mm_add_ps(a, b); }
+	inline Batch sub(Batch a, Batch b) { return _mm_sub_ps(a, b); }
+	inline Batch mul(Batch a, Batch b) { return _mm_mul_ps(a, b); }
+	inline Batch bitXor(Batch a, Batch b) { return _mm_xor_ps(a, b); }
+	inline Batch select(Batch mask, Batch a, Batch b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	inline BatchInt roundToInt(Batch a) { return _mm_cvtps_epi32(a); }
+	inline Batch toFloat(BatchInt a) { return _mm_cvtepi32_ps(a); }
+	inline BatchInt intAnd(BatchInt a, int value) { return _mm_and_si128(a, _mm_set1_epi32(value)); }
+	inline BatchInt intAdd(BatchInt a, int value) { return _mm_add_epi32(a, _mm_set1_epi32(value)); }
+	inline Batch intEqual(BatchInt a, int value) { return _mm_castsi128_ps(_mm_cmpeq_epi32(a, _mm_set1_epi32(value))); }
+	inline Batch signBit(BatchInt a) { return _mm_castsi128_ps(_mm_slli_epi32(a, 30)); }
+	inline __m128 lanes(Batch a, int) { return a; }
+#endif
+
+	// Sine and cosine of every lane. The angle is reduced to [-pi/4, pi/4] around the nearest
+	// multiple of pi/2 (pi/2 split in three parts so the reduction stays exact) and the Cephes
+	// single precision polynomials are evaluated there; the quadrant picks and signs the results.
+	// Accurate to a couple of ulp for angles up to a few thousand radians.
+	inline void sinCos(Batch x, Batch& s, Batch& c)
+	{
+		BatchInt quadrant = roundToInt(mul(x, broadcast(0.636619772f)));
+		Batch j = toFloat(quadrant);
+		Batch r = sub(x, mul(j, broadcast(1.5703125f)));
+		r = sub(r, mul(j, broadcast(4.837512969970703125e-4f)));
+		r = sub(r, mul(j, broadcast(7.54978995489188216e-8f)));
+
+		Batch r2 = mul(r, r);
+		Batch sinR = add(broadcast(8.3321608736e-3f), mul(r2, broadcast(-1.9515295891e-4f)));
+		sinR = add(broadcast(-1.6666654611e-1f), mul(r2, sinR));
+		sinR = add(r, mul(mul(r, r2), sinR));
+		Batch cosR = add(broadcast(-1.388731625493765e-3f), mul(r2, broadcast(2.443315711809948e-5f)));
+		cosR = add(broadcast(4.166664568298827e-2f), mul(r2, cosR));
+		cosR = add(sub(broadcast(1.0f), mul(r2, broadcast(0.5f))), mul(mul(r2, r2), cosR));
+
+		// Odd quadrants swap sine and cosine, quadrants 2 and 3 negate the sine, 1 and 2 the cosine
+		Batch swap = intEqual(intAnd(quadrant, 1), 1);
+		s = bitXor(select(swap, cosR, sinR), signBit(intAnd(quadrant, 2)));
+		c = bitXor(select(swap, sinR, cosR), signBit(intAnd(intAdd(quadrant, 1), 2)));
+	}
+
+	// Transposes four structure of arrays components into one 4 float row per object and stores
+	// the rows `stride` floats apart
+	inline void storeTransposed(const Batch components[4], float* out, size_t stride, bool stream)
+	{
+		for (unsigned int half = 0; half < TRANSFORM_BATCH / 4; half++) {
+			__m128 a = lanes(components[0], half);
+			__m128 b = lanes(components[1], half);
+			__m128 c = lanes(components[2], half);
+			__m128 d = lanes(components[3], half);
+			_MM_TRANSPOSE4_PS(a, b, c, d);
+
+			float* row = out + half * 4 * stride;
+			if (stream) {
+				_mm_stream_ps(row, a);
+				_mm_stream_ps(row + stride, b);
+				_mm_stream_ps(row + 2 * stride, c);
+				_mm_stream_ps(row + 3 * stride, d);
+			} else {
+				_mm_storeu_ps(row, a);
+				_mm_storeu_ps(row + stride, b);
+				_mm_storeu_ps(row + 2 * stride, c);
+				_mm_storeu_ps(row + 3 * stride, d);
+			}
+		}
+	}
+
+	// Builds the TRANSFORM_BATCH matrices starting at `index` into out
+	inline void buildBatch(const TransformBatch& transforms, unsigned int index, float* out, Transform_Layout layout, bool stream)
+	{
+		Batch x = load(&transforms.RotationX[index]);
+		Batch y = load(&transforms.RotationY[index]);
+		Batch z = load(&transforms.RotationZ[index]);
+		Batch w = load(&transforms.RotationW[index]);
+		Batch one = broadcast(1.0f);
+
+		// Rotation columns, m[column][row] like glm
+		Batch m[3][3];
+		if (transforms.Rotation == TRANSFORM_ROTATION_AXIS_ANGLE) {
+			// Rodrigues, the same terms glm::rotate uses
+			Batch s, c;
+			sinCos(w, s, c);
+			Batch t = sub(one, c);
+			Batch tx = mul(t, x), ty = mul(t, y), tz = mul(t, z);
+			Batch sx = mul(s, x), sy = mul(s, y), sz = mul(s, z);
+			m[0][0] = add(c, mul(tx, x));
+			m[0][1] = add(mul(tx, y), sz);
+			m[0][2] = sub(mul(tx, z), sy);
+			m[1][0] = sub(mul(ty, x), sz);
+			m[1][1] = add(c, mul(ty, y));
+			m[1][2] = add(mul(ty, z), sx);
+			m[2][0] = add(mul(tz, x), sy);
+			m[2][1] = sub(mul(tz, y), sx);
+			m[2][2] = add(c, mul(tz, z));
+		} else {
+			// glm::mat3_cast
+			Batch x2 = add(x, x), y2 = add(y, y), z2 = add(z, z);
+			Batch xx = mul(x, x2), yy = mul(y, y2), zz = mul(z, z2);
+			Batch xy = mul(x, y2), xz = mul(x, z2), yz = mul(y, z2);
+			Batch wx = mul(w, x2), wy = mul(w, y2), wz = mul(w, z2);
+			m[0][0] = sub(one, add(yy, zz));
+			m[0][1] = add(xy, wz);
+			m[0][2] = sub(xz, wy);
+			m[1][0] = sub(xy, wz);
+			m[1][1] = sub(one, add(xx, zz));
+			m[1][2] = add(yz, wx);
+			m[2][0] = add(xz, wy);
+			m[2][1] = sub(yz, wx);
+			m[2][2] = sub(one, add(xx, yy));
+		}
+
+		Batch scale[3] = { load(&transforms.ScaleX[index]), load(&transforms.ScaleY[index]), load(&transforms.ScaleZ[index]) };
+		Batch position[3] = { load(&transforms.PositionX[index]), load(&transforms.PositionY[index]), load(&transforms.PositionZ[index]) };
+		for (int column = 0; column < 3; column++)
+			for (int row = 0; row < 3; row++)
+				m[column][row] = mul(m[column][row], scale[column]);
+
+		if (layout == TRANSFORM_LAYOUT_MAT4) {
+			Batch zero = broadcast(0.0f);
+			for (int column = 0; column < 3; column++) {
+				Batch components[4] = { m[column][0], m[column][1], m[column][2], zero };
+				storeTransposed(components, out + column * 4, 16, stream);
+			}
+			Batch components[4] = { position[0], position[1], position[2], one };
+			storeTransposed(components, out + 12, 16, stream);
+		} else {
+			for (int row = 0; row < 3; row++) {
+				Batch components[4] = { m[0][row], m[1][row], m[2][row], position[row] };
+				storeTransposed(components, out + row * 4, 12, stream);
+			}
+		}
+	}
+}
+
+// Writes the matrices of transforms [first, first + count) to out, GetTransformFloats(layout)
+// floats each. first must be a multiple of TRANSFORM_BATCH.
+inline void BuildTransforms(const TransformBatch& transforms, unsigned int first, unsigned int count, float* out, Transform_Layout layout = TRANSFORM_LAYOUT_MAT4)
+{
+	using namespace BatchTransform;
+	unsigned int floats = GetTransformFloats(layout);
+	bool stream = ((size_t) out & 15) == 0;
+
+	unsigned int i = 0;
+	for (; i + TRANSFORM_BATCH <= count; i += TRANSFORM_BATCH)
+		buildBatch(transforms, first + i, out + (size_t) i * floats, layout, stream);
+
+	// The last partial batch goes through a local copy so nothing is written past out
+	if (i < count) {
+		alignas(16) float tail[TRANSFORM_BATCH * 16];
+		buildBatch(transforms, first + i, tail, layout, false);
+		memcpy(out + (size_t) i * floats, tail, (count - i) * floats * sizeof(float));
+	}
+
+	if (stream)
+		_mm_sfence();
+}
+
+inline void BuildTransforms(const TransformBatch& transforms, float* out, Transform_Layout layout = TRANSFORM_LAYOUT_MAT4)
+{
+	BuildTransforms(transforms, 0, transforms.Count, out, layout);
+}
+
+// Affine is laid out exactly like TRANSFORM_LAYOUT_MAT3X4
+static_assert(sizeof(Affine) == 12 * sizeof(float), "Affine must be three packed rows");
+
+inline void BuildTransforms(const TransformBatch& transforms, Affine* out)
+{
+	BuildTransforms(transforms, 0, transforms.Count, &out->Rows[0][0], TRANSFORM_LAYOUT_MAT3X4);
+}
+
+// Same as BuildTransforms for all transforms, with ranges of whole batches built in parallel on
+// the job system. Small batches end up built on the calling thread only.
+inline void BuildTransformsParallel(const TransformBatch& transforms, float* out, Transform_Layout layout = TRANSFORM_LAYOUT_MAT4, JobSystem& jobs = GetJobSystem())
+{
+	unsigned int batches = (transforms.Count + TRANSFORM_BATCH - 1) / TRANSFORM_BATCH;
+	unsigned int floats = GetTransformFloats(layout);
+	jobs.ParallelFor(0, batches, [&](size_t firstBatch, size_t lastBatch) {
+		unsigned int first = (unsigned int) firstBatch * TRANSFORM_BATCH;
+		unsigned int last = glm::min((unsigned int) lastBatch * TRANSFORM_BATCH, transforms.Count);
+		BuildTransforms(transforms, first, last - first, out + (size_t) first * floats, layout);
+	}, 256);
+}
+
+inline void BuildTransformsParallel(const TransformBatch& transforms, Affine* out, JobSystem& jobs = GetJobSystem())
+{
+	BuildTransformsParallel(transforms, &out->Rows[0][0], TRANSFORM_LAYOUT_MAT3X4, jobs);
+}
+#endif
@@ -0,0 +1,485 @@
+#pragma once
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+#include <xmmintrin.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+#include <vector>
+
+#include "culling.h"
+#include "frustum.h"
+
+// Bounding volume hierarchy over the world space boxes of static objects (see TransformBounds
+// in culling.h to get them from model matrices).
+//
+// The tree is built top-down with binned SAH splits, subtrees in parallel, and stored as a flat
+// array of 4-wide nodes: each node holds the boxes of its (up to) four children as structure of
+// arrays so one SSE instruction tests all of them. Every subtree covers a contiguous range of
+// Bvh::Objects, which lets frustum queries append a subtree that is entirely inside without
+// looking at any of its nodes. Refit updates the boxes after objects moved without rebuilding.
+
+const unsigned int BVH_WIDTH = 4;
+const unsigned int BVH_LEAF_SIZE = 4;
+const unsigned int BVH_BIN_COUNT = 16;
+// Ranges smaller than this are never handed to another thread
+const unsigned int BVH_PARALLEL_THRESHOLD = 4096;
+
+struct BvhNode
+{
+	// Child boxes, unused slots hold inverted boxes
+	float MinX[BVH_WIDTH], MinY[BVH_WIDTH], MinZ[BVH_WIDTH];
+	float MaxX[BVH_WIDTH], MaxY[BVH_WIDTH], MaxZ[BVH_WIDTH];
+	// Node index of internal children
+	unsigned int Child[BVH_WIDTH];
+	// Objects in the child's subtree: Bvh::Objects[First, First + Count)
+	unsigned int First[BVH_WIDTH];
+	unsigned int Count[BVH_WIDTH];
+	// Bit i is set when child i is a leaf
+	unsigned int LeafMask;
+	unsigned int ChildCount;
+};
+
+struct BvhHit
+{
+	unsigned int Object;
+	float Distance;
+};
+
+class Bvh
+{
+public:
+	// Nodes[0] is the root. Children always come after their parent.
+	std::vector<BvhNode> Nodes;
+	// Object indices in tree order
+	std::vector<unsigned int> Objects;
+	// World space box of every object, by object index
+	std::vector<glm::vec3> BoxMin;
+	std::vector<glm::vec3> BoxMax;
+
+	// Builds the tree over `count` boxes using threadCount threads (0 = one per hardware thread)
+	void Build(const glm::vec3* boxMin, const glm::vec3* boxMax, unsigned int count, unsigned int threadCount = 0)
+	{
+		BoxMin.assign(boxMin, boxMin + count);
+		BoxMax.assign(boxMax, boxMax + count);
+		Objects.resize(count);
+		items.resize(count);
+		for (unsigned int i = 0; i < count; i++) {
+			items[i].BoxMin = boxMin[i];
+			items[i].BoxMax = boxMax[i];
+			items[i].Centroid = (boxMin[i] + boxMax[i]) * 0.5f;
+			items[i].Object = i;
+		}
+
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		// Every level hands up to BVH_WIDTH subtrees to threads
+		unsigned int parallelDepth = 0;
+		for (unsigned int tasks = 1; tasks < threadCount; tasks *= BVH_WIDTH)
+			parallelDepth++;
+
+		Nodes.clear();
+		if (count > 0)
+			buildNode(0, count, Nodes, parallelDepth);
+		for (unsigned int i = 0; i < count; i++)
+			Objects[i] = items[i].Object;
+		items.clear();
+		items.shrink_to_fit();
+	}
+
+	// Updates the boxes of the objects (same count as the build) and of every node, bottom-up.
+	// The tree keeps its topology, so query speed degrades if objects move very far.
+	void Refit(const glm::vec3* boxMin, const glm::vec3* boxMax)
+	{
+		std::copy(boxMin, boxMin + BoxMin.size(), BoxMin.begin());
+		std::copy(boxMax, boxMax + BoxMax.size(), BoxMax.begin());
+
+		for (size_t n = Nodes.size(); n-- > 0;) {
+			BvhNode& node = Nodes[n];
+			for (unsigned int i = 0; i < node.ChildCount; i++) {
+				glm::vec3 childMin, childMax;
+				if (node.LeafMask & (1u << i))
+					objectBounds(node.First[i], node.Count[i], childMin, childMax);
+				else
+					nodeBounds(Nodes[node.Child[i]], childMin, childMax);
+				setChildBounds(node, i, childMin, childMax);
+			}
+		}
+	}
+
+	// Clears `visible` and fills it with every object whose box intersects the frustum.
+	// Returns the number of objects found.
+	unsigned int CullFrustum(const Frustum& frustum, std::vector<unsigned int>& visible) const
+	{
+		visible.clear();
+		if (Nodes.empty())
+			return 0;
+
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+			for (int c = 0; c < 4; c++)
+				planes[p][c] = _mm_set1_ps(frustum.Planes[p][c]);
+		__m128 zero = _mm_setzero_ps();
+
+		std::vector<unsigned int> stack;
+		stack.reserve(64);
+		stack.push_back(0);
+		while (!stack.empty()) {
+			const BvhNode& node = Nodes[stack.back()];
+			stack.pop_back();
+
+			// For every plane test the corner furthest along the normal (outside if behind) and
+			// the nearest corner (intersecting if behind)
+			int outside = 0, intersecting = 0;
+			for (int p = 0; p < 6; p++) {
+				const glm::vec4& plane = frustum.Planes[p];
+				__m128 farX = _mm_loadu_ps(plane.x >= 0.0f ? node.MaxX : node.MinX);
+				__m128 farY = _mm_loadu_ps(plane.y >= 0.0f ? node.MaxY : node.MinY);
+				__m128 farZ = _mm_loadu_ps(plane.z >= 0.0f ? node.MaxZ : node.MinZ);
+				__m128 nearX = _mm_loadu_ps(plane.x >= 0.0f ? node.MinX : node.MaxX);
+				__m128 nearY = _mm_loadu_ps(plane.y >= 0.0f ? node.MinY : node.MaxY);
+				__m128 nearZ = _mm_loadu_ps(plane.z >= 0.0f ? node.MinZ : node.MaxZ);
+				__m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], farX), _mm_mul_ps(planes[p][1], farY)), _mm_add_ps(_mm_mul_ps(planes[p][2], farZ), planes[p][3]));
+				__m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], nearX), _mm_mul_ps(planes[p][1], nearY)), _mm_add_ps(_mm_mul_ps(planes[p][2], nearZ), planes[p][3]));
+				outside |= _mm_movemask_ps(_mm_cmplt_ps(farDistance, zero));
+				intersecting |= _mm_movemask_ps(_mm_cmplt_ps(nearDistance, zero));
+			}
+
+			int inside = ((1 << node.ChildCount) - 1) & ~outside;
+			for (unsigned int i = 0; i < node.ChildCount; i++) {
+				if (!(inside & (1 << i)))
+					continue;
+
+				if (!(intersecting & (1 << i))) {
+					// Entirely inside: the whole subtree is visible
+					visible.insert(visible.end(), Objects.begin() + node.First[i], Objects.begin() + node.First[i] + node.Count[i]);
+				}
+				else if (node.LeafMask & (1u << i)) {
+					for (unsigned int k = node.First[i]; k < node.First[i] + node.Count[i]; k++)
+						if (IsBoxInFrustum(frustum, BoxMin[Objects[k]], BoxMax[Objects[k]]))
+							visible.push_back(Objects[k]);
+				}
+				else {
+					stack.push_back(node.Child[i]);
+				}
+			}
+		}
+		return (unsigned int) visible.size();
+	}
+
+	// Finds the closest object box hit by the ray within maxDistance. For picking pass the
+	// camera Position and Front. The direction doesn't need to be normalized, distances are
+	// in units of its length.
+	bool Raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, BvhHit& hit) const
+	{
+		hit.Object = 0;
+		hit.Distance = maxDistance;
+		if (Nodes.empty())
+			return false;
+
+		glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+		__m128 originX = _mm_set1_ps(origin.x), originY = _mm_set1_ps(origin.y), originZ = _mm_set1_ps(origin.z);
+		__m128 inverseX = _mm_set1_ps(inverseDirection.x), inverseY = _mm_set1_ps(inverseDirection.y), inverseZ = _mm_set1_ps(inverseDirection.z);
+		bool found = false;
+
+		// (node, entry distance) pairs, nearest on top
+		std::vector<std::pair<unsigned int, float> > stack;
+		stack.reserve(64);
+		stack.push_back(std::make_pair(0u, 0.0f));
+		while (!stack.empty()) {
+			std::pair<unsigned int, float> entry = stack.back();
+			stack.pop_back();
+			if (entry.second > hit.Distance)
+				continue;
+			const BvhNode& node = Nodes[entry.first];
+
+			// Slab test against all four children
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinX), originX), inverseX);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxX), originX), inverseX);
+			__m128 entryDistance = _mm_min_ps(t1, t2);
+			__m128 exitDistance = _mm_max_ps(t1, t2);
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinY), originY), inverseY);
+			t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxY), originY), inverseY);
+			entryDistance = _mm_max_ps(entryDistance, _mm_min_ps(t1, t2));
+			exitDistance = _mm_min_ps(exitDistance, _mm_max_ps(t1, t2));
+			t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MinZ), originZ), inverseZ);
+			t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.MaxZ), originZ), inverseZ);
+			entryDistance = _mm_max_ps(_mm_max_ps(entryDistance, _mm_min_ps(t1, t2)), _mm_setzero_ps());
+			exitDistance = _mm_min_ps(_mm_min_ps(exitDistance, _mm_max_ps(t1, t2)), _mm_set1_ps(hit.Distance));
+			int hits = _mm_movemask_ps(_mm_cmple_ps(entryDistance, exitDistance)) & ((1 << node.ChildCount) - 1);
+
+			float entries[4];
+			_mm_storeu_ps(entries, entryDistance);
+			std::pair<unsigned int, float> children[BVH_WIDTH];
+			unsigned int childCount = 0;
+			for (unsigned int i = 0; i < node.ChildCount; i++) {
+				if (!(hits & (1 << i)))
+					continue;
+				if (node.LeafMask & (1u << i)) {
+					for (unsigned int k = node.First[i]; k < node.First[i] + node.Count[i]; k++) {
+						float distance;
+						unsigned int object = Objects[k];
+						if (intersectRay(origin, inverseDirection, BoxMin[object], BoxMax[object], hit.Distance, distance) && (!found || distance < hit.Distance)) {
+							hit.Object = object;
+							hit.Distance = distance;
+							found = true;
+						}
+					}
+				}
+				else {
+					children[childCount++] = std::make_pair(node.Child[i], entries[i]);
+				}
+			}
+
+			// Push the farthest first so the nearest child is visited next
+			std::sort(children, children + childCount, [](const std::pair<unsigned int, float>& a, const std::pair<unsigned int, float>& b) {
+				return a.second > b.second;
+			});
+			stack.insert(stack.end(), children, children + childCount);
+		}
+		return found;
+	}
+
+private:
+	// Build input, reordered in place as ranges get split so the build reads memory linearly
+	struct BuildItem
+	{
+		glm::vec3 BoxMin;
+		glm::vec3 BoxMax;
+		glm::vec3 Centroid;
+		unsigned int Object;
+	};
+	std::vector<BuildItem> items;
+
+	struct Range
+	{
+		unsigned int First;
+		unsigned int Count;
+	};
+
+	static float halfArea(glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		glm::vec3 d = glm::max(boxMax - boxMin, glm::vec3(0.0f));
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	static bool intersectRay(glm::vec3 origin, glm::vec3 inverseDirection, glm::vec3 boxMin, glm::vec3 boxMax, float maxDistance, float& distance)
+	{
+		glm::vec3 t1 = (boxMin - origin) * inverseDirection;
+		glm::vec3 t2 = (boxMax - origin) * inverseDirection;
+		glm::vec3 entry = glm::min(t1, t2);
+		glm::vec3 exit = glm::max(t1, t2);
+		float entryDistance = glm::max(glm::max(entry.x, entry.y), glm::max(entry.z, 0.0f));
+		float exitDistance = glm::min(glm::min(exit.x, exit.y), glm::min(exit.z, maxDistance));
+		distance = entryDistance;
+		return entryDistance <= exitDistance;
+	}
+
+	static void nodeBounds(const BvhNode& node, glm::vec3& boxMin, glm::vec3& boxMax)
+	{
+		boxMin = glm::vec3(FLT_MAX);
+		boxMax = glm::vec3(-FLT_MAX);
+		for (unsigned int i = 0; i < node.ChildCount; i++) {
+			boxMin = glm::min(boxMin, glm::vec3(node.MinX[i], node.MinY[i], node.MinZ[i]));
+			boxMax = glm::max(boxMax, glm::vec3(node.MaxX[i], node.MaxY[i], node.MaxZ[i]));
+		}
+	}
+
+	static void setChildBounds(BvhNode& node, unsigned int i, glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		node.MinX[i] = boxMin.x;
+		node.MinY[i] = boxMin.y;
+		node.MinZ[i] = boxMin.z;
+		node.MaxX[i] = boxMax.x;
+		node.MaxY[i] = boxMax.y;
+		node.MaxZ[i] = boxMax.z;
+	}
+
+	void objectBounds(unsigned int first, unsigned int count, glm::vec3& boxMin, glm::vec3& boxMax) const
+	{
+		boxMin = glm::vec3(FLT_MAX);
+		boxMax = glm::vec3(-FLT_MAX);
+		for (unsigned int k = first; k < first + count; k++) {
+			boxMin = glm::min(boxMin, BoxMin[Objects[k]]);
+			boxMax = glm::max(boxMax, BoxMax[Objects[k]]);
+		}
+	}
+
+	void itemBounds(unsigned int first, unsigned int count, glm::vec3& boxMin, glm::vec3& boxMax) const
+	{
+		boxMin = glm::vec3(FLT_MAX);
+		boxMax = glm::vec3(-FLT_MAX);
+		for (unsigned int k = first; k < first + count; k++) {
+			boxMin = glm::min(boxMin, items[k].BoxMin);
+			boxMax = glm::max(boxMax, items[k].BoxMax);
+		}
+	}
+
+	// Splits a range in two with the binned surface area heuristic, reordering the build items
+	void split(Range range, Range& left, Range& right)
+	{
+		glm::vec3 centroidMin(FLT_MAX), centroidMax(-FLT_MAX);
+		for (unsigned int k = range.First; k < range.First + range.Count; k++) {
+			centroidMin = glm::min(centroidMin, items[k].Centroid);
+			centroidMax = glm::max(centroidMax, items[k].Centroid);
+		}
+
+		// Bin all three axes in a single pass over the objects
+		glm::vec3 binScale(0.0f);
+		for (int axis = 0; axis < 3; axis++) {
+			float extent = centroidMax[axis] - centroidMin[axis];
+			binScale[axis] = extent > 0.0f ? BVH_BIN_COUNT / extent : 0.0f;
+		}
+		unsigned int binCount[3][BVH_BIN_COUNT] = {};
+		glm::vec3 binMin[3][BVH_BIN_COUNT], binMax[3][BVH_BIN_COUNT];
+		for (int axis = 0; axis < 3; axis++) {
+			for (unsigned int b = 0; b < BVH_BIN_COUNT; b++) {
+				binMin[axis][b] = glm::vec3(FLT_MAX);
+				binMax[axis][b] = glm::vec3(-FLT_MAX);
+			}
+		}
+		for (unsigned int k = range.First; k < range.First + range.Count; k++) {
+			const BuildItem& item = items[k];
+			glm::vec3 bin = (item.Centroid - centroidMin) * binScale;
+			for (int axis = 0; axis < 3; axis++) {
+				unsigned int b = std::min((unsigned int) bin[axis], BVH_BIN_COUNT - 1);
+				binCount[axis][b]++;
+				binMin[axis][b] = glm::min(binMin[axis][b], item.BoxMin);
+				binMax[axis][b] = glm::max(binMax[axis][b], item.BoxMax);
+			}
+		}
+
+		int bestAxis = -1;
+		unsigned int bestBin = 0;
+		float bestCost = FLT_MAX;
+		for (int axis = 0; axis < 3; axis++) {
+			if (binScale[axis] == 0.0f)
+				continue;
+
+			// Sweep from the right to get the cost of everything after each split plane
+			float rightCost[BVH_BIN_COUNT];
+			glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+			unsigned int sweepCount = 0;
+			for (unsigned int b = BVH_BIN_COUNT - 1; b > 0; b--) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				rightCost[b] = sweepCount * halfArea(sweepMin, sweepMax);
+			}
+
+			sweepMin = glm::vec3(FLT_MAX);
+			sweepMax = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (unsigned int b = 0; b + 1 < BVH_BIN_COUNT; b++) {
+				sweepMin = glm::min(sweepMin, binMin[axis][b]);
+				sweepMax = glm::max(sweepMax, binMax[axis][b]);
+				sweepCount += binCount[axis][b];
+				float cost = sweepCount * halfArea(sweepMin, sweepMax) + rightCost[b + 1];
+				if (sweepCount > 0 && sweepCount < range.Count && cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		unsigned int leftCount = range.Count / 2;
+		if (bestAxis >= 0) {
+			float axisMin = centroidMin[bestAxis];
+			float axisScale = binScale[bestAxis];
+			BuildItem* middle = std::partition(&items[range.First], &items[range.First] + range.Count, [&](const BuildItem& item) {
+				return std::min((unsigned int)((item.Centroid[bestAxis] - axisMin) * axisScale), BVH_BIN_COUNT - 1) <= bestBin;
+			});
+			leftCount = (unsigned int)(middle - &items[range.First]);
+		}
+		// All centroids in one spot: any split is as good as another
+
+		left.First = range.First;
+		left.Count = leftCount;
+		right.First = range.First + leftCount;
+		right.Count = range.Count - leftCount;
+	}
+
+	// Builds the subtree of a range into `nodes` and returns the index of its root there
+	unsigned int buildNode(unsigned int first, unsigned int count, std::vector<BvhNode>& nodes, unsigned int parallelDepth)
+	{
+		// Split the largest range until there are BVH_WIDTH children or only leaves left
+		Range ranges[BVH_WIDTH];
+		unsigned int rangeCount = 1;
+		ranges[0].First = first;
+		ranges[0].Count = count;
+		while (rangeCount < BVH_WIDTH) {
+			unsigned int largest = 0;
+			for (unsigned int i = 1; i < rangeCount; i++)
+				if (ranges[i].Count > ranges[largest].Count)
+					largest = i;
+			if (ranges[largest].Count <= BVH_LEAF_SIZE)
+				break;
+			split(ranges[largest], ranges[largest], ranges[rangeCount]);
+			rangeCount++;
+		}
+
+		BvhNode node;
+		node.ChildCount = rangeCount;
+		node.LeafMask = 0;
+		for (unsigned int i = 0; i < BVH_WIDTH; i++) {
+			setChildBounds(node, i, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			node.Child[i] = 0;
+			node.First[i] = i < rangeCount ? ranges[i].First : 0;
+			node.Count[i] = i < rangeCount ? ranges[i].Count : 0;
+		}
+		for (unsigned int i = 0; i < rangeCount; i++) {
+			glm::vec3 childMin, childMax;
+			itemBounds(ranges[i].First, ranges[i].Count, childMin, childMax);
+			setChildBounds(node, i, childMin, childMax);
+			if (ranges[i].Count <= BVH_LEAF_SIZE)
+				node.LeafMask |= 1u << i;
+		}
+
+		unsigned int index = (unsigned int) nodes.size();
+		nodes.push_back(node);
+
+		if (parallelDepth > 0 && count >= BVH_PARALLEL_THRESHOLD) {
+			// Build the internal children into their own arrays on separate threads, then
+			// append them and move their child indices along
+			std::vector<BvhNode> subtrees[BVH_WIDTH];
+			std::vector<std::thread> threads;
+			for (unsigned int i = 0; i < rangeCount; i++) {
+				if (node.LeafMask & (1u << i))
+					continue;
+				threads.push_back(std::thread([this, &subtrees, &ranges, i, parallelDepth]() {
+					buildNode(ranges[i].First, ranges[i].Count, subtrees[i], parallelDepth - 1);
+				}));
+			}
+			for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+
+			for (unsigned int i = 0; i < rangeCount; i++) {
+				if (node.LeafMask & (1u << i))
+					continue;
+				unsigned int offset = (unsigned int) nodes.size();
+				nodes[index].Child[i] = offset;
+				for (size_t n = 0; n < subtrees[i].size(); n++) {
+					BvhNode& moved = subtrees[i][n];
+					for (unsigned int c = 0; c < moved.ChildCount; c++)
+						if (!(moved.LeafMask & (1u << c)))
+							moved.Child[c] += offset;
+					nodes.push_back(moved);
+				}
+			}
+		}
+		else {
+			for (unsigned int i = 0; i < rangeCount; i++) {
+				if (node.LeafMask & (1u << i))
+					continue;
+				unsigned int child = buildNode(ranges[i].First, ranges[i].Count, nodes, 0);
+				nodes[index].Child[i] = child;
+			}
+		}
+		return index;
+	}
+};
+#endif
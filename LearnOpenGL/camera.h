@@ -5,9 +5,12 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include <vector>
 
+#include "frustum.h"
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
 	FORWARD,
@@ -16,6 +19,12 @@ enum Camera_Movement {
 	RIGHT
 };
 
+// Depth mappings the camera can build its projection for
+enum Camera_Depth {
+	DEPTH_STANDARD,	// glm::perspective, depth 0 at the near plane and 1 at the far plane, GL_LESS
+	DEPTH_REVERSE_Z	// Far plane at infinity, depth 1 at the near plane falling towards 0, GL_GREATER
+};
+
 // Default camera values
 const float YAW = -90.0f;
 const float PITCH = 0.0f;
@@ -24,7 +33,10 @@ const float SENSITIVTY = 0.1f;
 const float ZOOM = 45.0f;
 
 
-// An abstract camera class that processes input and calculates the corresponding Eular Angles, Vectors and Matrices for use in OpenGL
+// An abstract camera class that processes input and calculates the corresponding Eular Angles, Vectors and Matrices for use in OpenGL.
+// The orientation is kept as a quaternion that mouse movement rotates incrementally, so no trig runs per event.
+// The view, projection and view-projection matrices are cached and only rebuilt when Position, the
+// orientation, Zoom or the perspective settings changed since they were last asked for.
 class Camera
 {
 public:
@@ -34,7 +46,8 @@ public:
 	glm::vec3 Up;
 	glm::vec3 Right;
 	glm::vec3 WorldUp;
-	// Eular Angles
+	glm::quat Orientation;
+	// Eular Angles, kept in step with Orientation
 	float Yaw;
 	float Pitch;
 	// Camera options
@@ -49,7 +62,7 @@ public:
 		WorldUp = up;
 		Yaw = yaw;
 		Pitch = pitch;
-		updateCameraVectors();
+		initialize();
 	}
 	// Constructor with scalar values
 	Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVTY), Zoom(ZOOM)
@@ -58,42 +71,112 @@ public:
 		WorldUp = glm::vec3(upX, upY, upZ);
 		Yaw = yaw;
 		Pitch = pitch;
-		updateCameraVectors();
+		initialize();
+	}
+
+	// Sets the perspective used by GetProjectionMatrix, the field of view being Zoom. The far plane
+	// is unused with DEPTH_REVERSE_Z.
+	void SetPerspective(float aspect, float nearPlane, float farPlane)
+	{
+		aspectRatio = aspect;
+		nearDistance = nearPlane;
+		farDistance = farPlane;
+		projectionDirty = true;
+	}
+
+	// Returns the view matrix. Its rows are the camera axes and the translation is the position
+	// projected on them, so it is written directly instead of multiplying a rotation and a translation.
+	const glm::mat4& GetViewMatrix()
+	{
+		if (viewDirty || Position != viewPosition) {
+			view[0] = glm::vec4(Right.x, Up.x, -Front.x, 0.0f);
+			view[1] = glm::vec4(Right.y, Up.y, -Front.y, 0.0f);
+			view[2] = glm::vec4(Right.z, Up.z, -Front.z, 0.0f);
+			view[3] = glm::vec4(-glm::dot(Right, Position), -glm::dot(Up, Position), glm::dot(Front, Position), 1.0f);
+			viewPosition = Position;
+			viewDirty = false;
+			viewProjectionDirty = true;
+		}
+		return view;
+	}
+
+	// Switches the projection between the standard and the reverse-Z mapping and sets the matching
+	// GL depth state, so it needs a current context. Reverse-Z stores depth as near / distance, which
+	// a float depth buffer (see RenderTarget) keeps precise out to any distance, so the far plane is
+	// dropped altogether. glClipControl (GL 4.5 / ARB_clip_control) lets clip space depth map to
+	// [0, 1] directly; without it depth still goes through GL's [-1, 1] range, which works but
+	// gives back part of the precision.
+	void SetDepthMode(Camera_Depth mode)
+	{
+		depthMode = mode;
+		clipControl = mode == DEPTH_REVERSE_Z && GLAD_GL_ARB_clip_control;
+		if (GLAD_GL_ARB_clip_control)
+			glClipControl(GL_LOWER_LEFT, clipControl ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+		glDepthFunc(mode == DEPTH_REVERSE_Z ? GL_GREATER : GL_LESS);
+		glClearDepth(mode == DEPTH_REVERSE_Z ? 0.0 : 1.0);
+		projectionDirty = true;
+	}
+
+	Camera_Depth GetDepthMode() const
+	{
+		return depthMode;
+	}
+
+	// Returns the perspective projection, rebuilt only when Zoom, SetPerspective or SetDepthMode changed it
+	const glm::mat4& GetProjectionMatrix()
+	{
+		if (projectionDirty || Zoom != projectionZoom) {
+			if (depthMode == DEPTH_REVERSE_Z)
+				projection = reverseZProjection();
+			else
+				projection = glm::perspective(glm::radians(Zoom), aspectRatio, nearDistance, farDistance);
+			projectionZoom = Zoom;
+			projectionDirty = false;
+			viewProjectionDirty = true;
+		}
+		return projection;
+	}
+
+	const glm::mat4& GetViewProjectionMatrix()
+	{
+		update();
+		return viewProjection;
+	}
+
+	// Maps normalized device coordinates back to world space, e.g. for picking
+	const glm::mat4& GetInverseViewProjectionMatrix()
+	{
+		update();
+		return inverseViewProjection;
+	}
+
+	// World space ray through a point given in normalized device coordinates ([-1, 1], y up)
+	void GetPickRay(glm::vec2 point, glm::vec3& origin, glm::vec3& direction)
+	{
+		// Two depths along the ray. The far plane can't be one of them with reverse-Z, it is at infinity.
+		float nearDepth = -1.0f, fartherDepth = 1.0f;
+		if (depthMode == DEPTH_REVERSE_Z) {
+			nearDepth = 1.0f;
+			fartherDepth = clipControl ? 0.5f : 0.0f;
+		}
+		const glm::mat4& inverse = GetInverseViewProjectionMatrix();
+		glm::vec4 nearPoint = inverse * glm::vec4(point, nearDepth, 1.0f);
+		glm::vec4 farPoint = inverse * glm::vec4(point, fartherDepth, 1.0f);
+		origin = glm::vec3(nearPoint) / nearPoint.w;
+		direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+	}
+
+	// Returns the world space planes of what the camera sees through the given projection, which
+	// maps depth like the camera's own (see SetDepthMode)
+	Frustum GetFrustum(const glm::mat4& projection)
+	{
+		return ExtractFrustum(projection * GetViewMatrix(), clipControl, depthMode == DEPTH_REVERSE_Z);
 	}
 
-	// Returns the view matrix calculated using Eular Angles and the LookAt Matrix
-	glm::mat4 GetViewMatrix()
-	{	
-		// 1. Position = known
-		// 2. Calculate cameraDirection
-		glm::vec3 target = Position + Front;
-		glm::vec3 zaxis = glm::normalize(Position - target);
-		// 3. Get positive right axis vector
-		glm::vec3 xaxis = glm::normalize(glm::cross(glm::normalize(WorldUp), zaxis));
-		// 4. Calculate camera up vector
-		glm::vec3 yaxis = glm::cross(zaxis, xaxis);
-
-		// Create translation and rotation matrix
-		// In glm we access elements as mat[col][row] due to column-major layout
-		glm::mat4 translation; // Identity matrix by default
-		translation[3][0] = -Position.x; // Third column, first row
-		translation[3][1] = -Position.y;
-		translation[3][2] = -Position.z;
-		glm::mat4 rotation;
-		rotation[0][0] = xaxis.x; // First column, first row
-		rotation[1][0] = xaxis.y;
-		rotation[2][0] = xaxis.z;
-		rotation[0][1] = yaxis.x; // First column, second row
-		rotation[1][1] = yaxis.y;
-		rotation[2][1] = yaxis.z;
-		rotation[0][2] = zaxis.x; // First column, third row
-		rotation[1][2] = zaxis.y;
-		rotation[2][2] = zaxis.z;
-
-		// Return lookAt matrix as combination of translation and rotation matrix
-		return rotation * translation;
-
-		//return glm::lookAt(Position, Position + Front, Up);
+	// Returns the world space planes of what the camera sees through its own projection
+	Frustum GetFrustum()
+	{
+		return ExtractFrustum(GetViewProjectionMatrix(), clipControl, depthMode == DEPTH_REVERSE_Z);
 	}
 
 	// Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
@@ -117,22 +200,30 @@ public:
 		xoffset *= MouseSensitivity;
 		yoffset *= MouseSensitivity;
 
+		// Make sure that when pitch is out of bounds, screen doesn't get flipped
+		if (constrainPitch)
+			yoffset = glm::clamp(Pitch + yoffset, -89.0f, 89.0f) - Pitch;
+
 		Yaw += xoffset;
 		Pitch += yoffset;
 
-		// Make sure that when pitch is out of bounds, screen doesn't get flipped
-		if (constrainPitch)
-		{
-			if (Pitch > 89.0f)
-				Pitch = 89.0f;
-			if (Pitch < -89.0f)
-				Pitch = -89.0f;
-		}
+		// Yaw turns around the world up axis, pitch around the camera's own right axis
+		Orientation = glm::angleAxis(glm::radians(-xoffset), WorldUp) * Orientation * glm::angleAxis(glm::radians(yoffset), glm::vec3(1.0f, 0.0f, 0.0f));
 
-		// Update Front, Right and Up Vectors using the updated Eular angles
+		// Update Front, Right and Up Vectors using the updated orientation
 		updateCameraVectors();
 	}
 
+	// Turns the camera towards target, which must not be straight above or below it. For scripted
+	// camera paths.
+	void LookAt(glm::vec3 target)
+	{
+		glm::vec3 front = glm::normalize(target - Position);
+		Pitch = glm::degrees(asin(glm::clamp(front.y, -1.0f, 1.0f)));
+		Yaw = glm::degrees(atan2(front.z, front.x));
+		orientFromAngles();
+	}
+
 	// Processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
 	void ProcessMouseScroll(float yoffset)
 	{
@@ -145,18 +236,80 @@ public:
 	}
 
 private:
-	// Calculates the front vector from the Camera's (updated) Eular Angles
-	void updateCameraVectors()
+	// Cached matrices and what they were built from
+	glm::mat4 view, projection, viewProjection, inverseViewProjection;
+	glm::vec3 viewPosition;
+	float projectionZoom;
+	float aspectRatio, nearDistance, farDistance;
+	Camera_Depth depthMode;
+	bool clipControl;
+	bool viewDirty, projectionDirty, viewProjectionDirty;
+
+	// Sets the defaults and builds the starting orientation from the Eular angles
+	void initialize()
+	{
+		aspectRatio = 800.0f / 600.0f;
+		nearDistance = 0.1f;
+		farDistance = 100.0f;
+		depthMode = DEPTH_STANDARD;
+		clipControl = false;
+		projectionDirty = true;
+		orientFromAngles();
+	}
+
+	// Rebuilds the axes and the orientation from Yaw and Pitch. Only runs at construction and in
+	// LookAt; mouse movement instead turns the orientation by two small angle-axis rotations.
+	void orientFromAngles()
 	{
-		// Calculate the new Front vector
 		glm::vec3 front;
 		front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
 		front.y = sin(glm::radians(Pitch));
 		front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
 		Front = glm::normalize(front);
-		// Also re-calculate the Right and Up vector
-		Right = glm::normalize(glm::cross(Front, WorldUp));  // Normalize the vectors, because their length gets closer to 0 the more you look up or down which results in slower movement.
+		Right = glm::normalize(glm::cross(Front, WorldUp));
 		Up = glm::normalize(glm::cross(Right, Front));
+		Orientation = glm::quat_cast(glm::mat3(Right, Up, -Front));
+		viewDirty = true;
+	}
+
+	// Reads the camera axes back from the orientation (the columns of its rotation matrix)
+	void updateCameraVectors()
+	{
+		Orientation = glm::normalize(Orientation);
+		glm::mat3 axes = glm::mat3_cast(Orientation);
+		Right = axes[0];
+		Up = axes[1];
+		Front = -axes[2];
+		viewDirty = true;
+	}
+
+	// Infinite perspective with clip space z = near (w = distance). With clip control that is the
+	// depth directly, otherwise z is mapped so the [-1, 1] range ends up as the same depth.
+	glm::mat4 reverseZProjection() const
+	{
+		float focal = 1.0f / tan(glm::radians(Zoom) * 0.5f);
+		glm::mat4 result(0.0f);
+		result[0][0] = focal / aspectRatio;
+		result[1][1] = focal;
+		result[2][3] = -1.0f;
+		if (clipControl) {
+			result[3][2] = nearDistance;
+		} else {
+			result[2][2] = 1.0f;
+			result[3][2] = 2.0f * nearDistance;
+		}
+		return result;
+	}
+
+	void update()
+	{
+		GetViewMatrix();
+		GetProjectionMatrix();
+		if (viewProjectionDirty) {
+			viewProjection = projection * view;
+			inverseViewProjection = glm::inverse(viewProjection);
+			viewProjectionDirty = false;
+		}
 	}
 };
-#endif
\ No newline at end of file
+#endif
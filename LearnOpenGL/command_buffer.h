@@ -0,0 +1,279 @@
+#pragma once
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "job_system.h"
+#include "render_queue.h"
+
+// Draws, state changes and uniform updates recorded as plain data, so any thread can record
+// while only the thread owning the GL context replays them. A CommandBuffer is one linear byte
+// stream: a 4 byte header and a fixed size payload per command, appended with a bump pointer
+// into memory that is kept from frame to frame. Replaying is a single loop over the bytes.
+//
+// Recording doesn't touch GL and replaying goes through a backend, any type with the methods
+// GLCommandBackend has, so the same streams can be counted, logged or replayed by another API.
+
+enum Command_Type {
+	COMMAND_USE_PROGRAM,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_BIND_TEXTURE,
+	COMMAND_UNIFORM_INT,
+	COMMAND_UNIFORM_FLOAT,
+	COMMAND_UNIFORM_VEC4,
+	COMMAND_UNIFORM_MAT3X4,
+	COMMAND_UNIFORM_MAT4,
+	COMMAND_DRAW_ARRAYS,
+	COMMAND_DRAW_ELEMENTS
+};
+
+struct CommandHeader
+{
+	uint16_t Type;
+	uint16_t Size;	// Header included, so the next command starts Size bytes further
+};
+
+// Payloads; all members are 4 bytes, so every command stays 4 byte aligned. Uniforms store
+// their location followed by only as many floats / ints as the type has.
+struct CommandBindTexture
+{
+	GLuint Unit;
+	GLuint Texture;
+};
+
+struct CommandDrawArrays
+{
+	GLenum Mode;
+	GLint First;
+	GLsizei Count;
+	GLsizei InstanceCount;
+};
+
+struct CommandDrawElements
+{
+	GLenum Mode;
+	GLsizei Count;
+	GLenum IndexType;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLsizei InstanceCount;
+};
+
+class CommandBuffer
+{
+public:
+	CommandBuffer() : used(0), commandCount(0)
+	{
+	}
+
+	// Forgets the commands but keeps the memory, so steady state recording doesn't allocate
+	void Reset()
+	{
+		used = 0;
+		commandCount = 0;
+	}
+
+	void UseProgram(GLuint program)
+	{
+		*(GLuint*) append(COMMAND_USE_PROGRAM, sizeof(GLuint)) = program;
+	}
+
+	void BindVertexArray(GLuint vertexArray)
+	{
+		*(GLuint*) append(COMMAND_BIND_VERTEX_ARRAY, sizeof(GLuint)) = vertexArray;
+	}
+
+	void BindTexture(unsigned int unit, GLuint texture)
+	{
+		CommandBindTexture command = { unit, texture };
+		memcpy(append(COMMAND_BIND_TEXTURE, sizeof(command)), &command, sizeof(command));
+	}
+
+	void SetInt(GLint location, int value)
+	{
+		uniform(COMMAND_UNIFORM_INT, location, &value, 1);
+	}
+
+	void SetFloat(GLint location, float value)
+	{
+		uniform(COMMAND_UNIFORM_FLOAT, location, &value, 1);
+	}
+
+	void SetVec4(GLint location, const glm::vec4& value)
+	{
+		uniform(COMMAND_UNIFORM_VEC4, location, &value[0], 4);
+	}
+
+	void SetMat3x4(GLint location, const glm::mat3x4& value)
+	{
+		uniform(COMMAND_UNIFORM_MAT3X4, location, &value[0][0], 12);
+	}
+
+	void SetMat4(GLint location, const glm::mat4& value)
+	{
+		uniform(COMMAND_UNIFORM_MAT4, location, &value[0][0], 16);
+	}
+
+	void DrawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount = 1)
+	{
+		CommandDrawArrays command = { mode, first, count, instanceCount };
+		memcpy(append(COMMAND_DRAW_ARRAYS, sizeof(command)), &command, sizeof(command));
+	}
+
+	void DrawElements(GLenum mode, GLsizei count, GLenum indexType, GLuint firstIndex, GLint baseVertex = 0, GLsizei instanceCount = 1)
+	{
+		CommandDrawElements command = { mode, count, indexType, firstIndex, baseVertex, instanceCount };
+		memcpy(append(COMMAND_DRAW_ELEMENTS, sizeof(command)), &command, sizeof(command));
+	}
+
+	const unsigned char* GetData() const
+	{
+		return data.empty() ? NULL : &data[0];
+	}
+
+	size_t GetSize() const
+	{
+		return used;
+	}
+
+	unsigned int GetCommandCount() const
+	{
+		return commandCount;
+	}
+
+private:
+	std::vector<unsigned char> data;
+	size_t used;
+	unsigned int commandCount;
+
+	// Reserves a command and returns where its payload goes. Growth doubles, so it is rare and
+	// stops once a frame's worth of commands fits.
+	void* append(Command_Type type, size_t payloadSize)
+	{
+		size_t size = sizeof(CommandHeader) + payloadSize;
+		if (used + size > data.size())
+			data.resize(glm::max(data.size() * 2, used + size + 4096));
+		CommandHeader header = { (uint16_t) type, (uint16_t) size };
+		memcpy(&data[used], &header, sizeof(header));
+		void* payload = &data[used + sizeof(CommandHeader)];
+		used += size;
+		commandCount++;
+		return payload;
+	}
+
+	// Only the values the type uses are stored
+	void uniform(Command_Type type, GLint location, const void* values, unsigned int count)
+	{
+		unsigned char* payload = (unsigned char*) append(type, sizeof(GLint) + count * 4);
+		memcpy(payload, &location, sizeof(GLint));
+		memcpy(payload + sizeof(GLint), values, count * 4);
+	}
+};
+
+// Replays recorded commands on the GL thread, skipping state that is already bound
+class GLCommandBackend
+{
+public:
+	GLStateCache State;
+
+	void UseProgram(GLuint program) { State.UseProgram(program); }
+	void BindVertexArray(GLuint vertexArray) { State.BindVertexArray(vertexArray); }
+	void BindTexture(GLuint unit, GLuint texture) { State.BindTexture(unit, texture); }
+	void SetInt(GLint location, const int* value) { glUniform1i(location, *value); }
+	void SetFloat(GLint location, const float* value) { glUniform1f(location, *value); }
+	void SetVec4(GLint location, const float* value) { glUniform4fv(location, 1, value); }
+	void SetMat3x4(GLint location, const float* value) { glUniformMatrix3x4fv(location, 1, GL_FALSE, value); }
+	void SetMat4(GLint location, const float* value) { glUniformMatrix4fv(location, 1, GL_FALSE, value); }
+
+	void DrawArrays(const CommandDrawArrays& draw)
+	{
+		glDrawArraysInstanced(draw.Mode, draw.First, draw.Count, draw.InstanceCount);
+	}
+
+	void DrawElements(const CommandDrawElements& draw)
+	{
+		glDrawElementsInstancedBaseVertex(draw.Mode, draw.Count, draw.IndexType, (const void*)((size_t) draw.FirstIndex * IndexTypeSize(draw.IndexType)), draw.InstanceCount, draw.BaseVertex);
+	}
+};
+
+// Walks a command stream and hands every command to the backend
+template <typename Backend>
+void ReplayCommands(const CommandBuffer& commands, Backend& backend)
+{
+	const unsigned char* command = commands.GetData();
+	const unsigned char* end = command + commands.GetSize();
+	while (command < end) {
+		CommandHeader header;
+		memcpy(&header, command, sizeof(header));
+		const unsigned char* payload = command + sizeof(CommandHeader);
+		// Uniform payloads: the location, then the values
+		const GLint location = *(const GLint*) payload;
+		const unsigned char* values = payload + sizeof(GLint);
+
+		switch (header.Type) {
+		case COMMAND_USE_PROGRAM:
+			backend.UseProgram(*(const GLuint*) payload);
+			break;
+		case COMMAND_BIND_VERTEX_ARRAY:
+			backend.BindVertexArray(*(const GLuint*) payload);
+			break;
+		case COMMAND_BIND_TEXTURE:
+			backend.BindTexture(((const CommandBindTexture*) payload)->Unit, ((const CommandBindTexture*) payload)->Texture);
+			break;
+		case COMMAND_UNIFORM_INT:
+			backend.SetInt(location, (const int*) values);
+			break;
+		case COMMAND_UNIFORM_FLOAT:
+			backend.SetFloat(location, (const float*) values);
+			break;
+		case COMMAND_UNIFORM_VEC4:
+			backend.SetVec4(location, (const float*) values);
+			break;
+		case COMMAND_UNIFORM_MAT3X4:
+			backend.SetMat3x4(location, (const float*) values);
+			break;
+		case COMMAND_UNIFORM_MAT4:
+			backend.SetMat4(location, (const float*) values);
+			break;
+		case COMMAND_DRAW_ARRAYS:
+			backend.DrawArrays(*(const CommandDrawArrays*) payload);
+			break;
+		case COMMAND_DRAW_ELEMENTS:
+			backend.DrawElements(*(const CommandDrawElements*) payload);
+			break;
+		}
+		command += header.Size;
+	}
+}
+
+// Replays several buffers back to back, in order
+template <typename Backend>
+void ReplayCommands(const std::vector<CommandBuffer>& buffers, Backend& backend)
+{
+	for (size_t i = 0; i < buffers.size(); i++)
+		ReplayCommands(buffers[i], backend);
+}
+
+// Records count items into buffers in parallel on the job system. The items are split in
+// buffers.size() contiguous ranges, one per buffer, and record(buffer, first, last) fills a
+// buffer with its range; replaying the buffers in order then gives the same stream as
+// recording everything on one thread. Use a few buffers per thread so stealing can balance
+// uneven ranges.
+template <typename Record>
+void RecordCommandsParallel(std::vector<CommandBuffer>& buffers, size_t count, const Record& record, JobSystem& jobs = GetJobSystem())
+{
+	size_t bufferCount = buffers.size();
+	jobs.ParallelFor(0, bufferCount, [&](size_t firstBuffer, size_t lastBuffer) {
+		for (size_t b = firstBuffer; b < lastBuffer; b++) {
+			buffers[b].Reset();
+			record(buffers[b], count * b / bufferCount, count * (b + 1) / bufferCount);
+		}
+	}, 1);
+}
+#endif
@@ -0,0 +1,234 @@
+#pragma once
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+#if defined(__AVX__)
+#include <immintrin.h>
+#else
+#include <xmmintrin.h>
+#endif
+
+#include <cfloat>
+#include <vector>
+
+#include "frustum.h"
+
+// Batch frustum culling over bounding volumes stored as structure of arrays. Each plane test
+// covers CULLING_BATCH objects per instruction: 8 with AVX (/arch:AVX), 4 with SSE otherwise.
+// The indices of the visible objects are written to a list, so the draw loop only ever touches
+// what is on screen.
+
+#if defined(__AVX__)
+const unsigned int CULLING_BATCH = 8;
+#else
+const unsigned int CULLING_BATCH = 4;
+#endif
+
+// Bounding spheres, padded to a multiple of CULLING_BATCH with spheres that are never visible
+struct BoundingSpheres
+{
+	std::vector<float> CenterX, CenterY, CenterZ, Radius;
+	unsigned int Count;
+
+	BoundingSpheres() : Count(0)
+	{
+	}
+
+	unsigned int Add(glm::vec3 center, float radius)
+	{
+		if (Count == CenterX.size()) {
+			for (unsigned int i = 0; i < CULLING_BATCH; i++) {
+				CenterX.push_back(0.0f);
+				CenterY.push_back(0.0f);
+				CenterZ.push_back(0.0f);
+				Radius.push_back(-FLT_MAX);
+			}
+		}
+		Set(Count, center, radius);
+		return Count++;
+	}
+
+	void Set(unsigned int index, glm::vec3 center, float radius)
+	{
+		CenterX[index] = center.x;
+		CenterY[index] = center.y;
+		CenterZ[index] = center.z;
+		Radius[index] = radius;
+	}
+
+	void Clear()
+	{
+		CenterX.clear();
+		CenterY.clear();
+		CenterZ.clear();
+		Radius.clear();
+		Count = 0;
+	}
+};
+
+// Axis aligned boxes, padded to a multiple of CULLING_BATCH with inverted boxes that are never visible
+struct BoundingBoxes
+{
+	std::vector<float> MinX, MinY, MinZ, MaxX, MaxY, MaxZ;
+	unsigned int Count;
+
+	BoundingBoxes() : Count(0)
+	{
+	}
+
+	unsigned int Add(glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		if (Count == MinX.size()) {
+			for (unsigned int i = 0; i < CULLING_BATCH; i++) {
+				MinX.push_back(FLT_MAX);
+				MinY.push_back(FLT_MAX);
+				MinZ.push_back(FLT_MAX);
+				MaxX.push_back(-FLT_MAX);
+				MaxY.push_back(-FLT_MAX);
+				MaxZ.push_back(-FLT_MAX);
+			}
+		}
+		Set(Count, boxMin, boxMax);
+		return Count++;
+	}
+
+	void Set(unsigned int index, glm::vec3 boxMin, glm::vec3 boxMax)
+	{
+		MinX[index] = boxMin.x;
+		MinY[index] = boxMin.y;
+		MinZ[index] = boxMin.z;
+		MaxX[index] = boxMax.x;
+		MaxY[index] = boxMax.y;
+		MaxZ[index] = boxMax.z;
+	}
+
+	void Clear()
+	{
+		MinX.clear();
+		MinY.clear();
+		MinZ.clear();
+		MaxX.clear();
+		MaxY.clear();
+		MaxZ.clear();
+		Count = 0;
+	}
+};
+
+// World space box around a transformed local box (Arvo: transform the center, and the half
+// extents by the absolute rotation / scale part)
+inline void TransformBounds(glm::vec3 boxMin, glm::vec3 boxMax, const glm::mat4& model, glm::vec3& worldMin, glm::vec3& worldMax)
+{
+	glm::vec3 center = glm::vec3(model * glm::vec4((boxMin + boxMax) * 0.5f, 1.0f));
+	glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+	glm::vec3 worldExtent = glm::abs(glm::vec3(model[0])) * extent.x + glm::abs(glm::vec3(model[1])) * extent.y + glm::abs(glm::vec3(model[2])) * extent.z;
+	worldMin = center - worldExtent;
+	worldMax = center + worldExtent;
+}
+
+namespace Culling {
+
+#if defined(__AVX__)
+	typedef __m256 Batch;
+	inline Batch load(const float* p) { return _mm256_loadu_ps(p); }
+	inline Batch broadcast(float value) { return _mm256_set1_ps(value); }
+	inline Batch add(Batch a, Batch b) { return _mm256_add_ps(a, b); }
+	inline Batch mul(Batch a, Batch b) { return _mm256_mul_ps(a, b); }
+	inline Batch bitAnd(Batch a, Batch b) { return _mm256_and_ps(a, b); }
+	inline Batch greaterEqual(Batch a, Batch b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	inline Batch allTrue() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+	inline int mask(Batch a) { return _mm256_movemask_ps(a); }
+#else
+	typedef __m128 Batch;
+	inline Batch load(const float* p) { return _mm_loadu_ps(p); }
+	inline Batch broadcast(float value) { return _mm_set1_ps(value); }
+	inline Batch add(Batch a, Batch b) { return _mm_add_ps(a, b); }
+	inline Batch mul(Batch a, Batch b) { return _mm_mul_ps(a, b); }
+	inline Batch bitAnd(Batch a, Batch b) { return _mm_and_ps(a, b); }
+	inline Batch greaterEqual(Batch a, Batch b) { return _mm_cmpge_ps(a, b); }
+	inline Batch allTrue() { return _mm_cmpeq_ps(_mm_setzero_ps(), _mm_setzero_ps()); }
+	inline int mask(Batch a) { return _mm_movemask_ps(a); }
+#endif
+
+	// Appends base + lane for every set bit without branching on the bits: every lane is
+	// written and the count only advances for visible ones, so nothing is written past base + lane.
+	inline unsigned int appendVisible(unsigned int* out, unsigned int count, unsigned int base, int bits)
+	{
+		for (unsigned int lane = 0; lane < CULLING_BATCH; lane++) {
+			out[count] = base + lane;
+			count += (bits >> lane) & 1;
+		}
+		return count;
+	}
+}
+
+// Writes the indices of the spheres intersecting the frustum to the front of `visible` and
+// returns how many there are. `visible` is only ever grown (to the padded sphere count) so
+// reusing it across frames doesn't reinitialize it; entries past the returned count are garbage.
+inline unsigned int CullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<unsigned int>& visible)
+{
+	using namespace Culling;
+	if (spheres.Count == 0)
+		return 0;
+
+	Batch planes[6][4];
+	for (int p = 0; p < 6; p++)
+		for (int c = 0; c < 4; c++)
+			planes[p][c] = broadcast(frustum.Planes[p][c]);
+
+	if (visible.size() < spheres.CenterX.size())
+		visible.resize(spheres.CenterX.size());
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < spheres.Count; i += CULLING_BATCH) {
+		Batch x = load(&spheres.CenterX[i]);
+		Batch y = load(&spheres.CenterY[i]);
+		Batch z = load(&spheres.CenterZ[i]);
+		Batch negativeRadius = mul(load(&spheres.Radius[i]), broadcast(-1.0f));
+
+		Batch inside = allTrue();
+		for (int p = 0; p < 6; p++) {
+			Batch distance = add(add(mul(planes[p][0], x), mul(planes[p][1], y)), add(mul(planes[p][2], z), planes[p][3]));
+			inside = bitAnd(inside, greaterEqual(distance, negativeRadius));
+		}
+		count = appendVisible(&visible[0], count, i, mask(inside));
+	}
+	return count;
+}
+
+// Same as CullSpheres for boxes. Boxes are tested with the corner furthest along each plane normal.
+inline unsigned int CullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<unsigned int>& visible)
+{
+	using namespace Culling;
+	if (boxes.Count == 0)
+		return 0;
+
+	// The plane normal is the same for every box, so the corner to test is known up front
+	Batch planes[6][4];
+	const float* cornerX[6];
+	const float* cornerY[6];
+	const float* cornerZ[6];
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.Planes[p];
+		for (int c = 0; c < 4; c++)
+			planes[p][c] = broadcast(plane[c]);
+		cornerX[p] = plane.x >= 0.0f ? &boxes.MaxX[0] : &boxes.MinX[0];
+		cornerY[p] = plane.y >= 0.0f ? &boxes.MaxY[0] : &boxes.MinY[0];
+		cornerZ[p] = plane.z >= 0.0f ? &boxes.MaxZ[0] : &boxes.MinZ[0];
+	}
+	Batch zero = broadcast(0.0f);
+
+	if (visible.size() < boxes.MinX.size())
+		visible.resize(boxes.MinX.size());
+	unsigned int count = 0;
+	for (unsigned int i = 0; i < boxes.Count; i += CULLING_BATCH) {
+		Batch inside = allTrue();
+		for (int p = 0; p < 6; p++) {
+			Batch distance = add(add(mul(planes[p][0], load(cornerX[p] + i)), mul(planes[p][1], load(cornerY[p] + i))), add(mul(planes[p][2], load(cornerZ[p] + i)), planes[p][3]));
+			inside = bitAnd(inside, greaterEqual(distance, zero));
+		}
+		count = appendVisible(&visible[0], count, i, mask(inside));
+	}
+
+	return count;
+}
+#endif
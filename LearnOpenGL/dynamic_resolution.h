@@ -0,0 +1,310 @@
+#pragma once
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+#include "render_target.h"
+
+// Holds a GPU frame budget by rendering the scene at a lower resolution when it runs over and
+// upscaling it to the window. A GL_TIME_ELAPSED query measures the scene every frame, a controller
+// turns the measurements into a resolution scale, and the scene renders into the lower left part
+// of a render target allocated once at the largest scale, so changing the scale never reallocates.
+//
+// The controller only reacts outside a band around the budget (hysteresis), waits a few frames
+// after each change for the measurements to catch up with it, and grows slower than it shrinks,
+// so the scale settles instead of oscillating between two values.
+
+struct DynamicResolutionSettings
+{
+	float MinScale;	// Per axis, of the window size
+	float MaxScale;
+	double TargetMilliseconds;	// GPU time budget for the scene
+	float DecreaseThreshold;	// Scale down above TargetMilliseconds * DecreaseThreshold
+	float IncreaseThreshold;	// Scale up below TargetMilliseconds * IncreaseThreshold
+	float MaxStep;	// Largest scale change at once; increases are at most half of it
+	unsigned int CooldownFrames;	// Frames without changes after one, covering the query latency
+	float Smoothing;	// Weight of the newest measurement in the moving average
+
+	DynamicResolutionSettings() : MinScale(0.5f), MaxScale(1.0f), TargetMilliseconds(1000.0 / 60.0 * 0.8), DecreaseThreshold(1.0f), IncreaseThreshold(0.8f),
+		MaxStep(0.1f), CooldownFrames(8), Smoothing(0.2f)
+	{
+	}
+};
+
+struct DynamicResolutionStats
+{
+	float Scale;
+	int RenderWidth;
+	int RenderHeight;
+	double GpuMilliseconds;	// Moving average of the scene's GPU time
+	unsigned long long Changes;	// Scale changes so far
+};
+
+// The scale logic on its own, fed one GPU time per frame. Needs no GL.
+class DynamicResolutionController
+{
+public:
+	DynamicResolutionSettings Settings;
+
+	DynamicResolutionController() : scale(1.0f), smoothed(0.0), samples(0), cooldown(0), changes(0)
+	{
+	}
+
+	void Reset(const DynamicResolutionSettings& settings)
+	{
+		Settings = settings;
+		scale = settings.MaxScale;
+		smoothed = 0.0;
+		samples = 0;
+		cooldown = 0;
+		changes = 0;
+	}
+
+	// Takes the GPU time of a frame rendered at the current scale and returns the scale to use next
+	float Update(double gpuMilliseconds)
+	{
+		smoothed = samples == 0 ? gpuMilliseconds : smoothed + Settings.Smoothing * (gpuMilliseconds - smoothed);
+		samples++;
+		if (cooldown > 0) {
+			cooldown--;
+			return scale;
+		}
+
+		double upper = Settings.TargetMilliseconds * Settings.DecreaseThreshold;
+		double lower = Settings.TargetMilliseconds * Settings.IncreaseThreshold;
+		if (smoothed <= upper && smoothed >= lower)
+			return scale;
+
+		// The cost follows the pixel count, the square of the scale; aim for the middle of the band
+		double goal = (upper + lower) * 0.5;
+		float wanted = scale * (float) std::sqrt(goal / glm::max(smoothed, 0.001));
+		wanted = glm::clamp(wanted, scale - Settings.MaxStep, scale + Settings.MaxStep * 0.5f);
+		wanted = glm::clamp(wanted, Settings.MinScale, Settings.MaxScale);
+		if (std::fabs(wanted - scale) < 0.01f)
+			return scale;
+
+		// Until new measurements come in, expect what the new pixel count would cost
+		smoothed *= (wanted * wanted) / (scale * scale);
+		scale = wanted;
+		cooldown = Settings.CooldownFrames;
+		changes++;
+		return scale;
+	}
+
+	float GetScale() const
+	{
+		return scale;
+	}
+
+	double GetSmoothedMilliseconds() const
+	{
+		return smoothed;
+	}
+
+	unsigned long long GetChanges() const
+	{
+		return changes;
+	}
+
+private:
+	float scale;
+	double smoothed;
+	unsigned long long samples;
+	unsigned int cooldown;
+	unsigned long long changes;
+};
+
+// GL_TIME_ELAPSED queries in a small ring, so results are read a few frames later without
+// stalling. A frame is left unmeasured rather than waited for when all queries are still pending.
+class GpuTimer
+{
+public:
+	GpuTimer() : next(0), pending(0), active(false)
+	{
+		for (unsigned int i = 0; i < QUERY_COUNT; i++)
+			queries[i] = 0;
+	}
+
+	void Create()
+	{
+		Release();
+		glGenQueries(QUERY_COUNT, queries);
+	}
+
+	void Begin()
+	{
+		active = pending < QUERY_COUNT;
+		if (active)
+			glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+	}
+
+	void End()
+	{
+		if (!active)
+			return;
+		glEndQuery(GL_TIME_ELAPSED);
+		next = (next + 1) % QUERY_COUNT;
+		pending++;
+		active = false;
+	}
+
+	// Reads the oldest finished measurement into milliseconds. Returns false if none is ready.
+	bool Poll(double& milliseconds)
+	{
+		if (pending == 0)
+			return false;
+		GLuint query = queries[(next + QUERY_COUNT - pending) % QUERY_COUNT];
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+		GLuint64 nanoseconds = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+		milliseconds = nanoseconds / 1000000.0;
+		pending--;
+		return true;
+	}
+
+	void Release()
+	{
+		if (queries[0] != 0)
+			glDeleteQueries(QUERY_COUNT, queries);
+		for (unsigned int i = 0; i < QUERY_COUNT; i++)
+			queries[i] = 0;
+		next = pending = 0;
+		active = false;
+	}
+
+private:
+	static const unsigned int QUERY_COUNT = 4;
+
+	GLuint queries[QUERY_COUNT];
+	unsigned int next;
+	unsigned int pending;
+	bool active;
+};
+
+// Renders the scene at the controller's scale of the window size and upscales it to the window:
+//
+//   resolution.BeginScene();       binds the target at the current scale and starts timing
+//   ... draw the scene ...
+//   resolution.EndScene();
+//   resolution.BlitToScreen();     leaves the window framebuffer bound
+//
+// Call Resize from the framebuffer size callback; the target is recreated at the next BeginScene.
+class DynamicResolution
+{
+public:
+	RenderTarget Target;
+	DynamicResolutionController Controller;
+
+	DynamicResolution() : windowWidth(0), windowHeight(0), renderWidth(0), renderHeight(0), resized(false), colorFormat(GL_RGBA8), depthFormat(GL_DEPTH_COMPONENT32F)
+	{
+	}
+
+	bool Create(int width, int height, const DynamicResolutionSettings& settings = DynamicResolutionSettings(), GLenum newColorFormat = GL_RGBA8, GLenum newDepthFormat = GL_DEPTH_COMPONENT32F)
+	{
+		Release();
+		Controller.Reset(settings);
+		colorFormat = newColorFormat;
+		depthFormat = newDepthFormat;
+		windowWidth = width;
+		windowHeight = height;
+		timer.Create();
+		return createTarget();
+	}
+
+	void Resize(int width, int height)
+	{
+		windowWidth = width;
+		windowHeight = height;
+		resized = true;
+	}
+
+	// Picks up the newest GPU time, updates the scale and binds the target with the viewport and
+	// scissor covering the scaled size
+	void BeginScene()
+	{
+		if (resized) {
+			createTarget();
+			resized = false;
+		}
+		double milliseconds;
+		while (timer.Poll(milliseconds))
+			Controller.Update(milliseconds);
+
+		float scale = Controller.GetScale();
+		renderWidth = glm::clamp((int) (windowWidth * scale + 0.5f), 1, glm::max(Target.Width, 1));
+		renderHeight = glm::clamp((int) (windowHeight * scale + 0.5f), 1, glm::max(Target.Height, 1));
+
+		glBindFramebuffer(GL_FRAMEBUFFER, Target.FBO);
+		glViewport(0, 0, renderWidth, renderHeight);
+		// Clears would otherwise cover the whole target
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(0, 0, renderWidth, renderHeight);
+		timer.Begin();
+	}
+
+	void EndScene()
+	{
+		timer.End();
+		glDisable(GL_SCISSOR_TEST);
+	}
+
+	// Upscales the rendered part of the target to the window
+	void BlitToScreen() const
+	{
+		Target.BlitToScreen(windowWidth, windowHeight, renderWidth, renderHeight);
+		glViewport(0, 0, windowWidth, windowHeight);
+	}
+
+	float GetScale() const
+	{
+		return Controller.GetScale();
+	}
+
+	DynamicResolutionStats GetStats() const
+	{
+		DynamicResolutionStats stats;
+		stats.Scale = Controller.GetScale();
+		stats.RenderWidth = renderWidth;
+		stats.RenderHeight = renderHeight;
+		stats.GpuMilliseconds = Controller.GetSmoothedMilliseconds();
+		stats.Changes = Controller.GetChanges();
+		return stats;
+	}
+
+	void Release()
+	{
+		Target.Release();
+		timer.Release();
+		renderWidth = renderHeight = 0;
+	}
+
+private:
+	GpuTimer timer;
+	int windowWidth;
+	int windowHeight;
+	int renderWidth;
+	int renderHeight;
+	bool resized;
+	GLenum colorFormat;
+	GLenum depthFormat;
+
+	// Sized for the largest scale of the window
+	bool createTarget()
+	{
+		if (windowWidth <= 0 || windowHeight <= 0)
+			return true;	// Minimized, keep the old target
+		int width = (int) std::ceil(windowWidth * Controller.Settings.MaxScale);
+		int height = (int) std::ceil(windowHeight * Controller.Settings.MaxScale);
+		if (width == Target.Width && height == Target.Height)
+			return true;
+		return Target.Create(width, height, colorFormat, depthFormat);
+	}
+};
+#endif
@@ -0,0 +1,241 @@
+#pragma once
+#ifndef FRAME_LOOP_H
+#define FRAME_LOOP_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Game loop with the simulation running at a fixed tick rate, independent of the frame rate.
+// Rendering happens once per frame and blends the last two simulated states, so motion stays
+// smooth whether the display is faster or slower than the ticks. The simulation can run on the
+// calling thread (classic accumulator loop) or on a thread of its own, handing its states to
+// the render thread through a TripleBuffer.
+
+// Default settings
+const double FRAME_LOOP_TICK_RATE = 120.0;
+const unsigned int FRAME_LOOP_MAX_TICKS_PER_FRAME = 8;
+
+enum Frame_Loop_Threading {
+	FRAME_LOOP_SINGLE_THREAD,	// Ticks run on the calling thread before each frame
+	FRAME_LOOP_SIMULATION_THREAD	// Ticks run on their own thread, frames on the calling thread
+};
+
+// Hands the latest value from one producer thread to one consumer thread without locks or
+// waiting: double buffering with a third slot in the middle, so the producer always has a slot
+// to write while the consumer reads another. The producer fills GetWriteBuffer() and publishes
+// it; the consumer calls Update() and reads GetReadBuffer(). Values published in between two
+// Update calls are skipped, only the newest one is seen.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : middle(1), writeIndex(0), readIndex(2)
+	{
+	}
+
+	T& GetWriteBuffer()
+	{
+		return slots[writeIndex].Value;
+	}
+
+	void Publish()
+	{
+		writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Swaps in the newest published value. Returns false if nothing was published since the last call.
+	bool Update()
+	{
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+			return false;
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& GetReadBuffer() const
+	{
+		return slots[readIndex].Value;
+	}
+
+private:
+	static const unsigned int FRESH = 4;
+	static const unsigned int INDEX_MASK = 3;
+
+	// Each slot on its own cache line so the two threads don't share one
+	struct alignas(64) Slot
+	{
+		T Value;
+	};
+
+	Slot slots[3];
+	std::atomic<unsigned int> middle;
+	unsigned int writeIndex;
+	unsigned int readIndex;
+};
+
+struct FrameLoopStats
+{
+	unsigned long long Frames;
+	unsigned long long Ticks;
+	unsigned long long DroppedTicks;	// Ticks skipped because the simulation fell too far behind
+};
+
+// Runs a fixed-timestep simulation on State values and renders them interpolated.
+//
+//   simulate(State& state, double tickSeconds)                       advances the state by one tick
+//   render(const State& previous, const State& current, float alpha)  draws previous blended
+//                                                                      towards current by alpha
+//   keepRunning()                                                      called at the start of each
+//                                                                      frame, before its ticks (the
+//                                                                      place to poll events)
+//
+// With FRAME_LOOP_SIMULATION_THREAD, simulate runs on another thread and must only touch its
+// State and data it owns (e.g. an InputQueue), not GLFW or GL.
+template <typename State>
+class FrameLoop
+{
+public:
+	double TickSeconds;
+	unsigned int MaxTicksPerFrame;
+
+	FrameLoop(double tickRate = FRAME_LOOP_TICK_RATE, unsigned int maxTicksPerFrame = FRAME_LOOP_MAX_TICKS_PER_FRAME) : TickSeconds(1.0 / tickRate), MaxTicksPerFrame(maxTicksPerFrame), ticks(0), droppedTicks(0)
+	{
+		stats.Frames = stats.Ticks = stats.DroppedTicks = 0;
+	}
+
+	template <typename Simulate, typename Render, typename KeepRunning>
+	void Run(const State& initial, Simulate simulate, Render render, KeepRunning keepRunning, Frame_Loop_Threading threading = FRAME_LOOP_SINGLE_THREAD)
+	{
+		if (threading == FRAME_LOOP_SIMULATION_THREAD)
+			runThreaded(initial, simulate, render, keepRunning);
+		else
+			runSingleThread(initial, simulate, render, keepRunning);
+	}
+
+	FrameLoopStats GetStats() const
+	{
+		FrameLoopStats result = stats;
+		result.Ticks = ticks.load();
+		result.DroppedTicks = droppedTicks.load();
+		return result;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// What the simulation thread hands to the renderer: the two latest ticks and when the newer ended
+	struct Snapshot
+	{
+		State Previous;
+		State Current;
+		Clock::time_point Time;
+	};
+
+	FrameLoopStats stats;
+	std::atomic<unsigned long long> ticks;
+	std::atomic<unsigned long long> droppedTicks;
+
+	double seconds(Clock::duration duration) const
+	{
+		return std::chrono::duration<double>(duration).count();
+	}
+
+	// Runs the ticks that fit in `accumulator`, at most MaxTicksPerFrame; the rest is dropped so a
+	// long stall doesn't turn into a spiral of ever longer catch-ups
+	template <typename Simulate>
+	void tick(State& previous, State& current, double& accumulator, Simulate& simulate)
+	{
+		unsigned int count = 0;
+		while (accumulator >= TickSeconds) {
+			if (count == MaxTicksPerFrame) {
+				unsigned long long dropped = (unsigned long long) (accumulator / TickSeconds);
+				droppedTicks += dropped;
+				accumulator -= dropped * TickSeconds;
+				break;
+			}
+			previous = current;
+			simulate(current, TickSeconds);
+			accumulator -= TickSeconds;
+			count++;
+		}
+		ticks += count;
+	}
+
+	template <typename Simulate, typename Render, typename KeepRunning>
+	void runSingleThread(const State& initial, Simulate& simulate, Render& render, KeepRunning& keepRunning)
+	{
+		ticks = 0;
+		droppedTicks = 0;
+		State previous = initial;
+		State current = initial;
+		double accumulator = 0.0;
+		Clock::time_point last = Clock::now();
+
+		while (keepRunning()) {
+			Clock::time_point now = Clock::now();
+			accumulator += seconds(now - last);
+			last = now;
+
+			tick(previous, current, accumulator, simulate);
+			render(previous, current, (float) (accumulator / TickSeconds));
+			stats.Frames++;
+		}
+	}
+
+	template <typename Simulate, typename Render, typename KeepRunning>
+	void runThreaded(const State& initial, Simulate& simulate, Render& render, KeepRunning& keepRunning)
+	{
+		ticks = 0;
+		droppedTicks = 0;
+		TripleBuffer<Snapshot> snapshots;
+		std::atomic<bool> running(true);
+
+		// The first frame can render before the first tick finished
+		Snapshot& first = snapshots.GetWriteBuffer();
+		first.Previous = first.Current = initial;
+		first.Time = Clock::now();
+		snapshots.Publish();
+		snapshots.Update();
+
+		std::thread simulation([&]() {
+			State previous = initial;
+			State current = initial;
+			double accumulator = 0.0;
+			Clock::time_point last = Clock::now();
+			Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(TickSeconds));
+
+			while (running.load(std::memory_order_relaxed)) {
+				Clock::time_point now = Clock::now();
+				accumulator += seconds(now - last);
+				last = now;
+
+				unsigned long long before = ticks.load(std::memory_order_relaxed);
+				tick(previous, current, accumulator, simulate);
+				if (ticks.load(std::memory_order_relaxed) != before) {
+					Snapshot& snapshot = snapshots.GetWriteBuffer();
+					snapshot.Previous = previous;
+					snapshot.Current = current;
+					snapshot.Time = now - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(accumulator));
+					snapshots.Publish();
+				}
+
+				// Sleep until the next tick is due
+				std::this_thread::sleep_until(last + tickDuration - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(accumulator)));
+			}
+		});
+
+		while (keepRunning()) {
+			snapshots.Update();
+			const Snapshot& snapshot = snapshots.GetReadBuffer();
+			float alpha = (float) std::min(seconds(Clock::now() - snapshot.Time) / TickSeconds, 1.0);
+			render(snapshot.Previous, snapshot.Current, alpha);
+			stats.Frames++;
+		}
+
+		running = false;
+		simulation.join();
+	}
+};
+#endif
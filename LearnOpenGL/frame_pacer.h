@@ -0,0 +1,282 @@
+#pragma once
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// Keeps the CPU at most MaxFramesInFlight frames ahead of the GPU. Without it the driver lets the
+// CPU queue up as many frames as it likes, and every queued frame is a frame of input latency.
+// Each frame gets a fence behind its swap; BeginFrame waits for the oldest one once the limit is
+// reached, and only then is input polled, so what the frame draws is as fresh as it can be:
+//
+//   pacer.BeginFrame();        waits until fewer than MaxFramesInFlight frames are unfinished
+//   glfwPollEvents();
+//   pacer.InputSampled();      then simulate, upload the camera matrices and draw
+//   ...
+//   glfwSwapBuffers(window);
+//   pacer.EndFrame();
+//
+// A GL_TIMESTAMP query behind each frame tells when the GPU finished it, which gives the latency
+// from sampling input to the finished frame (scan out adds up to one refresh on top).
+
+const unsigned int FRAME_PACER_MAX_DEPTH = 8;
+const unsigned int FRAME_PACER_DEFAULT_DEPTH = 2;
+const unsigned int FRAME_PACER_HISTORY = 120;	// Frames the statistics cover
+
+// One frame, complete once the GPU finished it
+struct PacedFrame
+{
+	unsigned long long Index;
+	double FrameMilliseconds;	// Since the previous frame began
+	double ThrottleMilliseconds;	// Waiting for the GPU in BeginFrame
+	double InputToSubmitMilliseconds;	// From InputSampled to EndFrame
+	double LatencyMilliseconds;	// From InputSampled to the GPU finishing the frame
+};
+
+struct FramePacerStats
+{
+	unsigned long long Frames;
+	unsigned long long ThrottledFrames;
+	double MeanFrameMilliseconds;	// Over the last FRAME_PACER_HISTORY frames
+	double FrameTimeVariance;	// In ms squared
+	double FrameTimeDeviation;	// In ms
+	double MaxFrameMilliseconds;
+	double MeanLatencyMilliseconds;
+	double MaxLatencyMilliseconds;
+	unsigned int FramesInFlight;
+};
+
+class FramePacer
+{
+public:
+	unsigned int MaxFramesInFlight;	// 1 is the lowest latency, higher keeps the GPU busier
+
+	FramePacer() : MaxFramesInFlight(FRAME_PACER_DEFAULT_DEPTH), first(0), count(0), frameIndex(0), throttledFrames(0), historyCount(0), historyNext(0), hasPreviousBegin(false), inFrame(false), timerQueries(false), gpuCalibration(0)
+	{
+		for (unsigned int i = 0; i < FRAME_PACER_MAX_DEPTH; i++) {
+			frames[i].Fence = 0;
+			frames[i].Query = 0;
+		}
+		last = PacedFrame();
+	}
+
+	void Create(unsigned int maxFramesInFlight = FRAME_PACER_DEFAULT_DEPTH)
+	{
+		Release();
+		if (maxFramesInFlight < 1 || maxFramesInFlight > FRAME_PACER_MAX_DEPTH) {
+			std::cout << "ERROR::FRAME_PACER::DEPTH: " << maxFramesInFlight << " is not in 1.." << FRAME_PACER_MAX_DEPTH << std::endl;
+			maxFramesInFlight = FRAME_PACER_DEFAULT_DEPTH;
+		}
+		MaxFramesInFlight = maxFramesInFlight;
+
+		GLint bits = 0;
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+		timerQueries = bits > 0;
+		for (unsigned int i = 0; i < FRAME_PACER_MAX_DEPTH; i++)
+			if (timerQueries)
+				glGenQueries(1, &frames[i].Query);
+	}
+
+	// Retires the frames the GPU has finished, waiting for the oldest one while MaxFramesInFlight
+	// are still unfinished. Returns how long it waited, in ms.
+	double BeginFrame()
+	{
+		Clock::time_point start = Clock::now();
+		retire(false);
+		bool throttled = false;
+		while (count >= MaxFramesInFlight) {
+			retire(true);
+			throttled = true;
+		}
+		Clock::time_point now = Clock::now();
+
+		// The GPU clock is read once per frame to place its timestamps on the CPU clock
+		if (timerQueries) {
+			GLint64 gpuNow = 0;
+			glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+			gpuCalibration = gpuNow;
+			cpuCalibration = now;
+		}
+
+		current.Index = frameIndex++;
+		current.ThrottleMilliseconds = milliseconds(now - start);
+		current.FrameMilliseconds = hasPreviousBegin ? milliseconds(now - previousBegin) : 0.0;
+		current.Input = now;
+		previousBegin = now;
+		hasPreviousBegin = true;
+		inFrame = true;
+		if (throttled)
+			throttledFrames++;
+		return current.ThrottleMilliseconds;
+	}
+
+	// Marks when input was read for this frame, the start of its latency
+	void InputSampled()
+	{
+		current.Input = Clock::now();
+	}
+
+	// Fences the frame; call right after glfwSwapBuffers
+	void EndFrame()
+	{
+		if (!inFrame)
+			return;
+		InFlight& frame = frames[(first + count) % FRAME_PACER_MAX_DEPTH];
+		Clock::time_point now = Clock::now();
+		if (timerQueries)
+			glQueryCounter(frame.Query, GL_TIMESTAMP);
+		frame.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frame.Index = current.Index;
+		frame.FrameMilliseconds = current.FrameMilliseconds;
+		frame.ThrottleMilliseconds = current.ThrottleMilliseconds;
+		frame.InputToSubmitMilliseconds = milliseconds(now - current.Input);
+		frame.Input = current.Input;
+		frame.GpuCalibration = gpuCalibration;
+		frame.CpuCalibration = cpuCalibration;
+		count++;
+		inFrame = false;
+	}
+
+	// The newest frame the GPU has finished
+	const PacedFrame& GetLastFrame() const
+	{
+		return last;
+	}
+
+	FramePacerStats GetStats() const
+	{
+		FramePacerStats stats = {};
+		stats.Frames = frameIndex;
+		stats.ThrottledFrames = throttledFrames;
+		stats.FramesInFlight = count;
+		if (historyCount == 0)
+			return stats;
+
+		double frameSum = 0.0, latencySum = 0.0;
+		for (unsigned int i = 0; i < historyCount; i++) {
+			frameSum += history[i].FrameMilliseconds;
+			latencySum += history[i].LatencyMilliseconds;
+			stats.MaxFrameMilliseconds = glm::max(stats.MaxFrameMilliseconds, history[i].FrameMilliseconds);
+			stats.MaxLatencyMilliseconds = glm::max(stats.MaxLatencyMilliseconds, history[i].LatencyMilliseconds);
+		}
+		stats.MeanFrameMilliseconds = frameSum / historyCount;
+		stats.MeanLatencyMilliseconds = latencySum / historyCount;
+		double squares = 0.0;
+		for (unsigned int i = 0; i < historyCount; i++) {
+			double difference = history[i].FrameMilliseconds - stats.MeanFrameMilliseconds;
+			squares += difference * difference;
+		}
+		stats.FrameTimeVariance = squares / historyCount;
+		stats.FrameTimeDeviation = std::sqrt(stats.FrameTimeVariance);
+		return stats;
+	}
+
+	// Waits for the frames still in flight and deletes the fences and queries
+	void Release()
+	{
+		while (count > 0)
+			retire(true);
+		for (unsigned int i = 0; i < FRAME_PACER_MAX_DEPTH; i++) {
+			if (frames[i].Query != 0)
+				glDeleteQueries(1, &frames[i].Query);
+			frames[i].Query = 0;
+		}
+		first = 0;
+		timerQueries = false;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct InFlight
+	{
+		GLsync Fence;
+		GLuint Query;
+		unsigned long long Index;
+		double FrameMilliseconds;
+		double ThrottleMilliseconds;
+		double InputToSubmitMilliseconds;
+		Clock::time_point Input;
+		GLint64 GpuCalibration;	// GL_TIMESTAMP and the CPU time it was read at
+		Clock::time_point CpuCalibration;
+	};
+
+	// The frame being recorded
+	struct Current
+	{
+		unsigned long long Index;
+		double FrameMilliseconds;
+		double ThrottleMilliseconds;
+		Clock::time_point Input;
+	};
+
+	InFlight frames[FRAME_PACER_MAX_DEPTH];
+	unsigned int first;	// Oldest frame in flight
+	unsigned int count;
+	Current current;
+	unsigned long long frameIndex;
+	unsigned long long throttledFrames;
+	PacedFrame last;
+	PacedFrame history[FRAME_PACER_HISTORY];
+	unsigned int historyCount;
+	unsigned int historyNext;
+	Clock::time_point previousBegin;
+	bool hasPreviousBegin;
+	bool inFrame;
+	bool timerQueries;
+	GLint64 gpuCalibration;
+	Clock::time_point cpuCalibration;
+
+	static double milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	// Retires finished frames from the oldest on. With wait, blocks until at least the oldest is.
+	void retire(bool wait)
+	{
+		while (count > 0) {
+			InFlight& frame = frames[first];
+			GLenum result = glClientWaitSync(frame.Fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED) {
+				if (!wait)
+					return;
+				// Flush so the fence can ever signal
+				do
+					result = glClientWaitSync(frame.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+				while (result == GL_TIMEOUT_EXPIRED);
+			}
+			if (result == GL_WAIT_FAILED)
+				std::cout << "ERROR::FRAME_PACER::WAIT_FAILED: frame " << frame.Index << std::endl;
+			Clock::time_point finished = Clock::now();
+			glDeleteSync(frame.Fence);
+			frame.Fence = 0;
+
+			// The GPU's own timestamp when there is one, else when the fence was seen, which is later
+			if (timerQueries) {
+				GLint64 gpuFinished = 0;
+				glGetQueryObjecti64v(frame.Query, GL_QUERY_RESULT, &gpuFinished);
+				finished = frame.CpuCalibration + std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(gpuFinished - frame.GpuCalibration));
+			}
+
+			last.Index = frame.Index;
+			last.FrameMilliseconds = frame.FrameMilliseconds;
+			last.ThrottleMilliseconds = frame.ThrottleMilliseconds;
+			last.InputToSubmitMilliseconds = frame.InputToSubmitMilliseconds;
+			last.LatencyMilliseconds = glm::max(milliseconds(finished - frame.Input), frame.InputToSubmitMilliseconds);
+			history[historyNext] = last;
+			historyNext = (historyNext + 1) % FRAME_PACER_HISTORY;
+			historyCount = glm::min(historyCount + 1, FRAME_PACER_HISTORY);
+
+			first = (first + 1) % FRAME_PACER_MAX_DEPTH;
+			count--;
+			wait = false;
+		}
+	}
+};
+#endif
@@ -0,0 +1,224 @@
+#pragma once
+#ifndef FRAME_RING_BUFFER_H
+#define FRAME_RING_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <iostream>
+
+// One big GL buffer for everything that is rewritten every frame (instance data, uniform blocks,
+// dynamic vertices), instead of a glBufferData or glUniform call per item. The buffer is split in
+// FrameCount slices used round robin; each frame bump allocates from its slice and a fence marks
+// when the GPU is done reading it, so the CPU only ever waits when it gets FrameCount frames ahead.
+//
+// With GL 4.4 / ARB_buffer_storage the buffer is mapped once, persistently and coherently, and
+// written directly. Otherwise each slice is mapped unsynchronized at the start of its frame (the
+// fences do the synchronization the driver would) and unmapped by FinishWrites.
+//
+// Per frame:
+//   ring.BeginFrame();                               waits for the slice if the GPU still reads it
+//   void* data = ring.Allocate(size, align, offset);  any number of times, write into data
+//   ring.FinishWrites();                             before the draws that read the data
+//   ... draws using Buffer at the returned offsets ...
+//   ring.EndFrame();                                 after those draws
+
+const unsigned int FRAME_RING_FRAMES = 3;	// Frames the CPU may be ahead of the GPU
+
+struct FrameRingStats
+{
+	unsigned long long Frames;
+	unsigned long long Stalls;	// Frames that had to wait for the GPU to release their slice
+	double StallMilliseconds;	// Total time spent waiting
+	unsigned long long Overflows;	// Allocations that didn't fit in their slice
+	GLsizeiptr PeakBytes;	// Most bytes a single frame used
+};
+
+class FrameRingBuffer
+{
+public:
+	unsigned int Buffer;
+	GLsizeiptr FrameSize;	// Bytes per slice
+	unsigned int FrameCount;
+	bool Persistent;	// Mapped once with ARB_buffer_storage rather than per frame
+
+	FrameRingBuffer() : Buffer(0), FrameSize(0), FrameCount(0), Persistent(false), mapped(NULL), frame(0), head(0), inFrame(false), uniformAlignment(256)
+	{
+		for (unsigned int i = 0; i < MAX_FRAMES; i++)
+			fences[i] = 0;
+		resetStats();
+	}
+
+	// Allocates FrameCount slices of frameSize bytes. Returns false if the buffer couldn't be
+	// created or mapped.
+	bool Create(GLsizeiptr frameSize, unsigned int frameCount = FRAME_RING_FRAMES)
+	{
+		Release();
+		if (frameCount == 0 || frameCount > MAX_FRAMES) {
+			std::cout << "ERROR::FRAME_RING_BUFFER::FRAME_COUNT: " << frameCount << " is not in 1.." << MAX_FRAMES << std::endl;
+			return false;
+		}
+		FrameSize = frameSize;
+		FrameCount = frameCount;
+		Persistent = GLAD_GL_ARB_buffer_storage != 0;
+
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		if (uniformAlignment <= 0)
+			uniformAlignment = 256;
+
+		glGenBuffers(1, &Buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+		if (Persistent) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, frameSize * frameCount, NULL, flags);
+			mapped = (unsigned char*) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, frameSize * frameCount, flags);
+			if (mapped == NULL) {
+				std::cout << "ERROR::FRAME_RING_BUFFER::MAP_FAILED: persistent mapping of " << frameSize * frameCount << " bytes" << std::endl;
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				Release();
+				return false;
+			}
+		} else {
+			glBufferData(GL_COPY_WRITE_BUFFER, frameSize * frameCount, NULL, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		resetStats();
+		return true;
+	}
+
+	// Starts the next frame on the next slice, waiting for the GPU to finish the frame that used
+	// it last if it hasn't yet
+	void BeginFrame()
+	{
+		frame = (frame + 1) % FrameCount;
+		head = 0;
+		inFrame = true;
+		waitForFence(fences[frame]);
+		fences[frame] = 0;
+
+		if (!Persistent) {
+			glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+			mapped = (unsigned char*) glMapBufferRange(GL_COPY_WRITE_BUFFER, frame * FrameSize, FrameSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			if (mapped == NULL)
+				std::cout << "ERROR::FRAME_RING_BUFFER::MAP_FAILED: slice " << frame << std::endl;
+		}
+	}
+
+	// Reserves size bytes in this frame's slice at a multiple of alignment. Returns where to write
+	// them, and in offset where they are in Buffer (for glBindBufferRange, attribute pointers or
+	// draw offsets). Returns NULL if the slice is full.
+	void* Allocate(GLsizeiptr size, GLsizeiptr alignment, GLintptr& offset)
+	{
+		if (alignment < 1)
+			alignment = 1;
+		GLsizeiptr start = (head + alignment - 1) / alignment * alignment;
+		if (!inFrame || mapped == NULL || start + size > FrameSize) {
+			if (inFrame && mapped != NULL && stats.Overflows++ == 0)
+				std::cout << "ERROR::FRAME_RING_BUFFER::OUT_OF_SPACE: " << size << " bytes don't fit in a " << FrameSize << " byte frame" << std::endl;
+			offset = 0;
+			return NULL;
+		}
+		head = start + size;
+		if (head > stats.PeakBytes)
+			stats.PeakBytes = head;
+
+		offset = frame * FrameSize + start;
+		return Persistent ? mapped + offset : mapped + start;
+	}
+
+	// Allocate aligned for glBindBufferRange(GL_UNIFORM_BUFFER, ...)
+	void* AllocateUniform(GLsizeiptr size, GLintptr& offset)
+	{
+		return Allocate(size, uniformAlignment, offset);
+	}
+
+	// Makes this frame's writes visible to GL. Coherent persistent memory needs nothing; the
+	// per frame mapping is unmapped, after which Allocate returns NULL until the next frame.
+	void FinishWrites()
+	{
+		if (Persistent || mapped == NULL)
+			return;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		mapped = NULL;
+	}
+
+	// Fences the commands that read this frame's slice. Call after the last of them.
+	void EndFrame()
+	{
+		FinishWrites();
+		fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		inFrame = false;
+		stats.Frames++;
+	}
+
+	FrameRingStats GetStats() const
+	{
+		return stats;
+	}
+
+	void Release()
+	{
+		for (unsigned int i = 0; i < MAX_FRAMES; i++) {
+			if (fences[i] != 0)
+				glDeleteSync(fences[i]);
+			fences[i] = 0;
+		}
+		if (Buffer != 0) {
+			if (mapped != NULL) {
+				glBindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+				glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			}
+			glDeleteBuffers(1, &Buffer);
+		}
+		Buffer = 0;
+		mapped = NULL;
+		FrameSize = 0;
+		FrameCount = 0;
+		frame = 0;
+		head = 0;
+		inFrame = false;
+	}
+
+private:
+	static const unsigned int MAX_FRAMES = 8;
+
+	unsigned char* mapped;	// Whole buffer when persistent, else the current slice while mapped
+	GLsync fences[MAX_FRAMES];
+	unsigned int frame;
+	GLsizeiptr head;	// Bytes used in the current slice
+	bool inFrame;
+	GLint uniformAlignment;
+	FrameRingStats stats;
+
+	void resetStats()
+	{
+		stats.Frames = stats.Stalls = stats.Overflows = 0;
+		stats.StallMilliseconds = 0.0;
+		stats.PeakBytes = 0;
+	}
+
+	// A signaled fence costs one non blocking check. Otherwise the CPU is FrameCount frames
+	// ahead: flush so the fence can ever signal, wait, and count the stall.
+	void waitForFence(GLsync fence)
+	{
+		if (fence == 0)
+			return;
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			do
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (result == GL_TIMEOUT_EXPIRED);
+			stats.Stalls++;
+			stats.StallMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		}
+		if (result == GL_WAIT_FAILED)
+			std::cout << "ERROR::FRAME_RING_BUFFER::WAIT_FAILED" << std::endl;
+		glDeleteSync(fence);
+	}
+};
+#endif
@@ -0,0 +1,119 @@
+#pragma once
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+#include "camera.h"
+#include "frame_ring_buffer.h"
+#include "shader_m.h"
+
+// Camera and timing data every shader of a frame shares, uploaded once per frame into one uniform
+// buffer instead of setMat4 calls per program. Shaders declare the block as
+//
+//   layout (std140) uniform PerFrame
+//   {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProjection;
+//       vec3 cameraPosition;
+//       float time;
+//   };
+//
+// and Shader binds it to UNIFORM_BINDING_PER_FRAME by name, whichever of the two is created first.
+
+const GLuint UNIFORM_BINDING_PER_FRAME = 0;
+
+// Mirrors the std140 layout above: mat4 columns are vec4 aligned, and the float packs into the
+// last four bytes of the vec3's 16 byte slot
+struct PerFrameUniforms
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::vec3 CameraPosition;
+	float Time;
+};
+static_assert(sizeof(PerFrameUniforms) == 208, "PerFrameUniforms must match the std140 PerFrame block");
+
+inline PerFrameUniforms MakePerFrameUniforms(const glm::mat4& view, const glm::mat4& projection, glm::vec3 cameraPosition, float time)
+{
+	PerFrameUniforms uniforms;
+	uniforms.View = view;
+	uniforms.Projection = projection;
+	uniforms.ViewProjection = projection * view;
+	uniforms.CameraPosition = cameraPosition;
+	uniforms.Time = time;
+	return uniforms;
+}
+
+// Uses the matrices the camera has cached already
+inline PerFrameUniforms MakePerFrameUniforms(Camera& camera, float time)
+{
+	PerFrameUniforms uniforms;
+	uniforms.View = camera.GetViewMatrix();
+	uniforms.Projection = camera.GetProjectionMatrix();
+	uniforms.ViewProjection = camera.GetViewProjectionMatrix();
+	uniforms.CameraPosition = camera.Position;
+	uniforms.Time = time;
+	return uniforms;
+}
+
+// The PerFrame block's buffer, bound at UNIFORM_BINDING_PER_FRAME
+class PerFrameUniformBuffer
+{
+public:
+	unsigned int UBO;
+
+	PerFrameUniformBuffer() : UBO(0)
+	{
+	}
+
+	// Registers the block's binding point, which binds it in the shaders built so far as well as
+	// in those built later, and creates the buffer
+	void Create()
+	{
+		Release();
+		RegisterUniformBlock("PerFrame", UNIFORM_BINDING_PER_FRAME, sizeof(PerFrameUniforms));
+		glGenBuffers(1, &UBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(PerFrameUniforms), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING_PER_FRAME, UBO);
+	}
+
+	// Replaces the contents of the buffer, which stays bound
+	void Upload(const PerFrameUniforms& uniforms)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerFrameUniforms), &uniforms);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// Writes the block into this frame's slice of a ring buffer instead and binds that range, so
+	// the upload never waits on draws of earlier frames still reading the block. Falls back to
+	// the own buffer if the ring is full.
+	void Upload(const PerFrameUniforms& uniforms, FrameRingBuffer& ring)
+	{
+		GLintptr offset;
+		void* data = ring.AllocateUniform(sizeof(PerFrameUniforms), offset);
+		if (data == NULL) {
+			Upload(uniforms);
+			glBindBufferBase(GL_UNIFORM_BUFFER, UNIFORM_BINDING_PER_FRAME, UBO);
+			return;
+		}
+		memcpy(data, &uniforms, sizeof(PerFrameUniforms));
+		glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BINDING_PER_FRAME, ring.Buffer, offset, sizeof(PerFrameUniforms));
+	}
+
+	void Release()
+	{
+		if (UBO != 0)
+			glDeleteBuffers(1, &UBO);
+		UBO = 0;
+	}
+};
+#endif
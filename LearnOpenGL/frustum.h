@@ -0,0 +1,104 @@
+#pragma once
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include "affine.h"
+
+// Indices of the planes in Frustum::Planes
+enum Frustum_Plane {
+	FRUSTUM_LEFT,
+	FRUSTUM_RIGHT,
+	FRUSTUM_BOTTOM,
+	FRUSTUM_TOP,
+	FRUSTUM_NEAR,
+	FRUSTUM_FAR
+};
+
+// Six planes (xyz = normal pointing inside, w = distance) bounding what a camera sees.
+// A point p is inside a plane when dot(plane.xyz, p) + plane.w >= 0.
+struct Frustum
+{
+	glm::vec4 Planes[6];
+};
+
+// Normalizes a plane so distances come out in world units. Degenerate planes (the far plane of
+// an infinite projection) become planes everything is in front of.
+inline glm::vec4 NormalizePlane(glm::vec4 plane)
+{
+	float length = glm::length(glm::vec3(plane));
+	if (length < 1e-6f)
+		return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	return plane / length;
+}
+
+// Extracts the planes of a projection * view matrix (Gribb / Hartmann). With a view matrix the
+// planes are in world space, with projection * view * model they are in object space.
+// zeroToOneDepth is for clip space depth in [0, w] (glClipControl GL_ZERO_TO_ONE) instead of
+// [-w, w]; reversedDepth for projections mapping the near plane to the far end of the range
+// (reverse-Z), whose far plane at infinity comes out degenerate.
+inline Frustum ExtractFrustum(const glm::mat4& matrix, bool zeroToOneDepth = false, bool reversedDepth = false)
+{
+	// In glm we access elements as mat[col][row] due to column-major layout
+	glm::vec4 row0(matrix[0][0], matrix[1][0], matrix[2][0], matrix[3][0]);
+	glm::vec4 row1(matrix[0][1], matrix[1][1], matrix[2][1], matrix[3][1]);
+	glm::vec4 row2(matrix[0][2], matrix[1][2], matrix[2][2], matrix[3][2]);
+	glm::vec4 row3(matrix[0][3], matrix[1][3], matrix[2][3], matrix[3][3]);
+
+	// Lower and upper end of the clip space depth range
+	glm::vec4 lower = zeroToOneDepth ? row2 : row3 + row2;
+	glm::vec4 upper = row3 - row2;
+
+	Frustum frustum;
+	frustum.Planes[FRUSTUM_LEFT] = NormalizePlane(row3 + row0);
+	frustum.Planes[FRUSTUM_RIGHT] = NormalizePlane(row3 - row0);
+	frustum.Planes[FRUSTUM_BOTTOM] = NormalizePlane(row3 + row1);
+	frustum.Planes[FRUSTUM_TOP] = NormalizePlane(row3 - row1);
+	frustum.Planes[FRUSTUM_NEAR] = NormalizePlane(reversedDepth ? upper : lower);
+	frustum.Planes[FRUSTUM_FAR] = NormalizePlane(reversedDepth ? lower : upper);
+	return frustum;
+}
+
+// Moves world space planes into the object space of a model matrix. Distances stay exact for
+// rotations, translations and uniform scales.
+inline Frustum TransformFrustum(const Frustum& frustum, const glm::mat4& model)
+{
+	Frustum result;
+	for (int i = 0; i < 6; i++)
+		result.Planes[i] = NormalizePlane(frustum.Planes[i] * model);
+	return result;
+}
+
+inline Frustum TransformFrustum(const Frustum& frustum, const Affine& model)
+{
+	Frustum result;
+	for (int i = 0; i < 6; i++) {
+		const glm::vec4& plane = frustum.Planes[i];
+		glm::vec4 transformed = plane.x * model.Rows[0] + plane.y * model.Rows[1] + plane.z * model.Rows[2];
+		transformed.w += plane.w;
+		result.Planes[i] = NormalizePlane(transformed);
+	}
+	return result;
+}
+
+inline bool IsSphereInFrustum(const Frustum& frustum, glm::vec3 center, float radius)
+{
+	for (int i = 0; i < 6; i++)
+		if (glm::dot(glm::vec3(frustum.Planes[i]), center) + frustum.Planes[i].w < -radius)
+			return false;
+	return true;
+}
+
+inline bool IsBoxInFrustum(const Frustum& frustum, glm::vec3 boxMin, glm::vec3 boxMax)
+{
+	for (int i = 0; i < 6; i++) {
+		// Test the corner furthest along the plane normal
+		const glm::vec4& plane = frustum.Planes[i];
+		glm::vec3 corner(plane.x >= 0.0f ? boxMax.x : boxMin.x, plane.y >= 0.0f ? boxMax.y : boxMin.y, plane.z >= 0.0f ? boxMax.z : boxMin.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+#endif
@@ -0,0 +1,779 @@
+#pragma once
+#ifndef GPU_HEAP_H
+#define GPU_HEAP_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#include "mesh.h"
+
+// A few large GL buffers ("pages") that meshes and other static data are sub-allocated from,
+// instead of a glGenBuffers + glBufferData per mesh. Ranges are handed out by a TLSF allocator
+// per page, in constant time whatever the number of blocks:
+//
+//   first level   the power of two of the size
+//   second level  that power of two range split in TLSF_SECOND_LEVEL_COUNT linear classes
+//
+// and a bitmap per level finds the smallest non-empty class that is large enough with two bit
+// scans. Freed blocks merge with free neighbours right away.
+//
+// Draws already submitted may still read a range when it is freed, so GpuHeap::Free only queues
+// it; EndFrame puts a fence behind the frame's frees and the ranges are reused once the GPU has
+// passed it. Defragment moves a few allocations per call towards the front of the heap with
+// glCopyBufferSubData, so trailing pages empty out and are deleted.
+
+const unsigned int TLSF_GRANULARITY = 16;	// Bytes; sizes and offsets are multiples of it
+const unsigned int TLSF_SECOND_LEVEL_BITS = 4;
+const unsigned int TLSF_SECOND_LEVEL_COUNT = 1 << TLSF_SECOND_LEVEL_BITS;
+const unsigned int TLSF_FIRST_LEVEL_COUNT = 28;	// Enough for 4 GB pages
+const uint32_t TLSF_INVALID = 0xFFFFFFFFu;
+
+// TLSF over the byte range [0, capacity). Only bookkeeping, it never touches GL, so it serves
+// any kind of memory. Allocations are identified by their block index, which stays valid until
+// the block is freed.
+class TlsfAllocator
+{
+public:
+	TlsfAllocator() : capacity(0), used(0), freeBlockCount(0), firstLevelMap(0)
+	{
+		clearLists();
+	}
+
+	void Reset(uint32_t newCapacity)
+	{
+		capacity = newCapacity / TLSF_GRANULARITY * TLSF_GRANULARITY;
+		used = 0;
+		freeBlockCount = 0;
+		blocks.clear();
+		unusedBlocks.clear();
+		clearLists();
+		if (capacity > 0) {
+			uint32_t block = newBlock(0, capacity);
+			insertFree(block);
+		}
+	}
+
+	// Returns the block of a range of at least size bytes at a multiple of alignment (a power of
+	// two), or TLSF_INVALID if no free block is large enough
+	uint32_t Allocate(uint32_t size, uint32_t alignment = TLSF_GRANULARITY)
+	{
+		if (size == 0 || capacity == 0)
+			return TLSF_INVALID;
+		size = roundUp(size);
+		alignment = glm::max(alignment, TLSF_GRANULARITY);
+		// Any block of size + alignment - granularity bytes has an aligned start that fits
+		uint32_t searchSize = size + (alignment - TLSF_GRANULARITY);
+		if (searchSize < size)
+			return TLSF_INVALID;
+
+		uint32_t block = findFree(searchSize);
+		if (block == TLSF_INVALID)
+			return TLSF_INVALID;
+		removeFree(block);
+
+		uint32_t padding = (alignment - blocks[block].Offset % alignment) % alignment;
+		if (padding > 0) {
+			// The leading padding stays free on its own
+			uint32_t front = block;
+			block = split(front, padding);
+			insertFree(front);
+		}
+		if (blocks[block].Size > size)
+			insertFree(split(block, size));
+
+		blocks[block].Free = false;
+		blocks[block].UserData = TLSF_INVALID;
+		used += blocks[block].Size;
+		return block;
+	}
+
+	void Free(uint32_t block)
+	{
+		if (block == TLSF_INVALID || blocks[block].Free)
+			return;
+		used -= blocks[block].Size;
+		blocks[block].Free = true;
+
+		uint32_t previous = blocks[block].PreviousPhysical;
+		if (previous != TLSF_INVALID && blocks[previous].Free) {
+			removeFree(previous);
+			block = merge(previous, block);
+		}
+		uint32_t next = blocks[block].NextPhysical;
+		if (next != TLSF_INVALID && blocks[next].Free) {
+			removeFree(next);
+			block = merge(block, next);
+		}
+		insertFree(block);
+	}
+
+	uint32_t GetOffset(uint32_t block) const
+	{
+		return blocks[block].Offset;
+	}
+
+	uint32_t GetSize(uint32_t block) const
+	{
+		return blocks[block].Size;
+	}
+
+	// A value of the owner's choice kept with an allocated block, e.g. what owns it
+	void SetUserData(uint32_t block, uint32_t value)
+	{
+		blocks[block].UserData = value;
+	}
+
+	uint32_t GetUserData(uint32_t block) const
+	{
+		return blocks[block].UserData;
+	}
+
+	// Walks the blocks in address order, free ones included
+	uint32_t GetLastBlock() const
+	{
+		return lastBlock;
+	}
+
+	uint32_t GetPreviousBlock(uint32_t block) const
+	{
+		return blocks[block].PreviousPhysical;
+	}
+
+	uint32_t GetNextBlock(uint32_t block) const
+	{
+		return blocks[block].NextPhysical;
+	}
+
+	bool IsFree(uint32_t block) const
+	{
+		return blocks[block].Free;
+	}
+
+	uint32_t GetCapacity() const
+	{
+		return capacity;
+	}
+
+	uint32_t GetUsed() const
+	{
+		return used;
+	}
+
+	unsigned int GetFreeBlockCount() const
+	{
+		return freeBlockCount;
+	}
+
+	// The largest allocation that would succeed. Only the highest non-empty class is scanned.
+	uint32_t GetLargestFreeBlock() const
+	{
+		if (firstLevelMap == 0)
+			return 0;
+		unsigned int firstLevel = highestBit(firstLevelMap);
+		unsigned int secondLevel = highestBit(secondLevelMaps[firstLevel]);
+		uint32_t largest = 0;
+		for (uint32_t block = freeLists[firstLevel][secondLevel]; block != TLSF_INVALID; block = blocks[block].NextFree)
+			largest = glm::max(largest, blocks[block].Size);
+		return largest;
+	}
+
+private:
+	struct Block
+	{
+		uint32_t Offset;
+		uint32_t Size;
+		uint32_t PreviousPhysical;
+		uint32_t NextPhysical;
+		uint32_t PreviousFree;
+		uint32_t NextFree;
+		uint32_t UserData;
+		bool Free;
+	};
+
+	uint32_t capacity;
+	uint32_t used;
+	unsigned int freeBlockCount;
+	uint32_t lastBlock;
+	uint32_t firstLevelMap;
+	uint32_t secondLevelMaps[TLSF_FIRST_LEVEL_COUNT];
+	uint32_t freeLists[TLSF_FIRST_LEVEL_COUNT][TLSF_SECOND_LEVEL_COUNT];
+	std::vector<Block> blocks;
+	std::vector<uint32_t> unusedBlocks;	// Recycled entries of blocks
+
+	// Index of the highest / lowest set bit, v must not be 0
+	static unsigned int highestBit(uint32_t v)
+	{
+		unsigned int bit = 0;
+		while (v >>= 1)
+			bit++;
+		return bit;
+	}
+
+	static unsigned int lowestBit(uint32_t v)
+	{
+		unsigned int bit = 0;
+		while ((v & 1) == 0) {
+			v >>= 1;
+			bit++;
+		}
+		return bit;
+	}
+
+	static uint32_t roundUp(uint32_t size)
+	{
+		return (size + TLSF_GRANULARITY - 1) / TLSF_GRANULARITY * TLSF_GRANULARITY;
+	}
+
+	void clearLists()
+	{
+		firstLevelMap = 0;
+		lastBlock = TLSF_INVALID;
+		for (unsigned int i = 0; i < TLSF_FIRST_LEVEL_COUNT; i++) {
+			secondLevelMaps[i] = 0;
+			for (unsigned int j = 0; j < TLSF_SECOND_LEVEL_COUNT; j++)
+				freeLists[i][j] = TLSF_INVALID;
+		}
+	}
+
+	// The class a block of the given number of granules is filed under. Sizes below
+	// TLSF_SECOND_LEVEL_COUNT granules have a class each in first level 0.
+	static void mapping(uint32_t granules, unsigned int& firstLevel, unsigned int& secondLevel)
+	{
+		if (granules < TLSF_SECOND_LEVEL_COUNT) {
+			firstLevel = 0;
+			secondLevel = granules;
+			return;
+		}
+		unsigned int bit = highestBit(granules);
+		firstLevel = bit - TLSF_SECOND_LEVEL_BITS + 1;
+		secondLevel = (granules >> (bit - TLSF_SECOND_LEVEL_BITS)) - TLSF_SECOND_LEVEL_COUNT;
+	}
+
+	// The smallest free block whose class guarantees size bytes: size is rounded up to the next
+	// class, so whatever block heads that list fits without searching it. The head of size's own
+	// class is tried first, so a hole left by a same sized range (a mesh removed and added back)
+	// is reused rather than passed over.
+	uint32_t findFree(uint32_t size) const
+	{
+		uint32_t granules = size / TLSF_GRANULARITY;
+		unsigned int firstLevel, secondLevel;
+		mapping(granules, firstLevel, secondLevel);
+		if (firstLevel < TLSF_FIRST_LEVEL_COUNT) {
+			uint32_t head = freeLists[firstLevel][secondLevel];
+			if (head != TLSF_INVALID && blocks[head].Size >= size)
+				return head;
+		}
+		if (granules >= TLSF_SECOND_LEVEL_COUNT) {
+			uint32_t rounded = granules + (1u << (highestBit(granules) - TLSF_SECOND_LEVEL_BITS)) - 1;
+			if (rounded < granules)
+				return TLSF_INVALID;
+			granules = rounded;
+		}
+		mapping(granules, firstLevel, secondLevel);
+		if (firstLevel >= TLSF_FIRST_LEVEL_COUNT)
+			return TLSF_INVALID;
+
+		uint32_t secondMap = secondLevelMaps[firstLevel] & (0xFFFFFFFFu << secondLevel);
+		if (secondMap == 0) {
+			uint32_t firstMap = firstLevel + 1 < 32 ? firstLevelMap & (0xFFFFFFFFu << (firstLevel + 1)) : 0;
+			if (firstMap == 0)
+				return TLSF_INVALID;
+			firstLevel = lowestBit(firstMap);
+			secondMap = secondLevelMaps[firstLevel];
+		}
+		return freeLists[firstLevel][lowestBit(secondMap)];
+	}
+
+	void insertFree(uint32_t block)
+	{
+		Block& b = blocks[block];
+		b.Free = true;
+		unsigned int firstLevel, secondLevel;
+		mapping(b.Size / TLSF_GRANULARITY, firstLevel, secondLevel);
+		b.PreviousFree = TLSF_INVALID;
+		b.NextFree = freeLists[firstLevel][secondLevel];
+		if (b.NextFree != TLSF_INVALID)
+			blocks[b.NextFree].PreviousFree = block;
+		freeLists[firstLevel][secondLevel] = block;
+		firstLevelMap |= 1u << firstLevel;
+		secondLevelMaps[firstLevel] |= 1u << secondLevel;
+		freeBlockCount++;
+	}
+
+	void removeFree(uint32_t block)
+	{
+		Block& b = blocks[block];
+		unsigned int firstLevel, secondLevel;
+		mapping(b.Size / TLSF_GRANULARITY, firstLevel, secondLevel);
+		if (b.PreviousFree != TLSF_INVALID)
+			blocks[b.PreviousFree].NextFree = b.NextFree;
+		else
+			freeLists[firstLevel][secondLevel] = b.NextFree;
+		if (b.NextFree != TLSF_INVALID)
+			blocks[b.NextFree].PreviousFree = b.PreviousFree;
+		if (freeLists[firstLevel][secondLevel] == TLSF_INVALID) {
+			secondLevelMaps[firstLevel] &= ~(1u << secondLevel);
+			if (secondLevelMaps[firstLevel] == 0)
+				firstLevelMap &= ~(1u << firstLevel);
+		}
+		freeBlockCount--;
+	}
+
+	uint32_t newBlock(uint32_t offset, uint32_t size)
+	{
+		Block b = { offset, size, TLSF_INVALID, TLSF_INVALID, TLSF_INVALID, TLSF_INVALID, TLSF_INVALID, true };
+		uint32_t block;
+		if (!unusedBlocks.empty()) {
+			block = unusedBlocks.back();
+			unusedBlocks.pop_back();
+			blocks[block] = b;
+		} else {
+			block = (uint32_t) blocks.size();
+			blocks.push_back(b);
+		}
+		if (lastBlock == TLSF_INVALID)
+			lastBlock = block;
+		return block;
+	}
+
+	// Cuts block after size bytes and returns the new block holding the rest
+	uint32_t split(uint32_t block, uint32_t size)
+	{
+		uint32_t rest = newBlock(blocks[block].Offset + size, blocks[block].Size - size);
+		blocks[rest].PreviousPhysical = block;
+		blocks[rest].NextPhysical = blocks[block].NextPhysical;
+		if (blocks[rest].NextPhysical != TLSF_INVALID)
+			blocks[blocks[rest].NextPhysical].PreviousPhysical = rest;
+		else
+			lastBlock = rest;
+		blocks[block].NextPhysical = rest;
+		blocks[block].Size = size;
+		return rest;
+	}
+
+	// Joins second into first, its physical predecessor, and returns first
+	uint32_t merge(uint32_t first, uint32_t second)
+	{
+		blocks[first].Size += blocks[second].Size;
+		blocks[first].NextPhysical = blocks[second].NextPhysical;
+		if (blocks[first].NextPhysical != TLSF_INVALID)
+			blocks[blocks[first].NextPhysical].PreviousPhysical = first;
+		else
+			lastBlock = first;
+		unusedBlocks.push_back(second);
+		return first;
+	}
+};
+
+typedef uint32_t GpuHeapHandle;
+const GpuHeapHandle GPU_HEAP_INVALID = 0xFFFFFFFFu;
+
+struct GpuHeapStats
+{
+	unsigned int Pages;
+	unsigned int Allocations;
+	unsigned long long CapacityBytes;
+	unsigned long long UsedBytes;
+	unsigned long long PendingFreeBytes;	// Freed, waiting for the GPU to pass the frame's fence
+	unsigned long long LargestFreeBlock;
+	unsigned int FreeBlocks;
+	float Fragmentation;	// 1 - largest free block / free bytes: 0 when the free space is one block
+	unsigned long long MovedBytes;	// Copied by Defragment so far
+};
+
+class GpuHeap
+{
+public:
+	GpuHeap() : pageSize(0), maxPages(0), movedBytes(0)
+	{
+	}
+
+	// Pages are pageSize bytes (larger for allocations that don't fit one). The first is created
+	// right away and kept until Release, the others on demand. maxPages, if not 0, caps their
+	// number; with 1 everything is in the one buffer GetPageBuffer(0) names, for users like
+	// MeshPool whose vertex array can only point at one buffer.
+	void Create(uint32_t newPageSize, GLenum newUsage = GL_STATIC_DRAW, unsigned int newMaxPages = 0)
+	{
+		Release();
+		pageSize = newPageSize / TLSF_GRANULARITY * TLSF_GRANULARITY;
+		usage = newUsage;
+		maxPages = newMaxPages;
+		addPage(pageSize);
+	}
+
+	// Reserves size bytes at a multiple of alignment (a power of two). The range is uninitialized.
+	GpuHeapHandle Allocate(uint32_t size, uint32_t alignment = TLSF_GRANULARITY)
+	{
+		if (size == 0)
+			return GPU_HEAP_INVALID;
+		unsigned int page = 0;
+		uint32_t block = TLSF_INVALID;
+		for (; page < pages.size(); page++) {
+			block = pages[page].Ranges.Allocate(size, alignment);
+			if (block != TLSF_INVALID)
+				break;
+		}
+		if (block == TLSF_INVALID) {
+			if (maxPages != 0 && pages.size() >= maxPages)
+				return GPU_HEAP_INVALID;
+			page = addPage(glm::max(pageSize, size + alignment));
+			if (page == TLSF_INVALID)
+				return GPU_HEAP_INVALID;
+			block = pages[page].Ranges.Allocate(size, alignment);
+		}
+
+		GpuHeapHandle handle;
+		if (!unusedHandles.empty()) {
+			handle = unusedHandles.back();
+			unusedHandles.pop_back();
+		} else {
+			handle = (GpuHeapHandle) allocations.size();
+			allocations.push_back(Allocation());
+		}
+		Allocation& allocation = allocations[handle];
+		allocation.Page = page;
+		allocation.Block = block;
+		allocation.Size = size;
+		allocation.Alignment = alignment;
+		allocation.Live = true;
+		pages[page].Ranges.SetUserData(block, handle);
+		return handle;
+	}
+
+	// The handle is invalid right away, the range is reused once the GPU is done with this frame
+	void Free(GpuHeapHandle handle)
+	{
+		if (handle >= allocations.size() || !allocations[handle].Live)
+			return;
+		Allocation& allocation = allocations[handle];
+		queueFree(allocation.Page, allocation.Block);
+		allocation.Live = false;
+		unusedHandles.push_back(handle);
+	}
+
+	// Copies data into the allocation at offset bytes from its start
+	void Upload(GpuHeapHandle handle, const void* data, uint32_t size, uint32_t offset = 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, GetBuffer(handle));
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GetOffset(handle) + offset, size, data);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	// Where the allocation currently is. Defragment may move it, so don't keep these across it.
+	GLuint GetBuffer(GpuHeapHandle handle) const
+	{
+		return pages[allocations[handle].Page].Buffer;
+	}
+
+	GLintptr GetOffset(GpuHeapHandle handle) const
+	{
+		const Allocation& allocation = allocations[handle];
+		return pages[allocation.Page].Ranges.GetOffset(allocation.Block);
+	}
+
+	uint32_t GetSize(GpuHeapHandle handle) const
+	{
+		return allocations[handle].Size;
+	}
+
+	GLuint GetPageBuffer(unsigned int page) const
+	{
+		return pages[page].Buffer;
+	}
+
+	// Fences the frees of this frame and releases those of frames the GPU has finished. Call once
+	// per frame after the frame's draws.
+	void EndFrame()
+	{
+		if (!pendingFrees.empty() && !pendingFrees.back().Fenced) {
+			pendingFrees.back().Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			pendingFrees.back().Fenced = true;
+		}
+		while (!pendingFrees.empty() && pendingFrees.front().Fenced) {
+			GLenum result = glClientWaitSync(pendingFrees.front().Fence, 0, 0);
+			if (result == GL_TIMEOUT_EXPIRED)
+				break;
+			if (result == GL_WAIT_FAILED)
+				std::cout << "ERROR::GPU_HEAP::WAIT_FAILED" << std::endl;
+			releaseBatch(pendingFrees.front());
+			pendingFrees.pop_front();
+		}
+		releaseEmptyPages();
+	}
+
+	// Moves allocations towards the front of the heap, copying at most maxBytes: each one from
+	// the back that fits into a hole before it, in its own page or an earlier one, is copied there
+	// and its old range freed like Free does. Handles stay the same; the ones that moved are
+	// appended to moved, if given, so their users can refresh offsets (see HeapMesh::Rebind).
+	// Returns the bytes copied.
+	uint32_t Defragment(uint32_t maxBytes, std::vector<GpuHeapHandle>* moved = NULL)
+	{
+		uint32_t copied = 0;
+		std::vector<GpuHeapHandle> movedNow;
+		for (unsigned int page = (unsigned int) pages.size(); page-- > 0 && copied < maxBytes;) {
+			uint32_t block = pages[page].Ranges.GetLastBlock();
+			while (block != TLSF_INVALID && copied < maxBytes) {
+				GpuHeapHandle handle = pages[page].Ranges.IsFree(block) ? GPU_HEAP_INVALID : pages[page].Ranges.GetUserData(block);
+				// Ranges waiting for their fence carry no handle. The moved ones can turn up again
+				// further down the page, where they went.
+				if (handle != GPU_HEAP_INVALID && allocations[handle].Size <= maxBytes - copied
+					&& std::find(movedNow.begin(), movedNow.end(), handle) == movedNow.end() && relocate(handle)) {
+					copied += allocations[handle].Size;
+					movedNow.push_back(handle);
+					if (moved != NULL)
+						moved->push_back(handle);
+				}
+				// Read only now, the allocation may have split the block before this one
+				block = pages[page].Ranges.GetPreviousBlock(block);
+			}
+		}
+		movedBytes += copied;
+		return copied;
+	}
+
+	GpuHeapStats GetStats() const
+	{
+		GpuHeapStats stats = {};
+		stats.Pages = (unsigned int) pages.size();
+		stats.Allocations = (unsigned int) (allocations.size() - unusedHandles.size());
+		unsigned long long freeBytes = 0;
+		for (size_t i = 0; i < pages.size(); i++) {
+			const TlsfAllocator& ranges = pages[i].Ranges;
+			stats.CapacityBytes += ranges.GetCapacity();
+			stats.UsedBytes += ranges.GetUsed();
+			freeBytes += ranges.GetCapacity() - ranges.GetUsed();
+			stats.FreeBlocks += ranges.GetFreeBlockCount();
+			stats.LargestFreeBlock = glm::max(stats.LargestFreeBlock, (unsigned long long) ranges.GetLargestFreeBlock());
+		}
+		for (size_t i = 0; i < pendingFrees.size(); i++)
+			stats.PendingFreeBytes += pendingFrees[i].Bytes;
+		// Ranges waiting for their fence still count as used until they are released
+		stats.UsedBytes -= stats.PendingFreeBytes;
+		stats.Fragmentation = freeBytes > 0 ? 1.0f - (float) stats.LargestFreeBlock / freeBytes : 0.0f;
+		stats.MovedBytes = movedBytes;
+		return stats;
+	}
+
+	// Deletes every page; the GPU must be done with them
+	void Release()
+	{
+		for (size_t i = 0; i < pendingFrees.size(); i++)
+			if (pendingFrees[i].Fenced)
+				glDeleteSync(pendingFrees[i].Fence);
+		pendingFrees.clear();
+		for (size_t i = 0; i < pages.size(); i++)
+			glDeleteBuffers(1, &pages[i].Buffer);
+		pages.clear();
+		allocations.clear();
+		unusedHandles.clear();
+		movedBytes = 0;
+	}
+
+private:
+	struct Page
+	{
+		GLuint Buffer;
+		TlsfAllocator Ranges;
+	};
+
+	struct Allocation
+	{
+		unsigned int Page;
+		uint32_t Block;
+		uint32_t Size;
+		uint32_t Alignment;
+		bool Live;
+	};
+
+	struct PendingRange
+	{
+		unsigned int Page;
+		uint32_t Block;
+	};
+
+	// The frees of one frame and the fence behind its draws
+	struct FreeBatch
+	{
+		GLsync Fence;
+		bool Fenced;
+		unsigned long long Bytes;
+		std::vector<PendingRange> Ranges;
+	};
+
+	uint32_t pageSize;
+	GLenum usage;
+	unsigned int maxPages;
+	std::vector<Page> pages;
+	std::vector<Allocation> allocations;
+	std::vector<GpuHeapHandle> unusedHandles;
+	std::deque<FreeBatch> pendingFrees;
+	unsigned long long movedBytes;
+
+	unsigned int addPage(uint32_t size)
+	{
+		Page page;
+		page.Ranges.Reset(size);
+		glGenBuffers(1, &page.Buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, page.Buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, page.Ranges.GetCapacity(), NULL, usage);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (page.Buffer == 0) {
+			std::cout << "ERROR::GPU_HEAP::PAGE_FAILED: " << size << " bytes" << std::endl;
+			return TLSF_INVALID;
+		}
+		pages.push_back(page);
+		return (unsigned int) pages.size() - 1;
+	}
+
+	void queueFree(unsigned int page, uint32_t block)
+	{
+		pages[page].Ranges.SetUserData(block, GPU_HEAP_INVALID);
+		if (pendingFrees.empty() || pendingFrees.back().Fenced) {
+			FreeBatch batch;
+			batch.Fence = 0;
+			batch.Fenced = false;
+			batch.Bytes = 0;
+			pendingFrees.push_back(batch);
+		}
+		PendingRange range = { page, block };
+		pendingFrees.back().Ranges.push_back(range);
+		pendingFrees.back().Bytes += pages[page].Ranges.GetSize(block);
+	}
+
+	void releaseBatch(FreeBatch& batch)
+	{
+		for (size_t i = 0; i < batch.Ranges.size(); i++)
+			pages[batch.Ranges[i].Page].Ranges.Free(batch.Ranges[i].Block);
+		glDeleteSync(batch.Fence);
+	}
+
+	// Pages at the end with nothing in them are deleted (ranges waiting for a fence still count as
+	// used); earlier empty pages are kept so the page indices stay stable
+	void releaseEmptyPages()
+	{
+		while (pages.size() > 1 && pages.back().Ranges.GetUsed() == 0) {
+			glDeleteBuffers(1, &pages.back().Buffer);
+			pages.pop_back();
+		}
+	}
+
+	// Copies the allocation into a free range before its current one, if there is any
+	bool relocate(GpuHeapHandle handle)
+	{
+		Allocation& allocation = allocations[handle];
+		uint32_t oldOffset = pages[allocation.Page].Ranges.GetOffset(allocation.Block);
+		for (unsigned int page = 0; page <= allocation.Page; page++) {
+			TlsfAllocator& ranges = pages[page].Ranges;
+			uint32_t block = ranges.Allocate(allocation.Size, allocation.Alignment);
+			if (block == TLSF_INVALID)
+				continue;
+			if (page == allocation.Page && ranges.GetOffset(block) >= oldOffset) {
+				ranges.Free(block);
+				return false;
+			}
+
+			glBindBuffer(GL_COPY_READ_BUFFER, pages[allocation.Page].Buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, pages[page].Buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, oldOffset, ranges.GetOffset(block), allocation.Size);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+			// Draws of this frame may still read the old copy
+			queueFree(allocation.Page, allocation.Block);
+			allocation.Page = page;
+			allocation.Block = block;
+			ranges.SetUserData(block, handle);
+			return true;
+		}
+		return false;
+	}
+};
+
+// A mesh whose vertices and indices live in a GpuHeap, with its own VAO pointing at them
+class HeapMesh
+{
+public:
+	unsigned int VAO;
+	GpuHeapHandle Vertices;
+	GpuHeapHandle Indices;
+	unsigned int IndexCount;
+	GLenum IndexType;
+
+	HeapMesh() : VAO(0), Vertices(GPU_HEAP_INVALID), Indices(GPU_HEAP_INVALID), IndexCount(0), IndexType(GL_UNSIGNED_INT), stride(0), indexOffset(0)
+	{
+	}
+
+	// Returns false if the heap couldn't hold the mesh
+	bool Upload(const MeshView& view, GpuHeap& heap)
+	{
+		Release(heap);
+		uint32_t vertexBytes = view.VertexCount * view.VertexStride;
+		uint32_t indexBytes = view.IndexCount * IndexTypeSize(view.IndexType);
+		Vertices = heap.Allocate(vertexBytes);
+		Indices = heap.Allocate(indexBytes);
+		if (Vertices == GPU_HEAP_INVALID || Indices == GPU_HEAP_INVALID) {
+			std::cout << "ERROR::HEAP_MESH::OUT_OF_SPACE: " << vertexBytes << " + " << indexBytes << " bytes" << std::endl;
+			Release(heap);
+			return false;
+		}
+		heap.Upload(Vertices, view.Vertices, vertexBytes);
+		heap.Upload(Indices, view.Indices, indexBytes);
+
+		layout.assign(view.Attributes, view.Attributes + view.AttributeCount);
+		stride = view.VertexStride;
+		IndexCount = view.IndexCount;
+		IndexType = view.IndexType;
+		glGenVertexArrays(1, &VAO);
+		Rebind(heap);
+		return true;
+	}
+
+	// Points the VAO at the mesh's current ranges; call after Defragment moved one of them
+	void Rebind(const GpuHeap& heap)
+	{
+		std::vector<MeshAttribute> attributes = layout;
+		for (size_t i = 0; i < attributes.size(); i++)
+			attributes[i].Offset += (GLuint) heap.GetOffset(Vertices);
+
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, heap.GetBuffer(Vertices));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, heap.GetBuffer(Indices));
+		ConfigureVertexAttributes(&attributes[0], (unsigned int) attributes.size(), stride);
+		glBindVertexArray(0);
+		indexOffset = heap.GetOffset(Indices);
+	}
+
+	bool Uses(GpuHeapHandle handle) const
+	{
+		return handle == Vertices || handle == Indices;
+	}
+
+	void Draw() const
+	{
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, IndexCount, IndexType, (const void*) indexOffset);
+	}
+
+	void Release(GpuHeap& heap)
+	{
+		if (VAO != 0)
+			glDeleteVertexArrays(1, &VAO);
+		heap.Free(Vertices);
+		heap.Free(Indices);
+		VAO = 0;
+		Vertices = Indices = GPU_HEAP_INVALID;
+		IndexCount = 0;
+	}
+
+private:
+	std::vector<MeshAttribute> layout;
+	unsigned int stride;
+	GLintptr indexOffset;
+};
+#endif
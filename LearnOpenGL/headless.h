@@ -0,0 +1,614 @@
+#pragma once
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "camera.h"
+#include "render_target.h"
+
+// Renders a fixed number of frames without showing anything, for machines without a display or
+// for measuring throughput. The context comes from a hidden GLFW window (optionally through EGL),
+// the scene renders into an offscreen RenderTarget, and each frame is read back through a ring of
+// pixel buffer objects: glReadPixels into a PBO returns at once, and the pixels are mapped a few
+// frames later when the copy is done. A writer thread encodes and saves the frames, so neither the
+// readback nor the disk holds up rendering.
+//
+// The GLFW shipped here (3.2) can't create surfaceless or OSMesa contexts. On a machine without a
+// GPU, run under a virtual X server (Xvfb) with Mesa's llvmpipe, or ask for EGL with a driver that
+// supports it.
+
+enum Image_Format {
+	IMAGE_FORMAT_PPM,
+	IMAGE_FORMAT_PNG
+};
+
+struct HeadlessSettings
+{
+	int Width;
+	int Height;
+	unsigned int Frames;
+	unsigned int WriteEvery;	// Save every n-th frame, 0 saves none
+	std::string OutputPrefix;	// Files are OutputPrefix + zero padded frame number + extension
+	Image_Format Format;
+	bool Egl;	// Create the context through EGL instead of the native API
+
+	HeadlessSettings() : Width(1280), Height(720), Frames(300), WriteEvery(0), OutputPrefix("frame_"), Format(IMAGE_FORMAT_PNG), Egl(false)
+	{
+	}
+};
+
+struct HeadlessStats
+{
+	unsigned int Frames;
+	double Seconds;	// From the first frame until the last file was written
+	double FramesPerSecond;
+	unsigned int ReadbackStalls;	// Frames that had to wait for an older readback to finish
+	unsigned int WriterWaits;	// Frames that had to wait for the writer to catch up
+	unsigned int FilesWritten;
+	unsigned long long BytesWritten;
+};
+
+// Creates a hidden window for its GL 3.3 core context, makes it current and loads GL. Returns NULL
+// on failure. glfwTerminate cleans up as usual. The size only matters to whoever renders into the
+// window's own framebuffer.
+inline GLFWwindow* CreateHeadlessContext(bool egl = false, int width = 64, int height = 64)
+{
+	if (!glfwInit()) {
+		std::cout << "ERROR::HEADLESS::GLFW_INIT" << std::endl;
+		return NULL;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	if (egl)
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+
+	// Everything renders offscreen, the window only carries the context
+	GLFWwindow* window = glfwCreateWindow(width, height, "LearnOpenGL", NULL, NULL);
+	glfwDefaultWindowHints();
+	if (window == NULL) {
+		std::cout << "ERROR::HEADLESS::CONTEXT: no GL 3.3 core context" << (egl ? " through EGL" : "") << std::endl;
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+		std::cout << "ERROR::HEADLESS::GLAD" << std::endl;
+		glfwDestroyWindow(window);
+		return NULL;
+	}
+	return window;
+}
+
+// Smooth camera flight through keyframes: Catmull-Rom through the positions and the points looked
+// at, passing every keyframe at its time
+class CameraPath
+{
+public:
+	void Add(float time, glm::vec3 position, glm::vec3 target)
+	{
+		Keyframe keyframe = { time, position, target };
+		keyframes.push_back(keyframe);
+	}
+
+	float GetDuration() const
+	{
+		return keyframes.empty() ? 0.0f : keyframes.back().Time;
+	}
+
+	// Places the camera where the path is at time (clamped to the path)
+	void Apply(Camera& camera, float time) const
+	{
+		if (keyframes.empty())
+			return;
+		size_t next = 0;
+		while (next < keyframes.size() && keyframes[next].Time <= time)
+			next++;
+		if (next == 0 || next == keyframes.size()) {
+			const Keyframe& end = keyframes[next == 0 ? 0 : keyframes.size() - 1];
+			camera.Position = end.Position;
+			camera.LookAt(end.Target);
+			return;
+		}
+
+		const Keyframe& k1 = keyframes[next - 1];
+		const Keyframe& k2 = keyframes[next];
+		const Keyframe& k0 = keyframes[next > 1 ? next - 2 : next - 1];
+		const Keyframe& k3 = keyframes[next + 1 < keyframes.size() ? next + 1 : next];
+		float t = (time - k1.Time) / glm::max(k2.Time - k1.Time, 1e-6f);
+		camera.Position = catmullRom(k0.Position, k1.Position, k2.Position, k3.Position, t);
+		camera.LookAt(catmullRom(k0.Target, k1.Target, k2.Target, k3.Target, t));
+	}
+
+private:
+	struct Keyframe
+	{
+		float Time;
+		glm::vec3 Position;
+		glm::vec3 Target;
+	};
+
+	std::vector<Keyframe> keyframes;
+
+	static glm::vec3 catmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t)
+	{
+		float t2 = t * t, t3 = t2 * t;
+		return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+	}
+};
+
+// Binary PPM (P6) of tightly packed RGB rows, top row first. Returns false if the file can't be written.
+inline bool WritePpm(const char* path, const unsigned char* rgb, int width, int height)
+{
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	size_t size = (size_t) width * height * 3;
+	bool written = fwrite(rgb, 1, size, file) == size;
+	return fclose(file) == 0 && written;
+}
+
+// PNG of tightly packed RGB rows, top row first. The image data is stored without compression
+// (zlib stored blocks), which is large but costs next to nothing to encode.
+inline bool WritePng(const char* path, const unsigned char* rgb, int width, int height)
+{
+	// Built once, thread safe as a function static
+	struct CrcTable
+	{
+		uint32_t Values[256];
+
+		CrcTable()
+		{
+			for (uint32_t n = 0; n < 256; n++) {
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				Values[n] = c;
+			}
+		}
+	};
+	static const CrcTable crcTable;
+
+	struct Chunk
+	{
+		static void put32(std::vector<unsigned char>& out, uint32_t v)
+		{
+			out.push_back((unsigned char) (v >> 24));
+			out.push_back((unsigned char) (v >> 16));
+			out.push_back((unsigned char) (v >> 8));
+			out.push_back((unsigned char) v);
+		}
+
+		static void write(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+		{
+			put32(out, (uint32_t) data.size());
+			size_t start = out.size();
+			out.insert(out.end(), type, type + 4);
+			out.insert(out.end(), data.begin(), data.end());
+			uint32_t crc = 0xFFFFFFFFu;
+			for (size_t i = start; i < out.size(); i++)
+				crc = crcTable.Values[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+			put32(out, crc ^ 0xFFFFFFFFu);
+		}
+	};
+
+	std::vector<unsigned char> png;
+	const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	png.insert(png.end(), signature, signature + sizeof(signature));
+
+	std::vector<unsigned char> header;
+	Chunk::put32(header, (uint32_t) width);
+	Chunk::put32(header, (uint32_t) height);
+	const unsigned char format[] = { 8, 2, 0, 0, 0 };	// 8 bit RGB, deflate, no interlace
+	header.insert(header.end(), format, format + sizeof(format));
+	Chunk::write(png, "IHDR", header);
+
+	// Each row is prefixed with filter type 0, then the whole stream goes in 64 KB stored blocks
+	size_t rowSize = (size_t) width * 3;
+	size_t rawSize = (rowSize + 1) * height;
+	std::vector<unsigned char> zlib;
+	zlib.reserve(rawSize + rawSize / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	uint32_t adlerA = 1, adlerB = 0;
+	size_t blockLeft = 0;
+	size_t remaining = rawSize;
+	for (int y = 0; y < height; y++) {
+		for (size_t x = 0; x <= rowSize; x++) {
+			if (blockLeft == 0) {
+				blockLeft = remaining < 65535 ? remaining : 65535;
+				remaining -= blockLeft;
+				zlib.push_back(remaining == 0 ? 1 : 0);
+				zlib.push_back((unsigned char) blockLeft);
+				zlib.push_back((unsigned char) (blockLeft >> 8));
+				zlib.push_back((unsigned char) ~blockLeft);
+				zlib.push_back((unsigned char) (~blockLeft >> 8));
+			}
+			unsigned char value = x == 0 ? 0 : rgb[y * rowSize + x - 1];
+			zlib.push_back(value);
+			adlerA = (adlerA + value) % 65521;
+			adlerB = (adlerB + adlerA) % 65521;
+			blockLeft--;
+		}
+	}
+	Chunk::put32(zlib, (adlerB << 16) | adlerA);
+	Chunk::write(png, "IDAT", zlib);
+	Chunk::write(png, "IEND", std::vector<unsigned char>());
+
+	FILE* file = fopen(path, "wb");
+	if (file == NULL)
+		return false;
+	bool written = fwrite(&png[0], 1, png.size(), file) == png.size();
+	return fclose(file) == 0 && written;
+}
+
+// Saves images on a thread of its own. Submit hands over a bottom-up RGBA frame as read from GL;
+// the writer flips and packs it to RGB and encodes it. At most MaxQueued frames wait at once, after
+// that Submit blocks, so a slow disk slows rendering down instead of using up all memory.
+class FrameWriter
+{
+public:
+	unsigned int MaxQueued;
+
+	FrameWriter() : MaxQueued(8), running(false), waits(0), filesWritten(0), bytesWritten(0)
+	{
+	}
+
+	~FrameWriter()
+	{
+		Finish();
+	}
+
+	void Start()
+	{
+		Finish();
+		running = true;
+		waits = filesWritten = 0;
+		bytesWritten = 0;
+		worker = std::thread([this]() { run(); });
+	}
+
+	void Submit(const std::string& path, Image_Format format, const unsigned char* rgba, int width, int height)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (queue.size() >= MaxQueued) {
+			waits++;
+			changed.wait(lock, [this]() { return queue.size() < MaxQueued; });
+		}
+		Job job;
+		job.Path = path;
+		job.Format = format;
+		job.Width = width;
+		job.Height = height;
+		if (!spare.empty()) {
+			job.Pixels.swap(spare.back());
+			spare.pop_back();
+		}
+		job.Pixels.assign(rgba, rgba + (size_t) width * height * 4);
+		queue.push_back(std::move(job));
+		changed.notify_all();
+	}
+
+	// Writes what is queued and stops the thread
+	void Finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		changed.notify_all();
+		if (worker.joinable())
+			worker.join();
+	}
+
+	unsigned int GetWaits() const
+	{
+		return waits;
+	}
+
+	unsigned int GetFilesWritten() const
+	{
+		return filesWritten;
+	}
+
+	unsigned long long GetBytesWritten() const
+	{
+		return bytesWritten;
+	}
+
+private:
+	struct Job
+	{
+		std::string Path;
+		Image_Format Format;
+		int Width;
+		int Height;
+		std::vector<unsigned char> Pixels;
+	};
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Job> queue;
+	std::vector<std::vector<unsigned char> > spare;	// Pixel buffers to reuse
+	bool running;
+	unsigned int waits;
+	unsigned int filesWritten;
+	unsigned long long bytesWritten;
+
+	void run()
+	{
+		std::vector<unsigned char> rgb;
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [this]() { return !queue.empty() || !running; });
+				if (queue.empty())
+					return;
+				job = std::move(queue.front());
+				queue.pop_front();
+			}
+			changed.notify_all();
+
+			// GL rows go bottom up, image files top down
+			rgb.resize((size_t) job.Width * job.Height * 3);
+			for (int y = 0; y < job.Height; y++) {
+				const unsigned char* source = &job.Pixels[(size_t) (job.Height - 1 - y) * job.Width * 4];
+				unsigned char* target = &rgb[(size_t) y * job.Width * 3];
+				for (int x = 0; x < job.Width; x++) {
+					target[x * 3 + 0] = source[x * 4 + 0];
+					target[x * 3 + 1] = source[x * 4 + 1];
+					target[x * 3 + 2] = source[x * 4 + 2];
+				}
+			}
+			bool written = job.Format == IMAGE_FORMAT_PNG ? WritePng(job.Path.c_str(), &rgb[0], job.Width, job.Height) : WritePpm(job.Path.c_str(), &rgb[0], job.Width, job.Height);
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (written) {
+				filesWritten++;
+				bytesWritten += rgb.size();
+			} else {
+				std::cout << "ERROR::FRAME_WRITER::WRITE_FAILED: " << job.Path << std::endl;
+			}
+			spare.push_back(std::move(job.Pixels));
+		}
+	}
+};
+
+// Reads frames back through a ring of pixel buffer objects. Read starts the copy of a framebuffer
+// and returns; the pixels are mapped once the copy has finished, normally by the time the ring
+// comes around to the same buffer again.
+class AsyncReadback
+{
+public:
+	AsyncReadback() : width(0), height(0), first(0), count(0), stalls(0)
+	{
+		for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+			slots[i].Buffer = 0;
+			slots[i].Fence = 0;
+		}
+	}
+
+	void Create(int newWidth, int newHeight)
+	{
+		Release();
+		width = newWidth;
+		height = newHeight;
+		for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+			glGenBuffers(1, &slots[i].Buffer);
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].Buffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	// Starts reading the color buffer of framebuffer as RGBA8. When all buffers are busy the oldest
+	// readback is completed first. complete(frame, rgba, width, height) receives each frame.
+	template <typename Complete>
+	void Read(GLuint framebuffer, unsigned long long frame, Complete& complete)
+	{
+		Collect(complete);
+		if (count == BUFFER_COUNT) {
+			stalls++;
+			completeOldest(complete, true);
+		}
+
+		Slot& slot = slots[(first + count) % BUFFER_COUNT];
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.Frame = frame;
+		count++;
+	}
+
+	// Completes the readbacks that have finished, oldest first
+	template <typename Complete>
+	void Collect(Complete& complete)
+	{
+		while (count > 0 && completeOldest(complete, false))
+			;
+	}
+
+	// Completes every readback still in flight
+	template <typename Complete>
+	void Flush(Complete& complete)
+	{
+		while (count > 0)
+			completeOldest(complete, true);
+	}
+
+	unsigned int GetStalls() const
+	{
+		return stalls;
+	}
+
+	void Release()
+	{
+		for (unsigned int i = 0; i < BUFFER_COUNT; i++) {
+			if (slots[i].Fence != 0)
+				glDeleteSync(slots[i].Fence);
+			if (slots[i].Buffer != 0)
+				glDeleteBuffers(1, &slots[i].Buffer);
+			slots[i].Buffer = 0;
+			slots[i].Fence = 0;
+		}
+		first = count = 0;
+	}
+
+private:
+	static const unsigned int BUFFER_COUNT = 3;
+
+	struct Slot
+	{
+		GLuint Buffer;
+		GLsync Fence;
+		unsigned long long Frame;
+	};
+
+	Slot slots[BUFFER_COUNT];
+	int width;
+	int height;
+	unsigned int first;
+	unsigned int count;
+	unsigned int stalls;
+
+	template <typename Complete>
+	bool completeOldest(Complete& complete, bool wait)
+	{
+		Slot& slot = slots[first];
+		GLenum result = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+		while (wait && result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(slot.Fence, 0, 1000000000ull);
+		if (result == GL_TIMEOUT_EXPIRED)
+			return false;
+		glDeleteSync(slot.Fence);
+		slot.Fence = 0;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+		const unsigned char* pixels = (const unsigned char*) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) width * height * 4, GL_MAP_READ_BIT);
+		if (pixels != NULL) {
+			complete(slot.Frame, pixels, width, height);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		} else {
+			std::cout << "ERROR::ASYNC_READBACK::MAP_FAILED: frame " << slot.Frame << std::endl;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		first = (first + 1) % BUFFER_COUNT;
+		count--;
+		return true;
+	}
+};
+
+// Offscreen target, readback and writer for a headless run:
+//
+//   renderer.Create(settings);            with a context current, e.g. from CreateHeadlessContext
+//   for (frame < settings.Frames) {
+//       renderer.BeginFrame();            binds the target
+//       ... draw ...
+//       renderer.EndFrame();              starts the readback
+//   }
+//   HeadlessStats stats = renderer.Finish();
+class HeadlessRenderer
+{
+public:
+	HeadlessSettings Settings;
+	RenderTarget Target;
+
+	HeadlessRenderer() : frame(0), started(false)
+	{
+	}
+
+	bool Create(const HeadlessSettings& settings)
+	{
+		Release();
+		Settings = settings;
+		if (!Target.Create(settings.Width, settings.Height))
+			return false;
+		readback.Create(settings.Width, settings.Height);
+		writer.Start();
+		frame = 0;
+		started = false;
+		return true;
+	}
+
+	void BeginFrame()
+	{
+		if (!started) {
+			start = std::chrono::high_resolution_clock::now();
+			started = true;
+		}
+		Target.Bind();
+	}
+
+	void EndFrame()
+	{
+		auto complete = [this](unsigned long long index, const unsigned char* rgba, int width, int height) { save(index, rgba, width, height); };
+		readback.Read(Target.FBO, frame, complete);
+		frame++;
+	}
+
+	// Waits for the last readbacks and files and returns the throughput
+	HeadlessStats Finish()
+	{
+		auto complete = [this](unsigned long long index, const unsigned char* rgba, int width, int height) { save(index, rgba, width, height); };
+		readback.Flush(complete);
+		writer.Finish();
+
+		HeadlessStats stats;
+		stats.Frames = (unsigned int) frame;
+		stats.Seconds = started ? std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() : 0.0;
+		stats.FramesPerSecond = stats.Seconds > 0.0 ? frame / stats.Seconds : 0.0;
+		stats.ReadbackStalls = readback.GetStalls();
+		stats.WriterWaits = writer.GetWaits();
+		stats.FilesWritten = writer.GetFilesWritten();
+		stats.BytesWritten = writer.GetBytesWritten();
+		started = false;
+		return stats;
+	}
+
+	void Release()
+	{
+		writer.Finish();
+		readback.Release();
+		Target.Release();
+	}
+
+private:
+	AsyncReadback readback;
+	FrameWriter writer;
+	unsigned long long frame;
+	bool started;
+	std::chrono::high_resolution_clock::time_point start;
+
+	void save(unsigned long long index, const unsigned char* rgba, int width, int height)
+	{
+		if (Settings.WriteEvery == 0 || index % Settings.WriteEvery != 0)
+			return;
+		char number[32];
+		snprintf(number, sizeof(number), "%05llu", index);
+		std::string path = Settings.OutputPrefix + number + (Settings.Format == IMAGE_FORMAT_PNG ? ".png" : ".ppm");
+		writer.Submit(path, Settings.Format, rgba, width, height);
+	}
+};
+#endif
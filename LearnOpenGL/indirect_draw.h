@@ -0,0 +1,325 @@
+#pragma once
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "affine.h"
+#include "frame_ring_buffer.h"
+#include "gpu_heap.h"
+#include "mesh.h"
+
+// Draws many different meshes with one call. All static meshes of a vertex layout live in one
+// vertex / index buffer pair (MeshPool), so switching meshes is only a different first index and
+// base vertex. Each frame the visible objects are turned into an array of
+// DrawElementsIndirectCommand (IndirectBatch) and submitted with a single
+// glMultiDrawElementsIndirect, whatever the number of meshes.
+//
+// Per draw data (the model matrix) is an instanced attribute and each command's BaseInstance is
+// where its matrices start, so attribute fetch finds the draw's data the way gl_DrawID would,
+// with plain GLSL 3.30 shaders like instanced_shader.vs.
+
+// Where a mesh lives in the pool's buffers
+struct PooledMesh
+{
+	unsigned int FirstIndex;
+	unsigned int IndexCount;
+	unsigned int FirstVertex;	// Used as the draws' base vertex, the indices stay mesh relative
+	unsigned int VertexCount;
+	glm::vec3 BoundsMin;
+	glm::vec3 BoundsMax;
+	GpuHeapHandle VertexRange;
+	GpuHeapHandle IndexRange;
+};
+
+// One vertex buffer and one 32 bit index buffer shared by all meshes of a vertex layout, plus the
+// VAO reading them. Each buffer is a single page GpuHeap, so removed meshes' ranges are only
+// reused once the GPU has finished the frames that drew them (EndFrame). The VAO also has the
+// instanced mat3x4 model attribute at ATTRIBUTE_INSTANCE_MODEL, which IndirectBatch points at
+// each frame's matrices.
+class MeshPool
+{
+public:
+	unsigned int VAO;
+	unsigned int VBO;
+	unsigned int EBO;
+
+	MeshPool() : VAO(0), VBO(0), EBO(0), vertexStride(0)
+	{
+	}
+
+	// Allocates room for vertexCapacity vertices of the given layout and indexCapacity indices,
+	// spread over up to meshCapacity meshes
+	void Create(const MeshAttribute* attributes, unsigned int attributeCount, unsigned int stride, unsigned int vertexCapacity, unsigned int indexCapacity, unsigned int meshCapacity)
+	{
+		Release();
+		layout.assign(attributes, attributes + attributeCount);
+		vertexStride = stride;
+
+		// Besides rounding to the heap's granularity, each mesh may skip up to a vertex to start
+		// at a multiple of the stride. TLSF only takes blocks from a size class that surely fits,
+		// which can pass over up to a sixteenth more than it needs.
+		uint32_t vertexBytes = vertexCapacity * stride + meshCapacity * (stride + TLSF_GRANULARITY);
+		uint32_t indexBytes = indexCapacity * (uint32_t) sizeof(unsigned int) + meshCapacity * TLSF_GRANULARITY;
+		vertexHeap.Create(vertexBytes + vertexBytes / TLSF_SECOND_LEVEL_COUNT, GL_STATIC_DRAW, 1);
+		indexHeap.Create(indexBytes + indexBytes / TLSF_SECOND_LEVEL_COUNT, GL_STATIC_DRAW, 1);
+		VBO = vertexHeap.GetPageBuffer(0);
+		EBO = indexHeap.GetPageBuffer(0);
+
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		ConfigureVertexAttributes(attributes, attributeCount, stride);
+
+		for (GLuint row = 0; row < 3; row++) {
+			glEnableVertexAttribArray(ATTRIBUTE_INSTANCE_MODEL + row);
+			glVertexAttribDivisor(ATTRIBUTE_INSTANCE_MODEL + row, 1);
+		}
+		glBindVertexArray(0);
+	}
+
+	// Copies a mesh into the pool. It must have the pool's vertex layout. Returns its id, or -1
+	// if it doesn't match or doesn't fit.
+	int Add(const MeshView& view)
+	{
+		if (!matchesLayout(view)) {
+			std::cout << "ERROR::MESH_POOL::LAYOUT_MISMATCH: the mesh's vertex layout differs from the pool's" << std::endl;
+			return -1;
+		}
+		PooledMesh mesh;
+		// The base vertex counts whole vertices from the start of the buffer
+		mesh.VertexRange = vertexHeap.Allocate(view.VertexCount * vertexStride + vertexStride - 1);
+		mesh.IndexRange = indexHeap.Allocate(view.IndexCount * (uint32_t) sizeof(unsigned int), sizeof(unsigned int));
+		if (mesh.VertexRange == GPU_HEAP_INVALID || mesh.IndexRange == GPU_HEAP_INVALID) {
+			std::cout << "ERROR::MESH_POOL::OUT_OF_SPACE: " << view.VertexCount << " vertices, " << view.IndexCount << " indices" << std::endl;
+			vertexHeap.Free(mesh.VertexRange);
+			indexHeap.Free(mesh.IndexRange);
+			return -1;
+		}
+		mesh.FirstVertex = (unsigned int) ((vertexHeap.GetOffset(mesh.VertexRange) + vertexStride - 1) / vertexStride);
+		mesh.FirstIndex = (unsigned int) (indexHeap.GetOffset(mesh.IndexRange) / sizeof(unsigned int));
+		mesh.VertexCount = view.VertexCount;
+		mesh.IndexCount = view.IndexCount;
+		computeBounds(view, mesh);
+
+		// The draws use 32 bit indices throughout, narrower ones are widened
+		std::vector<unsigned int> widened;
+		const void* indices = view.Indices;
+		if (view.IndexType != GL_UNSIGNED_INT) {
+			widened.resize(view.IndexCount);
+			for (unsigned int i = 0; i < view.IndexCount; i++)
+				widened[i] = view.IndexType == GL_UNSIGNED_SHORT ? ((const unsigned short*) view.Indices)[i] : ((const unsigned char*) view.Indices)[i];
+			indices = &widened[0];
+		}
+
+		uint32_t vertexSkip = mesh.FirstVertex * vertexStride - (uint32_t) vertexHeap.GetOffset(mesh.VertexRange);
+		vertexHeap.Upload(mesh.VertexRange, view.Vertices, view.VertexCount * vertexStride, vertexSkip);
+		indexHeap.Upload(mesh.IndexRange, indices, view.IndexCount * (uint32_t) sizeof(unsigned int));
+
+		int id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+			meshes[id] = mesh;
+		} else {
+			id = (int) meshes.size();
+			meshes.push_back(mesh);
+		}
+		return id;
+	}
+
+	// Gives the mesh's ranges back; they are reused once the GPU is past this frame
+	void Remove(int id)
+	{
+		PooledMesh& mesh = meshes[id];
+		vertexHeap.Free(mesh.VertexRange);
+		indexHeap.Free(mesh.IndexRange);
+		mesh.VertexRange = mesh.IndexRange = GPU_HEAP_INVALID;
+		mesh.VertexCount = mesh.IndexCount = 0;
+		freeIds.push_back(id);
+	}
+
+	const PooledMesh& Get(int id) const
+	{
+		return meshes[id];
+	}
+
+	unsigned int GetVertexStride() const
+	{
+		return vertexStride;
+	}
+
+	// Releases the ranges of removed meshes the GPU is done with. Call once per frame after its
+	// draws.
+	void EndFrame()
+	{
+		vertexHeap.EndFrame();
+		indexHeap.EndFrame();
+	}
+
+	void Release()
+	{
+		if (VAO != 0)
+			glDeleteVertexArrays(1, &VAO);
+		vertexHeap.Release();
+		indexHeap.Release();
+		VAO = VBO = EBO = 0;
+		meshes.clear();
+		freeIds.clear();
+	}
+
+private:
+	std::vector<MeshAttribute> layout;
+	unsigned int vertexStride;
+	GpuHeap vertexHeap;
+	GpuHeap indexHeap;
+	std::vector<PooledMesh> meshes;
+	std::vector<int> freeIds;
+
+	bool matchesLayout(const MeshView& view) const
+	{
+		if (view.VertexStride != vertexStride || view.AttributeCount != layout.size())
+			return false;
+		for (unsigned int i = 0; i < view.AttributeCount; i++) {
+			const MeshAttribute& a = view.Attributes[i];
+			const MeshAttribute& b = layout[i];
+			if (a.Location != b.Location || a.Size != b.Size || a.Type != b.Type || a.Normalized != b.Normalized || a.Offset != b.Offset)
+				return false;
+		}
+		return true;
+	}
+
+	// Bounds from a float position attribute, for culling the objects using the mesh
+	void computeBounds(const MeshView& view, PooledMesh& mesh) const
+	{
+		mesh.BoundsMin = mesh.BoundsMax = glm::vec3(0.0f);
+		const MeshAttribute* position = NULL;
+		for (unsigned int i = 0; i < view.AttributeCount; i++)
+			if (view.Attributes[i].Location == ATTRIBUTE_POSITION && view.Attributes[i].Type == GL_FLOAT)
+				position = &view.Attributes[i];
+		if (position == NULL || view.VertexCount == 0)
+			return;
+
+		mesh.BoundsMin = glm::vec3(FLT_MAX);
+		mesh.BoundsMax = glm::vec3(-FLT_MAX);
+		for (unsigned int v = 0; v < view.VertexCount; v++) {
+			glm::vec3 p;
+			memcpy(&p[0], (const unsigned char*) view.Vertices + v * view.VertexStride + position->Offset, sizeof(glm::vec3));
+			mesh.BoundsMin = glm::min(mesh.BoundsMin, p);
+			mesh.BoundsMax = glm::max(mesh.BoundsMax, p);
+		}
+	}
+};
+
+// One frame's draws of pooled meshes. Consecutive objects with the same mesh share a command as
+// instances, so adding objects sorted by mesh gives fewer, larger commands.
+class IndirectBatch
+{
+public:
+	IndirectBatch() : lastMesh(-1), commandOffset(0), modelOffset(0), uploaded(false)
+	{
+	}
+
+	void Begin()
+	{
+		commands.clear();
+		models.clear();
+		lastMesh = -1;
+		uploaded = false;
+	}
+
+	void Add(const MeshPool& pool, int mesh, const Affine& model)
+	{
+		if (mesh == lastMesh) {
+			commands.back().InstanceCount++;
+		} else {
+			const PooledMesh& pooled = pool.Get(mesh);
+			DrawElementsIndirectCommand command = { pooled.IndexCount, 1, pooled.FirstIndex, (GLint) pooled.FirstVertex, (GLuint) models.size() };
+			commands.push_back(command);
+			lastMesh = mesh;
+		}
+		models.push_back(model);
+	}
+
+	unsigned int GetCommandCount() const
+	{
+		return (unsigned int) commands.size();
+	}
+
+	unsigned int GetObjectCount() const
+	{
+		return (unsigned int) models.size();
+	}
+
+	// Copies the commands and model matrices into this frame's slice of the ring. Call between
+	// the ring's BeginFrame and FinishWrites. Returns false if they don't fit.
+	bool Upload(FrameRingBuffer& ring)
+	{
+		uploaded = false;
+		if (commands.empty())
+			return true;
+		void* commandData = ring.Allocate(commands.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint), commandOffset);
+		void* modelData = ring.Allocate(models.size() * sizeof(Affine), sizeof(glm::vec4), modelOffset);
+		if (commandData == NULL || modelData == NULL)
+			return false;
+		memcpy(commandData, &commands[0], commands.size() * sizeof(DrawElementsIndirectCommand));
+		memcpy(modelData, &models[0], models.size() * sizeof(Affine));
+		uploaded = true;
+		return true;
+	}
+
+	// Whether Draw issues a single call. The commands' BaseInstance offsets the instanced model
+	// attribute, which takes ARB_base_instance (GL 4.2) on top of ARB_multi_draw_indirect (GL 4.3).
+	static bool IsMultiDrawSupported()
+	{
+		return GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance;
+	}
+
+	// Draws everything uploaded, after the ring's FinishWrites. With multi-draw indirect support
+	// that is one call reading the commands from the ring; otherwise one instanced draw per
+	// command, each pointing the model attribute at its own matrices.
+	void Draw(const MeshPool& pool, const FrameRingBuffer& ring) const
+	{
+		if (!uploaded)
+			return;
+		glBindVertexArray(pool.VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, ring.Buffer);
+
+		if (IsMultiDrawSupported()) {
+			setModelPointer(modelOffset);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ring.Buffer);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*) commandOffset, (GLsizei) commands.size(), 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+		} else {
+			for (size_t i = 0; i < commands.size(); i++) {
+				const DrawElementsIndirectCommand& command = commands[i];
+				setModelPointer(modelOffset + (GLintptr) command.BaseInstance * sizeof(Affine));
+				glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.Count, GL_UNSIGNED_INT, (const void*)((size_t) command.FirstIndex * sizeof(unsigned int)), command.InstanceCount, command.BaseVertex);
+			}
+		}
+		glBindVertexArray(0);
+	}
+
+private:
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<Affine> models;
+	int lastMesh;
+	GLintptr commandOffset;
+	GLintptr modelOffset;
+	bool uploaded;
+
+	// Expects the ring buffer bound to GL_ARRAY_BUFFER
+	static void setModelPointer(GLintptr offset)
+	{
+		for (GLuint row = 0; row < 3; row++)
+			glVertexAttribPointer(ATTRIBUTE_INSTANCE_MODEL + row, 4, GL_FLOAT, GL_FALSE, sizeof(Affine), (void*)(offset + row * sizeof(glm::vec4)));
+	}
+};
+#endif
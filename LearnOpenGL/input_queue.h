@@ -0,0 +1,252 @@
+#pragma once
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cfloat>
+#include <cstring>
+
+// Event driven input. The GLFW callbacks only timestamp their events and push them into a lock
+// free single producer / single consumer ring; whoever consumes the input (the render thread or
+// a simulation thread) drains the ring at its own rate, keeps the key state and adds up the
+// mouse movement, so there is no glfwGetKey polling per key per frame and nothing but the ring
+// is shared with the callbacks.
+
+const unsigned int INPUT_QUEUE_CAPACITY = 1024;	// Must be a power of two
+
+enum Input_Event_Type {
+	INPUT_EVENT_KEY,
+	INPUT_EVENT_MOUSE_BUTTON,
+	INPUT_EVENT_CURSOR,
+	INPUT_EVENT_SCROLL
+};
+
+struct InputEvent
+{
+	Input_Event_Type Type;
+	int Code;	// GLFW key or mouse button
+	int Action;	// GLFW_PRESS, GLFW_RELEASE or GLFW_REPEAT
+	glm::vec2 Offset;	// Cursor movement in screen pixels (y down) or scroll offset
+	double Time;	// glfwGetTime() when the callback ran
+};
+
+// Fixed size ring for exactly one producer and one consumer thread. Each side only writes its own
+// index, so a release store / acquire load pair is all the synchronization needed.
+template <typename T, unsigned int Capacity>
+class SpscRing
+{
+public:
+	SpscRing() : head(0), tail(0)
+	{
+	}
+
+	// Producer: returns false (and drops the value) when the ring is full
+	bool Push(const T& value)
+	{
+		unsigned int position = tail.load(std::memory_order_relaxed);
+		if (position - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[position & (Capacity - 1)] = value;
+		tail.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Producer: slots left to push into. Can only grow until the next Push.
+	unsigned int GetFree() const
+	{
+		return Capacity - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+	}
+
+	// Consumer: the oldest value, or NULL when empty. Stays valid until Pop.
+	const T* Peek() const
+	{
+		unsigned int position = head.load(std::memory_order_relaxed);
+		if (position == tail.load(std::memory_order_acquire))
+			return NULL;
+		return &items[position & (Capacity - 1)];
+	}
+
+	void Pop()
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+private:
+	T items[Capacity];
+	alignas(64) std::atomic<unsigned int> head;
+	alignas(64) std::atomic<unsigned int> tail;
+};
+
+class InputQueue
+{
+public:
+	InputQueue() : dropped(0), cursorKnown(false), heldCount(0), mouseDelta(0.0f), scrollDelta(0.0f)
+	{
+		memset(heldKeys, 0, sizeof(heldKeys));
+		memset(heldButtons, 0, sizeof(heldButtons));
+		memset(keys, 0, sizeof(keys));
+		memset(buttons, 0, sizeof(buttons));
+	}
+
+	// Installs the key, mouse button, cursor and scroll callbacks of the window. Uses the window
+	// user pointer, so a window has at most one queue.
+	void Attach(GLFWwindow* window)
+	{
+		glfwSetWindowUserPointer(window, this);
+		glfwSetKeyCallback(window, keyCallback);
+		glfwSetMouseButtonCallback(window, mouseButtonCallback);
+		glfwSetCursorPosCallback(window, cursorCallback);
+		glfwSetScrollCallback(window, scrollCallback);
+	}
+
+	// Consumer side. Applies the events that happened up to `until` (glfwGetTime() seconds), so a
+	// simulation tick only sees input from before it ended. Mouse and scroll movement add up until
+	// taken, however many cursor events there were.
+	void Drain(double until = DBL_MAX)
+	{
+		for (const InputEvent* event = events.Peek(); event != NULL && event->Time <= until; event = events.Peek()) {
+			switch (event->Type) {
+			case INPUT_EVENT_KEY:
+				if (event->Code >= 0 && event->Code <= GLFW_KEY_LAST)
+					keys[event->Code] = event->Action != GLFW_RELEASE;
+				break;
+			case INPUT_EVENT_MOUSE_BUTTON:
+				if (event->Code >= 0 && event->Code <= GLFW_MOUSE_BUTTON_LAST)
+					buttons[event->Code] = event->Action != GLFW_RELEASE;
+				break;
+			case INPUT_EVENT_CURSOR:
+				mouseDelta += event->Offset;
+				break;
+			case INPUT_EVENT_SCROLL:
+				scrollDelta += event->Offset;
+				break;
+			}
+			events.Pop();
+		}
+	}
+
+	bool IsKeyDown(int key) const
+	{
+		return key >= 0 && key <= GLFW_KEY_LAST && keys[key];
+	}
+
+	bool IsMouseButtonDown(int button) const
+	{
+		return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST && buttons[button];
+	}
+
+	// Cursor movement since the last call, in screen pixels with y going down
+	glm::vec2 TakeMouseDelta()
+	{
+		glm::vec2 delta = mouseDelta;
+		mouseDelta = glm::vec2(0.0f);
+		return delta;
+	}
+
+	glm::vec2 TakeScrollDelta()
+	{
+		glm::vec2 delta = scrollDelta;
+		scrollDelta = glm::vec2(0.0f);
+		return delta;
+	}
+
+	// Events lost because the consumer fell a whole ring behind. Releases of keys and buttons the
+	// consumer sees held are never lost, the ring keeps a slot for each of them.
+	unsigned int GetDroppedEvents() const
+	{
+		return dropped.load();
+	}
+
+private:
+	SpscRing<InputEvent, INPUT_QUEUE_CAPACITY> events;
+	std::atomic<unsigned int> dropped;
+
+	// Producer side: the previous cursor position, to turn positions into movement, and the keys
+	// and buttons whose press went into the ring and whose release hasn't yet
+	bool cursorKnown;
+	double cursorX, cursorY;
+	bool heldKeys[GLFW_KEY_LAST + 1];
+	bool heldButtons[GLFW_MOUSE_BUTTON_LAST + 1];
+	unsigned int heldCount;
+
+	// Consumer side
+	bool keys[GLFW_KEY_LAST + 1];
+	bool buttons[GLFW_MOUSE_BUTTON_LAST + 1];
+	glm::vec2 mouseDelta;
+	glm::vec2 scrollDelta;
+
+	void push(Input_Event_Type type, int code, int action, glm::vec2 offset)
+	{
+		InputEvent event;
+		event.Type = type;
+		event.Code = code;
+		event.Action = action;
+		event.Offset = offset;
+		event.Time = glfwGetTime();
+
+		// The ring always has room for the releases of everything held: other events need a slot
+		// on top of those, presses one more for their own release
+		bool* held = NULL;
+		if (type == INPUT_EVENT_KEY && code >= 0 && code <= GLFW_KEY_LAST)
+			held = &heldKeys[code];
+		else if (type == INPUT_EVENT_MOUSE_BUTTON && code >= 0 && code <= GLFW_MOUSE_BUTTON_LAST)
+			held = &heldButtons[code];
+		unsigned int needed = 1;
+		if (held != NULL && action == GLFW_RELEASE) {
+			if (!*held)
+				return;	// The press was dropped, the consumer doesn't see it held
+			needed = 0;
+		}
+		else if (held != NULL && !*held)
+			needed = 2;	// A repeat counts as a press here, the consumer sees it held as well
+		if (events.GetFree() < heldCount + needed) {
+			dropped++;
+			return;
+		}
+		events.Push(event);
+
+		if (held != NULL && action == GLFW_RELEASE) {
+			*held = false;
+			heldCount--;
+		}
+		else if (held != NULL && !*held) {
+			*held = true;
+			heldCount++;
+		}
+	}
+
+	static InputQueue* getQueue(GLFWwindow* window)
+	{
+		return (InputQueue*) glfwGetWindowUserPointer(window);
+	}
+
+	static void keyCallback(GLFWwindow* window, int key, int, int action, int)
+	{
+		getQueue(window)->push(INPUT_EVENT_KEY, key, action, glm::vec2(0.0f));
+	}
+
+	static void mouseButtonCallback(GLFWwindow* window, int button, int action, int)
+	{
+		getQueue(window)->push(INPUT_EVENT_MOUSE_BUTTON, button, action, glm::vec2(0.0f));
+	}
+
+	// The first position only sets where movement is measured from
+	static void cursorCallback(GLFWwindow* window, double xpos, double ypos)
+	{
+		InputQueue* queue = getQueue(window);
+		if (queue->cursorKnown)
+			queue->push(INPUT_EVENT_CURSOR, 0, 0, glm::vec2((float) (xpos - queue->cursorX), (float) (ypos - queue->cursorY)));
+		queue->cursorX = xpos;
+		queue->cursorY = ypos;
+		queue->cursorKnown = true;
+	}
+
+	static void scrollCallback(GLFWwindow* window, double xoffset, double yoffset)
+	{
+		getQueue(window)->push(INPUT_EVENT_SCROLL, 0, 0, glm::vec2((float) xoffset, (float) yoffset));
+	}
+};
+#endif
@@ -0,0 +1,426 @@
+#pragma once
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+// Task scheduler for the engine side of the demos. Every worker thread owns a Chase-Lev
+// work-stealing deque: it pushes and pops its own jobs at the bottom without locking, idle
+// threads steal from the top of the others. The thread that created the JobSystem takes part
+// too while it waits, and is the only one running jobs created with CreateMainThread, which is
+// where anything touching GL goes.
+//
+// Jobs form trees: a job created with a parent keeps the parent unfinished until it is done
+// itself, so waiting on one root job waits for all the work hanging off it.
+
+const unsigned int JOB_DATA_SIZE = 64;	// Bytes a job function (lambda captures) may take
+const unsigned int JOB_POOL_SIZE = 4096;	// Jobs per thread that may be alive at once, power of two
+const unsigned int JOB_DEQUE_SIZE = 4096;	// Jobs queued per thread, power of two
+static_assert(JOB_POOL_SIZE >= JOB_DEQUE_SIZE, "A full deque must not need more jobs than the pool has");
+
+struct Job
+{
+	void (*Function)(Job*);
+	void (*Destroy)(Job*);
+	Job* Parent;
+	std::atomic<int> Unfinished;	// 1 for the job itself plus one per unfinished child
+	bool MainThread;
+	alignas(alignof(std::max_align_t)) unsigned char Data[JOB_DATA_SIZE];
+};
+
+// Chase-Lev deque (the C11 formulation of Le et al.). Only the owning thread calls Push and Pop,
+// any thread may Steal.
+class JobDeque
+{
+public:
+	JobDeque() : top(0), bottom(0)
+	{
+		for (unsigned int i = 0; i < JOB_DEQUE_SIZE; i++)
+			jobs[i].store(NULL, std::memory_order_relaxed);
+	}
+
+	// Returns false when the deque is full
+	bool Push(Job* job)
+	{
+		long long b = bottom.load(std::memory_order_relaxed);
+		long long t = top.load(std::memory_order_acquire);
+		if (b - t >= (long long) JOB_DEQUE_SIZE)
+			return false;
+		jobs[b & (JOB_DEQUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	Job* Pop()
+	{
+		long long b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long t = top.load(std::memory_order_relaxed);
+
+		Job* job = NULL;
+		if (t <= b) {
+			job = jobs[b & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+			if (t == b) {
+				// Last job, race the thieves for it
+				if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+					job = NULL;
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+		} else {
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* Steal()
+	{
+		long long t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return NULL;
+
+		Job* job = jobs[t & (JOB_DEQUE_SIZE - 1)].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return NULL;
+		return job;
+	}
+
+	bool IsEmpty() const
+	{
+		return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+	}
+
+private:
+	// The owner and the thieves each mostly write one of the indices, keep them on separate cache lines
+	std::atomic<long long> top;
+	char padding[64];
+	std::atomic<long long> bottom;
+	std::atomic<Job*> jobs[JOB_DEQUE_SIZE];
+};
+
+class JobSystem
+{
+public:
+	// threadCount threads take part, the calling thread included (0 = one per hardware thread)
+	JobSystem(unsigned int threadCount = 0) : ownerThread(std::this_thread::get_id()), mainJobCount(0), sharedJobCount(0), sleeping(0), running(true)
+	{
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		threadCount = std::max(threadCount, 1u);
+
+		for (unsigned int i = 0; i < threadCount; i++)
+			deques.push_back(std::unique_ptr<JobDeque>(new JobDeque()));
+		for (unsigned int i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+	}
+
+	~JobSystem()
+	{
+		running = false;
+		wake.notify_all();
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+
+	unsigned int GetThreadCount() const
+	{
+		return (unsigned int) deques.size();
+	}
+
+	// Creates a job running function() (a lambda of at most JOB_DATA_SIZE bytes). It runs once
+	// passed to Run; with a parent, the parent isn't finished before it is.
+	template <typename Function>
+	Job* Create(const Function& function, Job* parent = NULL)
+	{
+		static_assert(sizeof(Function) <= JOB_DATA_SIZE, "Job function captures too much, capture a pointer instead");
+		Job* job = allocate();
+		new (job->Data) Function(function);
+		job->Function = [](Job* self) { (*(Function*) self->Data)(); };
+		job->Destroy = [](Job* self) { ((Function*) self->Data)->~Function(); };
+		job->Parent = parent;
+		job->MainThread = false;
+		job->Unfinished.store(1, std::memory_order_relaxed);
+		if (parent != NULL)
+			parent->Unfinished.fetch_add(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	// Same as Create for jobs that only the thread which created the JobSystem may run
+	template <typename Function>
+	Job* CreateMainThread(const Function& function, Job* parent = NULL)
+	{
+		Job* job = Create(function, parent);
+		job->MainThread = true;
+		return job;
+	}
+
+	void Run(Job* job)
+	{
+		if (job->MainThread) {
+			std::lock_guard<std::mutex> lock(mainMutex);
+			mainJobs.push_back(job);
+			mainJobCount++;
+			return;
+		}
+
+		int index = currentIndex();
+		if (index >= 0) {
+			// A full deque means plenty of queued work already, run this one right here
+			if (!deques[index]->Push(job)) {
+				execute(job);
+				return;
+			}
+		} else {
+			std::lock_guard<std::mutex> lock(sharedMutex);
+			sharedJobs.push_back(job);
+			sharedJobCount++;
+		}
+		if (sleeping.load(std::memory_order_relaxed) > 0)
+			wake.notify_one();
+	}
+
+	bool IsFinished(const Job* job) const
+	{
+		return job->Unfinished.load(std::memory_order_acquire) == 0;
+	}
+
+	// Runs other jobs until `job` and all its children are finished
+	void Wait(const Job* job)
+	{
+		int index = currentIndex();
+		while (!IsFinished(job))
+			if (!executeOne(index))
+				std::this_thread::yield();
+	}
+
+	// Runs the queued main thread jobs. Call from the main thread, e.g. once per frame.
+	void RunMainThreadJobs()
+	{
+		if (std::this_thread::get_id() != ownerThread)
+			return;
+		while (Job* job = popMainJob())
+			execute(job);
+	}
+
+	// Calls body(first, last) over subranges covering [begin, end) and returns once all are done.
+	// Ranges are split lazily: a thread only hands off the upper half of its range while its own
+	// deque is empty (other threads took everything), and otherwise works through it `grain`
+	// items at a time. So splits happen where threads are idle, and a single thread runs the
+	// whole range with no jobs at all. grain 0 picks one from the range size and thread count.
+	template <typename Body>
+	void ParallelFor(size_t begin, size_t end, const Body& body, size_t grain = 0)
+	{
+		if (begin >= end)
+			return;
+		if (grain == 0)
+			grain = std::max<size_t>((end - begin) / (GetThreadCount() * 16), 1);
+
+		int index = currentIndex();
+		if (index < 0 || GetThreadCount() == 1) {
+			body(begin, end);
+			return;
+		}
+
+		Job* root = Create([]() {});
+		runRange(&body, begin, end, grain, root);
+		execute(root);
+		Wait(root);
+	}
+
+private:
+	std::vector<std::unique_ptr<JobDeque> > deques;	// [0] belongs to the thread that created the system
+	std::vector<std::thread> threads;
+	std::thread::id ownerThread;
+
+	// Jobs only the owner thread runs, and jobs handed in by threads outside the system
+	std::mutex mainMutex;
+	std::deque<Job*> mainJobs;
+	std::atomic<int> mainJobCount;
+	std::mutex sharedMutex;
+	std::deque<Job*> sharedJobs;
+	std::atomic<int> sharedJobCount;
+
+	// Idle workers sleep here after spinning for a while
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> sleeping;
+	std::atomic<bool> running;
+
+	// Which system and deque the current thread works for
+	static JobSystem*& currentSystem()
+	{
+		static thread_local JobSystem* system = NULL;
+		return system;
+	}
+
+	static int& currentWorker()
+	{
+		static thread_local int worker = -1;
+		return worker;
+	}
+
+	// Deque index of the calling thread, -1 for threads outside the system
+	int currentIndex() const
+	{
+		if (currentSystem() == this)
+			return currentWorker();
+		if (std::this_thread::get_id() == ownerThread)
+			return 0;
+		return -1;
+	}
+
+	// Jobs come from a per thread ring. Slots whose job (or one of its children) hasn't finished
+	// are skipped; if every slot is taken, this thread helps with other jobs until one frees up.
+	Job* allocate()
+	{
+		static thread_local std::unique_ptr<Job[]> pool;
+		static thread_local unsigned int next = 0;
+		if (!pool) {
+			pool.reset(new Job[JOB_POOL_SIZE]);
+			for (unsigned int i = 0; i < JOB_POOL_SIZE; i++)
+				pool[i].Unfinished.store(0, std::memory_order_relaxed);
+		}
+		while (true) {
+			for (unsigned int i = 0; i < JOB_POOL_SIZE; i++) {
+				Job* job = &pool[next++ & (JOB_POOL_SIZE - 1)];
+				if (job->Unfinished.load(std::memory_order_acquire) == 0)
+					return job;
+			}
+			if (!executeOne(currentIndex()))
+				std::this_thread::yield();
+		}
+	}
+
+	void execute(Job* job)
+	{
+		job->Function(job);
+		job->Destroy(job);
+		finish(job);
+	}
+
+	// The parent is read first: once a job is finished its owner may reuse the slot
+	void finish(Job* job)
+	{
+		while (job != NULL) {
+			Job* parent = job->Parent;
+			if (job->Unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+				break;
+			job = parent;
+		}
+	}
+
+	Job* popMainJob()
+	{
+		if (mainJobCount.load(std::memory_order_relaxed) == 0)
+			return NULL;
+		std::lock_guard<std::mutex> lock(mainMutex);
+		if (mainJobs.empty())
+			return NULL;
+		Job* job = mainJobs.front();
+		mainJobs.pop_front();
+		mainJobCount--;
+		return job;
+	}
+
+	Job* popSharedJob()
+	{
+		if (sharedJobCount.load(std::memory_order_relaxed) == 0)
+			return NULL;
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		if (sharedJobs.empty())
+			return NULL;
+		Job* job = sharedJobs.front();
+		sharedJobs.pop_front();
+		sharedJobCount--;
+		return job;
+	}
+
+	// Finds and runs one job: main thread jobs (owner only), the own deque, handed in jobs, then
+	// stealing from the other deques starting at a random one. Returns false if there was nothing.
+	bool executeOne(int index)
+	{
+		Job* job = NULL;
+		if (index == 0 && std::this_thread::get_id() == ownerThread)
+			job = popMainJob();
+		if (job == NULL && index >= 0)
+			job = deques[index]->Pop();
+		if (job == NULL)
+			job = popSharedJob();
+		if (job == NULL) {
+			static thread_local unsigned int random = 1;
+			random = random * 1664525u + 1013904223u;
+			unsigned int count = GetThreadCount();
+			unsigned int start = (random >> 8) % count;
+			for (unsigned int i = 0; i < count && job == NULL; i++) {
+				unsigned int victim = (start + i) % count;
+				if ((int) victim != index)
+					job = deques[victim]->Steal();
+			}
+		}
+		if (job == NULL)
+			return false;
+		execute(job);
+		return true;
+	}
+
+	void workerLoop(unsigned int index)
+	{
+		currentSystem() = this;
+		currentWorker() = (int) index;
+
+		unsigned int idle = 0;
+		while (running.load(std::memory_order_relaxed)) {
+			if (executeOne((int) index)) {
+				idle = 0;
+			} else if (++idle < 64) {
+				std::this_thread::yield();
+			} else {
+				// A Run racing with falling asleep is picked up after the timeout at the latest
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleeping++;
+				wake.wait_for(lock, std::chrono::milliseconds(1));
+				sleeping--;
+				idle = 0;
+			}
+		}
+	}
+
+	template <typename Body>
+	void runRange(const Body* body, size_t begin, size_t end, size_t grain, Job* root)
+	{
+		int index = currentIndex();
+		while (begin < end) {
+			while (end - begin > grain && deques[index]->IsEmpty()) {
+				size_t middle = begin + (end - begin) / 2;
+				Job* half = Create([this, body, middle, end, grain, root]() { runRange(body, middle, end, grain, root); }, root);
+				Run(half);
+				end = middle;
+			}
+			size_t last = std::min(end, begin + grain);
+			(*body)(begin, last);
+			begin = last;
+		}
+	}
+};
+
+// The job system the engine code uses unless given another one. Created with one thread per
+// hardware thread on first use, which should happen on the main thread.
+inline JobSystem& GetJobSystem()
+{
+	static JobSystem jobs;
+	return jobs;
+}
+#endif
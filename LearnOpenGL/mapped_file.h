@@ -0,0 +1,126 @@
+#pragma once
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The OS pages the contents in on demand,
+// so nothing is copied until the data is actually touched.
+class MappedFile
+{
+public:
+	MappedFile() : data(nullptr), size(0)
+#ifdef _WIN32
+		, file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+	{
+	}
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool Open(const char* path)
+	{
+		Close();
+
+#ifdef _WIN32
+		file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			Close();
+			return false;
+		}
+		size = (size_t) fileSize.QuadPart;
+
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			Close();
+			return false;
+		}
+
+		data = (const unsigned char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data == nullptr) {
+			Close();
+			return false;
+		}
+#else
+		int fd = open(path, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			close(fd);
+			return false;
+		}
+		size = (size_t) info.st_size;
+
+		void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping keeps its own reference to the file
+		close(fd);
+		if (mapped == MAP_FAILED) {
+			size = 0;
+			return false;
+		}
+		madvise(mapped, size, MADV_SEQUENTIAL);
+		data = (const unsigned char*) mapped;
+#endif
+		return true;
+	}
+
+	void Close()
+	{
+#ifdef _WIN32
+		if (data != nullptr)
+			UnmapViewOfFile(data);
+		if (mapping != NULL)
+			CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		if (data != nullptr)
+			munmap((void*) data, size);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	const unsigned char* Data() const { return data; }
+	size_t Size() const { return size; }
+	bool IsOpen() const { return data != nullptr; }
+
+private:
+	const unsigned char* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+
+	// A mapping owns OS handles, so it can't be copied
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+#endif
@@ -0,0 +1,196 @@
+#pragma once
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+// Describes one vertex attribute exactly the way it is handed to glVertexAttribPointer
+struct MeshAttribute
+{
+	GLuint Location;
+	GLint Size;
+	GLenum Type;
+	GLboolean Normalized;
+	GLuint Offset;
+};
+
+// Default attribute locations shared by the demo shaders
+const GLuint ATTRIBUTE_POSITION = 0;
+const GLuint ATTRIBUTE_TEXCOORD = 1;
+const GLuint ATTRIBUTE_NORMAL = 2;
+const GLuint ATTRIBUTE_COLOR = 3;
+// Per instance model matrix, one location per matrix column (mat4) or row (mat3x4)
+const GLuint ATTRIBUTE_INSTANCE_MODEL = 4;
+
+// Non-owning view of interleaved vertex data and indices, ready to be uploaded as-is.
+// Used both for meshes living in memory and for meshes mapped straight from disk.
+struct MeshView
+{
+	const MeshAttribute* Attributes;
+	unsigned int AttributeCount;
+	unsigned int VertexStride;
+	unsigned int VertexCount;
+	const void* Vertices;
+	unsigned int IndexCount;
+	GLenum IndexType;
+	const void* Indices;
+};
+
+// Returns the size in bytes of a single index of the given GL index type
+inline unsigned int IndexTypeSize(GLenum indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? 2 : (indexType == GL_UNSIGNED_BYTE ? 1 : 4);
+}
+
+// Indexed, interleaved mesh owned in system memory
+struct MeshData
+{
+	std::vector<MeshAttribute> Attributes;
+	unsigned int VertexStride;
+	unsigned int VertexCount;
+	std::vector<unsigned char> Vertices;
+	std::vector<unsigned int> Indices;
+	glm::vec3 BoundsMin;
+	glm::vec3 BoundsMax;
+	// Set when positions are stored normalized to [0, 1] across the bounding box (see vertex_quantization.h)
+	bool PositionsNormalizedToBounds;
+
+	MeshData() : VertexStride(0), VertexCount(0), BoundsMin(0.0f), BoundsMax(0.0f), PositionsNormalizedToBounds(false)
+	{
+	}
+
+	// Returns the attribute bound to the given location, or nullptr if the mesh has none
+	const MeshAttribute* FindAttribute(GLuint location) const
+	{
+		for (size_t i = 0; i < Attributes.size(); i++)
+			if (Attributes[i].Location == location)
+				return &Attributes[i];
+		return nullptr;
+	}
+
+	// Reads a float vec3 attribute of the given vertex (position / normal)
+	glm::vec3 GetVec3(const MeshAttribute& attribute, unsigned int vertex) const
+	{
+		glm::vec3 value;
+		memcpy(&value[0], &Vertices[vertex * VertexStride + attribute.Offset], sizeof(glm::vec3));
+		return value;
+	}
+
+	// Recalculates the axis aligned bounding box from the float position attribute
+	void ComputeBounds()
+	{
+		const MeshAttribute* position = FindAttribute(ATTRIBUTE_POSITION);
+		if (position == nullptr || position->Type != GL_FLOAT || VertexCount == 0) {
+			BoundsMin = BoundsMax = glm::vec3(0.0f);
+			return;
+		}
+
+		BoundsMin = glm::vec3(FLT_MAX);
+		BoundsMax = glm::vec3(-FLT_MAX);
+		for (unsigned int i = 0; i < VertexCount; i++) {
+			glm::vec3 p = GetVec3(*position, i);
+			BoundsMin = glm::min(BoundsMin, p);
+			BoundsMax = glm::max(BoundsMax, p);
+		}
+	}
+
+	MeshView View() const
+	{
+		MeshView view;
+		view.Attributes = Attributes.empty() ? nullptr : &Attributes[0];
+		view.AttributeCount = (unsigned int) Attributes.size();
+		view.VertexStride = VertexStride;
+		view.VertexCount = VertexCount;
+		view.Vertices = Vertices.empty() ? nullptr : &Vertices[0];
+		view.IndexCount = (unsigned int) Indices.size();
+		view.IndexType = GL_UNSIGNED_INT;
+		view.Indices = Indices.empty() ? nullptr : &Indices[0];
+		return view;
+	}
+};
+
+// Issues the glVertexAttribPointer / glEnableVertexAttribArray calls for a layout.
+// Expects the VAO and the GL_ARRAY_BUFFER holding the vertices to be bound.
+inline void ConfigureVertexAttributes(const MeshAttribute* attributes, unsigned int attributeCount, unsigned int stride)
+{
+	for (unsigned int i = 0; i < attributeCount; i++) {
+		const MeshAttribute& attribute = attributes[i];
+		glVertexAttribPointer(attribute.Location, attribute.Size, attribute.Type, attribute.Normalized, stride, (void*)(size_t) attribute.Offset);
+		glEnableVertexAttribArray(attribute.Location);
+	}
+}
+
+// Layout of one glDrawElementsIndirect / glMultiDrawElementsIndirect command
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+// A mesh uploaded to the GPU: VAO + VBO + EBO
+class Mesh
+{
+public:
+	unsigned int VAO;
+	unsigned int VBO;
+	unsigned int EBO;
+	unsigned int IndexCount;
+	GLenum IndexType;
+
+	Mesh() : VAO(0), VBO(0), EBO(0), IndexCount(0), IndexType(GL_UNSIGNED_INT)
+	{
+	}
+
+	// Creates the buffers, copies the vertex/index blobs in a single glBufferData each and
+	// configures the VAO from the attribute layout
+	void Upload(const MeshView& view)
+	{
+		Release();
+
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+
+		glBindVertexArray(VAO);
+
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) view.VertexCount * view.VertexStride, view.Vertices, GL_STATIC_DRAW);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) view.IndexCount * IndexTypeSize(view.IndexType), view.Indices, GL_STATIC_DRAW);
+
+		ConfigureVertexAttributes(view.Attributes, view.AttributeCount, view.VertexStride);
+
+		glBindVertexArray(0);
+
+		IndexCount = view.IndexCount;
+		IndexType = view.IndexType;
+	}
+
+	void Draw() const
+	{
+		glBindVertexArray(VAO);
+		glDrawElements(GL_TRIANGLES, IndexCount, IndexType, 0);
+	}
+
+	void Release()
+	{
+		if (VAO != 0)
+			glDeleteVertexArrays(1, &VAO);
+		if (VBO != 0)
+			glDeleteBuffers(1, &VBO);
+		if (EBO != 0)
+			glDeleteBuffers(1, &EBO);
+		VAO = VBO = EBO = 0;
+		IndexCount = 0;
+	}
+};
+#endif
@@ -0,0 +1,302 @@
+#pragma once
+#ifndef MESH_BINARY_H
+#define MESH_BINARY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+
+// Binary mesh file layout (little endian):
+//
+//   MeshFileHeader
+//   MeshFileAttribute[AttributeCount]     -- mirrors the glVertexAttribPointer calls
+//   padding up to MESH_FILE_ALIGNMENT
+//   vertex blob                           -- interleaved, uploaded with a single glBufferData
+//   padding up to MESH_FILE_ALIGNMENT
+//   index blob                            -- GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+//
+// Both blobs start on a MESH_FILE_ALIGNMENT boundary, so once the file is mapped they can be
+// handed to GL (or memcpy'd into a mapped buffer) without any parsing or copying.
+
+const char MESH_FILE_MAGIC[4] = { 'L', 'O', 'G', 'M' };
+const uint32_t MESH_FILE_VERSION = 1;
+const uint32_t MESH_FILE_ALIGNMENT = 64;
+
+// Header flags
+const uint32_t MESH_FILE_FLAG_POSITIONS_NORMALIZED_TO_BOUNDS = 1;
+
+struct MeshFileHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint32_t VertexCount;
+	uint32_t VertexStride;
+	uint32_t IndexCount;
+	uint32_t IndexType;
+	uint32_t AttributeCount;
+	uint32_t Flags;
+	float BoundsMin[3];
+	float BoundsMax[3];
+	uint64_t VertexDataOffset;
+	uint64_t VertexDataSize;
+	uint64_t IndexDataOffset;
+	uint64_t IndexDataSize;
+};
+static_assert(sizeof(MeshFileHeader) == 88, "MeshFileHeader must not contain implicit padding");
+
+struct MeshFileAttribute
+{
+	uint32_t Location;
+	int32_t Size;
+	uint32_t Type;
+	uint32_t Normalized;
+	uint32_t Offset;
+};
+static_assert(sizeof(MeshFileAttribute) == 20, "MeshFileAttribute must not contain implicit padding");
+
+inline uint64_t AlignMeshFileOffset(uint64_t offset)
+{
+	return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+// Writes a mesh to disk. Indices are narrowed to 16 bits whenever the vertex count allows it.
+inline bool SaveMeshFile(const char* path, const MeshData& mesh)
+{
+	bool shortIndices = mesh.VertexCount <= 0xFFFF;
+
+	MeshFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, MESH_FILE_MAGIC, sizeof(header.Magic));
+	header.Version = MESH_FILE_VERSION;
+	header.VertexCount = mesh.VertexCount;
+	header.VertexStride = mesh.VertexStride;
+	header.IndexCount = (uint32_t) mesh.Indices.size();
+	header.IndexType = shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	header.AttributeCount = (uint32_t) mesh.Attributes.size();
+	header.Flags = mesh.PositionsNormalizedToBounds ? MESH_FILE_FLAG_POSITIONS_NORMALIZED_TO_BOUNDS : 0;
+	for (int i = 0; i < 3; i++) {
+		header.BoundsMin[i] = mesh.BoundsMin[i];
+		header.BoundsMax[i] = mesh.BoundsMax[i];
+	}
+	header.VertexDataOffset = AlignMeshFileOffset(sizeof(MeshFileHeader) + header.AttributeCount * sizeof(MeshFileAttribute));
+	header.VertexDataSize = (uint64_t) mesh.VertexCount * mesh.VertexStride;
+	header.IndexDataOffset = AlignMeshFileOffset(header.VertexDataOffset + header.VertexDataSize);
+	header.IndexDataSize = (uint64_t) header.IndexCount * (shortIndices ? 2 : 4);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		std::cout << "ERROR::MESH_FILE::FILE_NOT_SUCCESFULLY_OPENED: " << path << std::endl;
+		return false;
+	}
+
+	static const char padding[MESH_FILE_ALIGNMENT] = {};
+
+	file.write((const char*) &header, sizeof(header));
+	for (size_t i = 0; i < mesh.Attributes.size(); i++) {
+		MeshFileAttribute attribute;
+		attribute.Location = mesh.Attributes[i].Location;
+		attribute.Size = mesh.Attributes[i].Size;
+		attribute.Type = mesh.Attributes[i].Type;
+		attribute.Normalized = mesh.Attributes[i].Normalized;
+		attribute.Offset = mesh.Attributes[i].Offset;
+		file.write((const char*) &attribute, sizeof(attribute));
+	}
+
+	uint64_t written = sizeof(MeshFileHeader) + header.AttributeCount * sizeof(MeshFileAttribute);
+	file.write(padding, (std::streamsize)(header.VertexDataOffset - written));
+	if (header.VertexDataSize > 0)
+		file.write((const char*) &mesh.Vertices[0], (std::streamsize) header.VertexDataSize);
+
+	written = header.VertexDataOffset + header.VertexDataSize;
+	file.write(padding, (std::streamsize)(header.IndexDataOffset - written));
+	if (shortIndices) {
+		std::vector<uint16_t> indices(mesh.Indices.begin(), mesh.Indices.end());
+		if (!indices.empty())
+			file.write((const char*) &indices[0], (std::streamsize) header.IndexDataSize);
+	}
+	else if (!mesh.Indices.empty()) {
+		file.write((const char*) &mesh.Indices[0], (std::streamsize) header.IndexDataSize);
+	}
+
+	if (!file) {
+		std::cout << "ERROR::MESH_FILE::FILE_NOT_SUCCESFULLY_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// A mesh file mapped into memory. The view points straight into the mapping, so it stays
+// valid for as long as the MeshFile is open.
+class MeshFile
+{
+public:
+	const MeshFileHeader* Header;
+
+	MeshFile() : Header(nullptr)
+	{
+	}
+
+	bool Load(const char* path)
+	{
+		Close();
+
+		if (!file.Open(path)) {
+			std::cout << "ERROR::MESH_FILE::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+			return false;
+		}
+
+		if (!validate()) {
+			std::cout << "ERROR::MESH_FILE::INVALID_FILE: " << path << std::endl;
+			Close();
+			return false;
+		}
+
+		Header = (const MeshFileHeader*) file.Data();
+
+		const MeshFileAttribute* fileAttributes = (const MeshFileAttribute*)(file.Data() + sizeof(MeshFileHeader));
+		attributes.resize(Header->AttributeCount);
+		for (uint32_t i = 0; i < Header->AttributeCount; i++) {
+			attributes[i].Location = fileAttributes[i].Location;
+			attributes[i].Size = fileAttributes[i].Size;
+			attributes[i].Type = fileAttributes[i].Type;
+			attributes[i].Normalized = fileAttributes[i].Normalized ? GL_TRUE : GL_FALSE;
+			attributes[i].Offset = fileAttributes[i].Offset;
+		}
+		return true;
+	}
+
+	void Close()
+	{
+		file.Close();
+		attributes.clear();
+		Header = nullptr;
+	}
+
+	MeshView View() const
+	{
+		MeshView view;
+		view.Attributes = attributes.empty() ? nullptr : &attributes[0];
+		view.AttributeCount = (unsigned int) attributes.size();
+		view.VertexStride = Header->VertexStride;
+		view.VertexCount = Header->VertexCount;
+		view.Vertices = file.Data() + Header->VertexDataOffset;
+		view.IndexCount = Header->IndexCount;
+		view.IndexType = Header->IndexType;
+		view.Indices = file.Data() + Header->IndexDataOffset;
+		return view;
+	}
+
+	// Bounds and flags as stored in the header; together they give the position dequantization of a
+	// quantized file (GetPositionDequantization in vertex_quantization.h)
+	glm::vec3 GetBoundsMin() const
+	{
+		return glm::vec3(Header->BoundsMin[0], Header->BoundsMin[1], Header->BoundsMin[2]);
+	}
+
+	glm::vec3 GetBoundsMax() const
+	{
+		return glm::vec3(Header->BoundsMax[0], Header->BoundsMax[1], Header->BoundsMax[2]);
+	}
+
+	uint32_t GetFlags() const
+	{
+		return Header->Flags;
+	}
+
+	bool PositionsNormalizedToBounds() const
+	{
+		return (Header->Flags & MESH_FILE_FLAG_POSITIONS_NORMALIZED_TO_BOUNDS) != 0;
+	}
+
+	// Copies the mesh out of the mapping, header bounds and flags included
+	void CopyTo(MeshData& mesh) const
+	{
+		mesh = MeshData();
+		mesh.Attributes = attributes;
+		mesh.VertexStride = Header->VertexStride;
+		mesh.VertexCount = Header->VertexCount;
+		const unsigned char* vertices = file.Data() + Header->VertexDataOffset;
+		mesh.Vertices.assign(vertices, vertices + Header->VertexDataSize);
+		mesh.Indices.resize(Header->IndexCount);
+		const unsigned char* indices = file.Data() + Header->IndexDataOffset;
+		for (uint32_t i = 0; i < Header->IndexCount; i++) {
+			if (Header->IndexType == GL_UNSIGNED_SHORT) {
+				uint16_t index;
+				memcpy(&index, indices + i * 2, sizeof(index));
+				mesh.Indices[i] = index;
+			}
+			else
+				memcpy(&mesh.Indices[i], indices + i * 4, sizeof(uint32_t));
+		}
+		mesh.BoundsMin = GetBoundsMin();
+		mesh.BoundsMax = GetBoundsMax();
+		mesh.PositionsNormalizedToBounds = PositionsNormalizedToBounds();
+	}
+
+	// Maps the file and uploads it, configuring the VAO from the stored attribute layout
+	bool LoadAndUpload(const char* path, Mesh& mesh)
+	{
+		if (!Load(path))
+			return false;
+		mesh.Upload(View());
+		return true;
+	}
+
+private:
+	MappedFile file;
+	std::vector<MeshAttribute> attributes;
+
+	// Checks every offset/size in the header against the mapped size before anything is dereferenced
+	bool validate() const
+	{
+		if (file.Size() < sizeof(MeshFileHeader))
+			return false;
+
+		const MeshFileHeader* header = (const MeshFileHeader*) file.Data();
+		if (memcmp(header->Magic, MESH_FILE_MAGIC, sizeof(header->Magic)) != 0 || header->Version != MESH_FILE_VERSION)
+			return false;
+		if (header->IndexType != GL_UNSIGNED_SHORT && header->IndexType != GL_UNSIGNED_INT)
+			return false;
+
+		uint64_t fileSize = file.Size();
+		uint64_t attributesEnd = sizeof(MeshFileHeader) + (uint64_t) header->AttributeCount * sizeof(MeshFileAttribute);
+		if (attributesEnd > fileSize)
+			return false;
+		if (header->VertexDataSize != (uint64_t) header->VertexCount * header->VertexStride)
+			return false;
+		if (header->IndexDataSize != (uint64_t) header->IndexCount * IndexTypeSize(header->IndexType))
+			return false;
+		if (header->VertexDataOffset % MESH_FILE_ALIGNMENT != 0 || header->IndexDataOffset % MESH_FILE_ALIGNMENT != 0)
+			return false;
+		if (header->VertexDataOffset < attributesEnd || header->VertexDataOffset + header->VertexDataSize > fileSize)
+			return false;
+		if (header->IndexDataOffset < header->VertexDataOffset + header->VertexDataSize || header->IndexDataOffset + header->IndexDataSize > fileSize)
+			return false;
+
+		const MeshFileAttribute* fileAttributes = (const MeshFileAttribute*)(file.Data() + sizeof(MeshFileHeader));
+		for (uint32_t i = 0; i < header->AttributeCount; i++)
+			if (fileAttributes[i].Offset >= header->VertexStride)
+				return false;
+
+		return true;
+	}
+};
+
+// Reads a mesh file into system memory, the inverse of SaveMeshFile
+inline bool LoadMeshFile(const char* path, MeshData& mesh)
+{
+	MeshFile file;
+	if (!file.Load(path))
+		return false;
+	file.CopyTo(mesh);
+	return true;
+}
+#endif
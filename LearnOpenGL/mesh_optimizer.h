@@ -0,0 +1,505 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "mesh.h"
+
+// Index / vertex reordering for indexed triangle meshes:
+//
+//   OptimizeVertexCache   reorders triangles for post-transform cache hits (Forsyth)
+//   OptimizeOverdraw      reorders clusters of triangles so outward facing ones come first
+//   OptimizeVertexFetch   reorders vertices in order of first use
+//
+// OptimizeMesh runs all three in that order. AnalyzeVertexCache (FIFO cache simulator) and
+// AnalyzeOverdraw (software rasterizer) measure the effect without needing a GPU.
+
+// Post-transform cache statistics for a given cache size
+struct VertexCacheStatistics
+{
+	unsigned int VerticesTransformed;
+	// Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for big grids, 3 is worst)
+	float ACMR;
+	// Average transform to vertex ratio: transformed vertices per referenced vertex (1 is ideal)
+	float ATVR;
+};
+
+// Overdraw statistics collected by the software rasterizer
+struct OverdrawStatistics
+{
+	unsigned int PixelsCovered;
+	unsigned int PixelsShaded;
+	// Shaded pixels per covered pixel (1 is ideal)
+	float Overdraw;
+};
+
+// Simulates a FIFO post-transform cache like the one found in most GPUs
+inline VertexCacheStatistics AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = 16)
+{
+	std::vector<unsigned int> timestamps(vertexCount, 0);
+	std::vector<unsigned char> referenced(vertexCount, 0);
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int misses = 0;
+	unsigned int uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int index = indices[i];
+		if (!referenced[index]) {
+			referenced[index] = 1;
+			uniqueVertices++;
+		}
+		// In a FIFO cache a vertex stays resident for the next cacheSize misses
+		if (timestamp - timestamps[index] > cacheSize) {
+			timestamps[index] = timestamp++;
+			misses++;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+	statistics.VerticesTransformed = misses;
+	statistics.ACMR = indexCount > 0 ? (float) misses / (indexCount / 3) : 0.0f;
+	statistics.ATVR = uniqueVertices > 0 ? (float) misses / uniqueVertices : 0.0f;
+	return statistics;
+}
+
+namespace MeshOptimizer {
+
+	// Forsyth's "Linear-speed vertex cache optimisation" parameters
+	const unsigned int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+	const unsigned int MAX_VALENCE = 64;
+
+	struct ScoreTables
+	{
+		float Cache[CACHE_SIZE];
+		float Valence[MAX_VALENCE];
+
+		ScoreTables()
+		{
+			for (unsigned int i = 0; i < CACHE_SIZE; i++) {
+				if (i < 3)
+					Cache[i] = LAST_TRIANGLE_SCORE;
+				else
+					Cache[i] = std::pow(1.0f - (float)(i - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+			Valence[0] = 0.0f;
+			for (unsigned int i = 1; i < MAX_VALENCE; i++)
+				Valence[i] = VALENCE_BOOST_SCALE * std::pow((float) i, -VALENCE_BOOST_POWER);
+		}
+	};
+
+	inline float vertexScore(const ScoreTables& tables, int cachePosition, unsigned int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+		float score = cachePosition >= 0 ? tables.Cache[cachePosition] : 0.0f;
+		return score + tables.Valence[std::min(remainingTriangles, MAX_VALENCE - 1)];
+	}
+
+	// Per-vertex list of the triangles using it, stored as one flat array
+	struct TriangleAdjacency
+	{
+		std::vector<unsigned int> Counts;
+		std::vector<unsigned int> Offsets;
+		std::vector<unsigned int> Triangles;
+
+		void Build(const unsigned int* indices, size_t indexCount, unsigned int vertexCount)
+		{
+			Counts.assign(vertexCount, 0);
+			Offsets.assign(vertexCount, 0);
+			Triangles.resize(indexCount);
+
+			for (size_t i = 0; i < indexCount; i++)
+				Counts[indices[i]]++;
+			unsigned int offset = 0;
+			for (unsigned int v = 0; v < vertexCount; v++) {
+				Offsets[v] = offset;
+				offset += Counts[v];
+			}
+			std::vector<unsigned int> fill(Offsets);
+			for (size_t i = 0; i < indexCount; i++)
+				Triangles[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+	};
+
+	inline glm::vec3 readPosition(const unsigned char* vertices, unsigned int stride, unsigned int index)
+	{
+		glm::vec3 p;
+		memcpy(&p[0], vertices + (size_t) index * stride, sizeof(p));
+		return p;
+	}
+}
+
+// Reorders triangles to maximize post-transform vertex cache hits (Tom Forsyth's algorithm).
+// Greedily emits the triangle whose vertices score highest, where a vertex scores high if it
+// was used recently (still in the simulated LRU cache) or has few triangles left.
+inline void OptimizeVertexCache(unsigned int* indices, size_t indexCount, unsigned int vertexCount)
+{
+	using namespace MeshOptimizer;
+	static const ScoreTables tables;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	TriangleAdjacency adjacency;
+	adjacency.Build(indices, triangleCount * 3, vertexCount);
+
+	// Remaining (not yet emitted) triangles per vertex, kept at the front of each adjacency list
+	std::vector<unsigned int> remaining(adjacency.Counts);
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(tables, -1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+	std::vector<unsigned char> emitted(triangleCount, 0);
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	unsigned int cache[CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+	size_t nextInputTriangle = 0;
+
+	while (output.size() < triangleCount * 3) {
+		// Best triangle touching a cached vertex
+		int best = -1;
+		float bestScore = -FLT_MAX;
+		for (unsigned int c = 0; c < cacheCount; c++) {
+			unsigned int v = cache[c];
+			const unsigned int* triangles = &adjacency.Triangles[adjacency.Offsets[v]];
+			for (unsigned int k = 0; k < remaining[v]; k++) {
+				unsigned int t = triangles[k];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = (int) t;
+				}
+			}
+		}
+
+		// Nothing adjacent to the cache: continue with the next unemitted triangle in input order
+		if (best < 0) {
+			while (emitted[nextInputTriangle])
+				nextInputTriangle++;
+			best = (int) nextInputTriangle;
+		}
+
+		emitted[best] = 1;
+		const unsigned int* triangle = &indices[best * 3];
+		output.push_back(triangle[0]);
+		output.push_back(triangle[1]);
+		output.push_back(triangle[2]);
+
+		// Remove the triangle from its vertices' remaining lists
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = triangle[k];
+			unsigned int* triangles = &adjacency.Triangles[adjacency.Offsets[v]];
+			for (unsigned int j = 0; j < remaining[v]; j++) {
+				if (triangles[j] == (unsigned int) best) {
+					std::swap(triangles[j], triangles[remaining[v] - 1]);
+					remaining[v]--;
+					break;
+				}
+			}
+		}
+
+		// New LRU cache: the triangle's vertices first, then the previous contents
+		unsigned int newCache[CACHE_SIZE + 3];
+		unsigned int newCount = 0;
+		for (int k = 0; k < 3; k++) {
+			bool duplicate = false;
+			for (unsigned int j = 0; j < newCount; j++)
+				duplicate = duplicate || newCache[j] == triangle[k];
+			if (!duplicate)
+				newCache[newCount++] = triangle[k];
+		}
+		for (unsigned int c = 0; c < cacheCount; c++) {
+			unsigned int v = cache[c];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v;
+		}
+
+		// Rescore every vertex whose cache position changed, including the evicted ones
+		for (unsigned int c = 0; c < newCount; c++) {
+			unsigned int v = newCache[c];
+			cachePosition[v] = c < CACHE_SIZE ? (int) c : -1;
+			float newScore = vertexScore(tables, cachePosition[v], remaining[v]);
+			float delta = newScore - score[v];
+			score[v] = newScore;
+			const unsigned int* triangles = &adjacency.Triangles[adjacency.Offsets[v]];
+			for (unsigned int k = 0; k < remaining[v]; k++)
+				triangleScore[triangles[k]] += delta;
+		}
+
+		cacheCount = std::min(newCount, CACHE_SIZE);
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+	}
+
+	memcpy(indices, &output[0], output.size() * sizeof(unsigned int));
+}
+
+// Reorders clusters of a cache-optimized index buffer to reduce overdraw regardless of the
+// view direction (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw"). The buffer is cut where the cache simulation says a new strip starts, and
+// further wherever a cut costs less than `threshold` times the cluster's ACMR. Clusters
+// facing away from the mesh center are drawn first, since they are the likely occluders.
+inline void OptimizeOverdraw(unsigned int* indices, size_t indexCount, const unsigned char* vertices, unsigned int vertexStride, unsigned int vertexCount, float threshold = 1.05f, unsigned int cacheSize = 16)
+{
+	using namespace MeshOptimizer;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Hard boundaries: triangles that miss the cache on all three vertices start a new strip
+	std::vector<size_t> hardBoundaries;
+	{
+		std::vector<unsigned int> timestamps(vertexCount, 0);
+		unsigned int timestamp = cacheSize + 1;
+		for (size_t t = 0; t < triangleCount; t++) {
+			unsigned int misses = 0;
+			for (int k = 0; k < 3; k++) {
+				unsigned int index = indices[t * 3 + k];
+				if (timestamp - timestamps[index] > cacheSize) {
+					timestamps[index] = timestamp++;
+					misses++;
+				}
+			}
+			if (t == 0 || misses == 3)
+				hardBoundaries.push_back(t);
+		}
+		hardBoundaries.push_back(triangleCount);
+	}
+
+	// Soft boundaries: restart the cache at the start of each candidate cluster and cut as
+	// soon as its ACMR gets within the threshold of the hard cluster's ACMR
+	std::vector<size_t> clusters;
+	{
+		std::vector<unsigned int> timestamps(vertexCount, 0);
+		unsigned int timestamp = cacheSize + 1;
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+			size_t start = hardBoundaries[h];
+			size_t end = hardBoundaries[h + 1];
+
+			timestamp += cacheSize + 1;
+			unsigned int hardMisses = 0;
+			for (size_t i = start * 3; i < end * 3; i++) {
+				if (timestamp - timestamps[indices[i]] > cacheSize) {
+					timestamps[indices[i]] = timestamp++;
+					hardMisses++;
+				}
+			}
+			float hardACMR = (float) hardMisses / (end - start);
+
+			size_t clusterStart = start;
+			unsigned int misses = 0;
+			timestamp += cacheSize + 1;
+			for (size_t t = start; t < end; t++) {
+				for (int k = 0; k < 3; k++) {
+					unsigned int index = indices[t * 3 + k];
+					if (timestamp - timestamps[index] > cacheSize) {
+						timestamps[index] = timestamp++;
+						misses++;
+					}
+				}
+				if (t + 1 < end && (float) misses / (t + 1 - clusterStart) <= threshold * hardACMR) {
+					clusters.push_back(clusterStart);
+					clusterStart = t + 1;
+					misses = 0;
+					timestamp += cacheSize + 1;
+				}
+			}
+			clusters.push_back(clusterStart);
+		}
+		clusters.push_back(triangleCount);
+	}
+
+	// Sort clusters by how much they face away from the mesh centroid
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	std::vector<float> sortKeys(clusters.size() - 1);
+	std::vector<glm::vec3> clusterCentroids(clusters.size() - 1);
+	std::vector<glm::vec3> clusterNormals(clusters.size() - 1);
+	for (size_t c = 0; c + 1 < clusters.size(); c++) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			glm::vec3 a = readPosition(vertices, vertexStride, indices[t * 3]);
+			glm::vec3 b = readPosition(vertices, vertexStride, indices[t * 3 + 1]);
+			glm::vec3 d = readPosition(vertices, vertexStride, indices[t * 3 + 2]);
+			glm::vec3 n = glm::cross(b - a, d - a);
+			float triangleArea = glm::length(n);
+			centroid += (a + b + d) * (triangleArea / 3.0f);
+			normal += n;
+			area += triangleArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		clusterCentroids[c] = area > 0.0f ? centroid / area : centroid;
+		float normalLength = glm::length(normal);
+		clusterNormals[c] = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	std::vector<unsigned int> order(clusters.size() - 1);
+	for (size_t c = 0; c < order.size(); c++) {
+		order[c] = (unsigned int) c;
+		sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c]);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	for (size_t i = 0; i < order.size(); i++) {
+		unsigned int c = order[i];
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	}
+	memcpy(indices, &output[0], output.size() * sizeof(unsigned int));
+}
+
+// Reorders vertices in the order the index buffer first references them so vertex fetches
+// stream through memory, and drops unreferenced vertices. Returns the new vertex count.
+inline unsigned int OptimizeVertexFetch(unsigned char* vertices, unsigned int vertexStride, unsigned int vertexCount, unsigned int* indices, size_t indexCount)
+{
+	const unsigned int UNUSED = 0xFFFFFFFFu;
+	std::vector<unsigned int> remap(vertexCount, UNUSED);
+	std::vector<unsigned char> source(vertices, vertices + (size_t) vertexCount * vertexStride);
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		unsigned int index = indices[i];
+		if (remap[index] == UNUSED) {
+			remap[index] = next;
+			memcpy(vertices + (size_t) next * vertexStride, &source[(size_t) index * vertexStride], vertexStride);
+			next++;
+		}
+		indices[i] = remap[index];
+	}
+	return next;
+}
+
+// Runs the vertex cache, overdraw and vertex fetch optimizations on a float-position mesh
+inline void OptimizeMesh(MeshData& mesh, float overdrawThreshold = 1.05f)
+{
+	if (mesh.Indices.empty() || mesh.VertexCount == 0)
+		return;
+
+	OptimizeVertexCache(&mesh.Indices[0], mesh.Indices.size(), mesh.VertexCount);
+
+	const MeshAttribute* position = mesh.FindAttribute(ATTRIBUTE_POSITION);
+	if (position != nullptr && position->Type == GL_FLOAT)
+		OptimizeOverdraw(&mesh.Indices[0], mesh.Indices.size(), &mesh.Vertices[position->Offset], mesh.VertexStride, mesh.VertexCount, overdrawThreshold);
+
+	mesh.VertexCount = OptimizeVertexFetch(&mesh.Vertices[0], mesh.VertexStride, mesh.VertexCount, &mesh.Indices[0], mesh.Indices.size());
+	mesh.Vertices.resize((size_t) mesh.VertexCount * mesh.VertexStride);
+}
+
+// Software rasterizes a float-position mesh from a set of directions around it and counts how
+// many pixels pass the depth test (shaded) versus how many end up covered. Triangles are drawn
+// in index order with a LESS depth test. Counter-clockwise triangles are front facing; with
+// backface culling off (as in the demos) a closed mesh always averages out to the same overdraw
+// over opposite view directions, so culling is on by default.
+inline OverdrawStatistics AnalyzeOverdraw(const MeshData& mesh, unsigned int resolution = 256, bool cullBackFaces = true)
+{
+	using namespace MeshOptimizer;
+
+	OverdrawStatistics statistics = { 0, 0, 0.0f };
+	const MeshAttribute* position = mesh.FindAttribute(ATTRIBUTE_POSITION);
+	if (position == nullptr || position->Type != GL_FLOAT || mesh.Indices.empty())
+		return statistics;
+
+	glm::vec3 center = (mesh.BoundsMin + mesh.BoundsMax) * 0.5f;
+	float extent = glm::length(mesh.BoundsMax - mesh.BoundsMin) * 0.5f;
+	if (extent <= 0.0f)
+		return statistics;
+
+	// The 6 axis directions plus the 8 diagonals
+	std::vector<glm::vec3> directions;
+	for (int axis = 0; axis < 3; axis++) {
+		glm::vec3 d(0.0f);
+		d[axis] = 1.0f;
+		directions.push_back(d);
+		directions.push_back(-d);
+	}
+	for (int i = 0; i < 8; i++)
+		directions.push_back(glm::normalize(glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f)));
+
+	std::vector<float> depth(resolution * resolution);
+	std::vector<unsigned int> shaded(resolution * resolution);
+	const unsigned char* vertices = &mesh.Vertices[position->Offset];
+
+	for (size_t d = 0; d < directions.size(); d++) {
+		// Orthographic basis looking along -direction
+		glm::vec3 forward = -directions[d];
+		glm::vec3 up = glm::abs(forward.y) > 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 right = glm::normalize(glm::cross(forward, up));
+		up = glm::cross(right, forward);
+
+		std::fill(depth.begin(), depth.end(), FLT_MAX);
+		std::fill(shaded.begin(), shaded.end(), 0u);
+		float scale = resolution * 0.5f / extent;
+
+		for (size_t t = 0; t + 2 < mesh.Indices.size(); t += 3) {
+			glm::vec3 screen[3];
+			for (int k = 0; k < 3; k++) {
+				glm::vec3 p = readPosition(vertices, mesh.VertexStride, mesh.Indices[t + k]) - center;
+				screen[k] = glm::vec3(glm::dot(p, right) * scale + resolution * 0.5f, glm::dot(p, up) * scale + resolution * 0.5f, glm::dot(p, forward));
+			}
+
+			float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+			if (area == 0.0f || (cullBackFaces && area < 0.0f))
+				continue;
+
+			int minX = std::max(0, (int) std::floor(std::min(screen[0].x, std::min(screen[1].x, screen[2].x))));
+			int maxX = std::min((int) resolution - 1, (int) std::ceil(std::max(screen[0].x, std::max(screen[1].x, screen[2].x))));
+			int minY = std::max(0, (int) std::floor(std::min(screen[0].y, std::min(screen[1].y, screen[2].y))));
+			int maxY = std::min((int) resolution - 1, (int) std::ceil(std::max(screen[0].y, std::max(screen[1].y, screen[2].y))));
+
+			for (int y = minY; y <= maxY; y++) {
+				for (int x = minX; x <= maxX; x++) {
+					// Barycentrics of the pixel center from the edge functions
+					float px = x + 0.5f, py = y + 0.5f;
+					float w0 = ((screen[1].x - px) * (screen[2].y - py) - (screen[2].x - px) * (screen[1].y - py)) / area;
+					float w1 = ((screen[2].x - px) * (screen[0].y - py) - (screen[0].x - px) * (screen[2].y - py)) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+						continue;
+
+					float z = w0 * screen[0].z + w1 * screen[1].z + w2 * screen[2].z;
+					unsigned int pixel = y * resolution + x;
+					if (z < depth[pixel]) {
+						depth[pixel] = z;
+						shaded[pixel]++;
+					}
+				}
+			}
+		}
+
+		for (size_t p = 0; p < shaded.size(); p++) {
+			if (shaded[p] > 0) {
+				statistics.PixelsCovered++;
+				statistics.PixelsShaded += shaded[p];
+			}
+		}
+	}
+
+	statistics.Overdraw = statistics.PixelsCovered > 0 ? (float) statistics.PixelsShaded / statistics.PixelsCovered : 0.0f;
+	return statistics;
+}
+#endif
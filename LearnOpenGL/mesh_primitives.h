@@ -0,0 +1,100 @@
+#pragma once
+#ifndef MESH_PRIMITIVES_H
+#define MESH_PRIMITIVES_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "mesh.h"
+#include "obj_loader.h"
+
+// Procedural meshes in the OBJ layout (position, texcoord, normal). Used by the
+// benchmarks so they don't depend on large model files being present.
+
+// UV sphere of the given radius with (rings + 1) * (segments + 1) vertices
+inline MeshData GenerateSphere(unsigned int rings, unsigned int segments, float radius = 1.0f)
+{
+	MeshData mesh;
+	SetObjMeshLayout(mesh, true);
+
+	std::vector<float> vertices;
+	vertices.reserve((rings + 1) * (segments + 1) * 8);
+	for (unsigned int ring = 0; ring <= rings; ring++) {
+		float v = (float) ring / rings;
+		float phi = v * glm::pi<float>();
+		for (unsigned int segment = 0; segment <= segments; segment++) {
+			float u = (float) segment / segments;
+			float theta = u * glm::two_pi<float>();
+			glm::vec3 normal(cos(theta) * sin(phi), cos(phi), sin(theta) * sin(phi));
+			glm::vec3 position = normal * radius;
+			float vertex[8] = { position.x, position.y, position.z, u, 1.0f - v, normal.x, normal.y, normal.z };
+			vertices.insert(vertices.end(), vertex, vertex + 8);
+		}
+	}
+
+	for (unsigned int ring = 0; ring < rings; ring++) {
+		for (unsigned int segment = 0; segment < segments; segment++) {
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+			mesh.Indices.push_back(a);
+			mesh.Indices.push_back(a + 1);
+			mesh.Indices.push_back(b);
+			mesh.Indices.push_back(b);
+			mesh.Indices.push_back(a + 1);
+			mesh.Indices.push_back(b + 1);
+		}
+	}
+
+	mesh.VertexCount = (unsigned int)(vertices.size() / 8);
+	mesh.Vertices.resize(vertices.size() * sizeof(float));
+	memcpy(&mesh.Vertices[0], &vertices[0], mesh.Vertices.size());
+	mesh.ComputeBounds();
+	return mesh;
+}
+
+// Torus around the y axis with (rings + 1) * (sides + 1) vertices. Unlike the sphere it isn't
+// convex, so it is useful when measuring overdraw.
+inline MeshData GenerateTorus(unsigned int rings, unsigned int sides, float radius = 1.0f, float tubeRadius = 0.25f)
+{
+	MeshData mesh;
+	SetObjMeshLayout(mesh, true);
+
+	std::vector<float> vertices;
+	vertices.reserve((rings + 1) * (sides + 1) * 8);
+	for (unsigned int ring = 0; ring <= rings; ring++) {
+		float u = (float) ring / rings;
+		float theta = u * glm::two_pi<float>();
+		glm::vec3 center(cos(theta) * radius, 0.0f, sin(theta) * radius);
+		for (unsigned int side = 0; side <= sides; side++) {
+			float v = (float) side / sides;
+			float phi = v * glm::two_pi<float>();
+			glm::vec3 normal(cos(theta) * cos(phi), sin(phi), sin(theta) * cos(phi));
+			glm::vec3 position = center + normal * tubeRadius;
+			float vertex[8] = { position.x, position.y, position.z, u, v, normal.x, normal.y, normal.z };
+			vertices.insert(vertices.end(), vertex, vertex + 8);
+		}
+	}
+
+	for (unsigned int ring = 0; ring < rings; ring++) {
+		for (unsigned int side = 0; side < sides; side++) {
+			unsigned int a = ring * (sides + 1) + side;
+			unsigned int b = a + sides + 1;
+			mesh.Indices.push_back(a);
+			mesh.Indices.push_back(a + 1);
+			mesh.Indices.push_back(b);
+			mesh.Indices.push_back(b);
+			mesh.Indices.push_back(a + 1);
+			mesh.Indices.push_back(b + 1);
+		}
+	}
+
+	mesh.VertexCount = (unsigned int)(vertices.size() / 8);
+	mesh.Vertices.resize(vertices.size() * sizeof(float));
+	memcpy(&mesh.Vertices[0], &vertices[0], mesh.Vertices.size());
+	mesh.ComputeBounds();
+	return mesh;
+}
+#endif
@@ -0,0 +1,354 @@
+#pragma once
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <glm/glm.hpp>
+#include <xmmintrin.h>
+
+#include <cfloat>
+#include <vector>
+
+#include "affine.h"
+#include "frustum.h"
+#include "job_system.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+
+// Splits indexed meshes into small clusters of triangles (meshlets) that can be culled on their
+// own, so only the visible parts of a big mesh get drawn.
+//
+// Every meshlet gets a bounding sphere and a normal cone. Each frame CullMeshlets tests four
+// meshlets per SSE instruction against the frustum and the cone (all triangles facing away
+// from the camera) and emits the survivors either as a compacted index stream or as indirect
+// draw commands into MeshletMesh::Indices.
+
+const unsigned int MESHLET_MAX_VERTICES = 64;
+const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+struct Meshlet
+{
+	// Into MeshletMesh::Vertices
+	unsigned int VertexOffset;
+	// Into MeshletMesh::Triangles (in triangles, the index stream starts at TriangleOffset * 3)
+	unsigned int TriangleOffset;
+	unsigned int VertexCount;
+	unsigned int TriangleCount;
+};
+
+struct MeshletBounds
+{
+	glm::vec3 Center;
+	float Radius;
+	glm::vec3 ConeAxis;
+	// The meshlet faces away from the camera when
+	// dot(Center - camera, ConeAxis) >= ConeCutoff * length(Center - camera) + Radius
+	float ConeCutoff;
+};
+
+struct MeshletMesh
+{
+	std::vector<Meshlet> Meshlets;
+	// Mesh vertex index of every meshlet vertex
+	std::vector<unsigned int> Vertices;
+	// Three meshlet-local vertex indices per triangle
+	std::vector<unsigned char> Triangles;
+	// The meshlet triangles as mesh indices, meshlet after meshlet. Upload this as the index buffer.
+	std::vector<unsigned int> Indices;
+
+	// Bounds as structure of arrays, padded to a multiple of 4 with meshlets that never pass
+	std::vector<float> CenterX, CenterY, CenterZ, Radius;
+	std::vector<float> ConeAxisX, ConeAxisY, ConeAxisZ, ConeCutoff;
+
+	MeshletBounds GetBounds(unsigned int meshlet) const
+	{
+		MeshletBounds bounds;
+		bounds.Center = glm::vec3(CenterX[meshlet], CenterY[meshlet], CenterZ[meshlet]);
+		bounds.Radius = Radius[meshlet];
+		bounds.ConeAxis = glm::vec3(ConeAxisX[meshlet], ConeAxisY[meshlet], ConeAxisZ[meshlet]);
+		bounds.ConeCutoff = ConeCutoff[meshlet];
+		return bounds;
+	}
+};
+
+enum Meshlet_Output {
+	MESHLET_OUTPUT_INDICES,
+	MESHLET_OUTPUT_COMMANDS
+};
+
+struct MeshletCullResult
+{
+	// Compacted index stream (MESHLET_OUTPUT_INDICES)
+	std::vector<unsigned int> Indices;
+	// Ranges of MeshletMesh::Indices, neighbouring visible meshlets merged (MESHLET_OUTPUT_COMMANDS)
+	std::vector<DrawElementsIndirectCommand> Commands;
+	unsigned int VisibleMeshlets;
+	unsigned int VisibleTriangles;
+};
+
+// One mesh placed in the world, culled by CullMeshletInstances
+struct MeshletInstance
+{
+	const MeshletMesh* Mesh;
+	Affine Model;
+};
+
+namespace MeshletBuilder {
+
+	inline void addBounds(MeshletMesh& result, const MeshletBounds& bounds)
+	{
+		result.CenterX.push_back(bounds.Center.x);
+		result.CenterY.push_back(bounds.Center.y);
+		result.CenterZ.push_back(bounds.Center.z);
+		result.Radius.push_back(bounds.Radius);
+		result.ConeAxisX.push_back(bounds.ConeAxis.x);
+		result.ConeAxisY.push_back(bounds.ConeAxis.y);
+		result.ConeAxisZ.push_back(bounds.ConeAxis.z);
+		result.ConeCutoff.push_back(bounds.ConeCutoff);
+	}
+
+	inline MeshletBounds computeBounds(const MeshletMesh& result, const Meshlet& meshlet, const MeshData& mesh, const MeshAttribute& position)
+	{
+		MeshletBounds bounds;
+
+		// Sphere around the center of the box
+		glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+		for (unsigned int i = 0; i < meshlet.VertexCount; i++) {
+			glm::vec3 p = mesh.GetVec3(position, result.Vertices[meshlet.VertexOffset + i]);
+			boxMin = glm::min(boxMin, p);
+			boxMax = glm::max(boxMax, p);
+		}
+		bounds.Center = (boxMin + boxMax) * 0.5f;
+		bounds.Radius = 0.0f;
+		for (unsigned int i = 0; i < meshlet.VertexCount; i++) {
+			glm::vec3 p = mesh.GetVec3(position, result.Vertices[meshlet.VertexOffset + i]);
+			bounds.Radius = glm::max(bounds.Radius, glm::length(p - bounds.Center));
+		}
+
+		// Cone around the average triangle normal, wide enough to hold every triangle normal
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis(0.0f);
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++) {
+			const unsigned int* triangle = &result.Indices[(meshlet.TriangleOffset + t) * 3];
+			glm::vec3 a = mesh.GetVec3(position, triangle[0]);
+			glm::vec3 n = glm::cross(mesh.GetVec3(position, triangle[1]) - a, mesh.GetVec3(position, triangle[2]) - a);
+			float area = glm::length(n);
+			if (area > 0.0f) {
+				normals.push_back(n / area);
+				axis += n;
+			}
+		}
+
+		float axisLength = glm::length(axis);
+		float minDot = 1.0f;
+		if (axisLength > 0.0f) {
+			axis /= axisLength;
+			for (size_t i = 0; i < normals.size(); i++)
+				minDot = glm::min(minDot, glm::dot(axis, normals[i]));
+		}
+
+		// Cones wider than ~85 degrees are practically never backfacing, disable them
+		if (axisLength == 0.0f || minDot <= 0.1f) {
+			bounds.ConeAxis = glm::vec3(0.0f);
+			bounds.ConeCutoff = 1.0f;
+		}
+		else {
+			bounds.ConeAxis = axis;
+			bounds.ConeCutoff = glm::sqrt(1.0f - minDot * minDot);
+		}
+		return bounds;
+	}
+}
+
+// Splits a mesh with float positions into meshlets. Meshlets are grown greedily from triangles
+// sharing vertices with them (fewest new vertices first, then closest to the meshlet center),
+// which keeps them compact and their bounds tight. Running OptimizeVertexCache first helps.
+inline MeshletMesh BuildMeshlets(const MeshData& mesh, unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES)
+{
+	MeshletMesh result;
+	const MeshAttribute* position = mesh.FindAttribute(ATTRIBUTE_POSITION);
+	size_t triangleCount = mesh.Indices.size() / 3;
+	if (position == nullptr || position->Type != GL_FLOAT || triangleCount == 0)
+		return result;
+
+	const unsigned int* indices = &mesh.Indices[0];
+	MeshOptimizer::TriangleAdjacency adjacency;
+	adjacency.Build(indices, triangleCount * 3, mesh.VertexCount);
+
+	std::vector<unsigned char> used(triangleCount, 0);
+	std::vector<int> localIndex(mesh.VertexCount, -1);
+	std::vector<unsigned int> vertices;
+	std::vector<unsigned int> triangles;
+	glm::vec3 centerSum(0.0f);
+	size_t nextInputTriangle = 0;
+	size_t emitted = 0;
+
+	auto newVertexCount = [&](size_t t) {
+		return (localIndex[indices[t * 3]] < 0 ? 1 : 0) + (localIndex[indices[t * 3 + 1]] < 0 ? 1 : 0) + (localIndex[indices[t * 3 + 2]] < 0 ? 1 : 0);
+	};
+
+	auto flush = [&]() {
+		if (triangles.empty())
+			return;
+		Meshlet meshlet;
+		meshlet.VertexOffset = (unsigned int) result.Vertices.size();
+		meshlet.TriangleOffset = (unsigned int)(result.Triangles.size() / 3);
+		meshlet.VertexCount = (unsigned int) vertices.size();
+		meshlet.TriangleCount = (unsigned int) triangles.size();
+		for (size_t i = 0; i < triangles.size(); i++) {
+			for (int k = 0; k < 3; k++) {
+				unsigned int index = indices[triangles[i] * 3 + k];
+				result.Triangles.push_back((unsigned char) localIndex[index]);
+				result.Indices.push_back(index);
+			}
+		}
+		result.Vertices.insert(result.Vertices.end(), vertices.begin(), vertices.end());
+		result.Meshlets.push_back(meshlet);
+		MeshletBuilder::addBounds(result, MeshletBuilder::computeBounds(result, meshlet, mesh, *position));
+
+		for (size_t i = 0; i < vertices.size(); i++)
+			localIndex[vertices[i]] = -1;
+		vertices.clear();
+		triangles.clear();
+		centerSum = glm::vec3(0.0f);
+	};
+
+	while (emitted < triangleCount) {
+		// Best unused triangle touching the meshlet that still fits
+		long long best = -1;
+		int bestNew = 4;
+		float bestDistance = FLT_MAX;
+		glm::vec3 center = vertices.empty() ? glm::vec3(0.0f) : centerSum / (float) vertices.size();
+		for (size_t v = 0; v < vertices.size() && bestNew > 0; v++) {
+			unsigned int vertex = vertices[v];
+			const unsigned int* adjacent = &adjacency.Triangles[adjacency.Offsets[vertex]];
+			for (unsigned int k = 0; k < adjacency.Counts[vertex]; k++) {
+				unsigned int t = adjacent[k];
+				if (used[t])
+					continue;
+				int extra = newVertexCount(t);
+				if (vertices.size() + extra > maxVertices || extra > bestNew)
+					continue;
+				glm::vec3 triangleCenter = (mesh.GetVec3(*position, indices[t * 3]) + mesh.GetVec3(*position, indices[t * 3 + 1]) + mesh.GetVec3(*position, indices[t * 3 + 2])) / 3.0f;
+				float distance = glm::dot(triangleCenter - center, triangleCenter - center);
+				if (extra < bestNew || distance < bestDistance) {
+					best = t;
+					bestNew = extra;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		// Nothing connected fits anymore: close the meshlet and start over from the input order
+		if (best < 0) {
+			flush();
+			while (used[nextInputTriangle])
+				nextInputTriangle++;
+			best = (long long) nextInputTriangle;
+		}
+
+		used[best] = 1;
+		emitted++;
+		triangles.push_back((unsigned int) best);
+		for (int k = 0; k < 3; k++) {
+			unsigned int index = indices[best * 3 + k];
+			if (localIndex[index] < 0) {
+				localIndex[index] = (int) vertices.size();
+				vertices.push_back(index);
+				centerSum += mesh.GetVec3(*position, index);
+			}
+		}
+
+		if (triangles.size() == maxTriangles || vertices.size() == maxVertices)
+			flush();
+	}
+	flush();
+
+	// Padding meshlets fail the frustum test: no sphere is ever closer than -FLT_MAX
+	MeshletBounds padding = { glm::vec3(0.0f), -FLT_MAX, glm::vec3(0.0f), 1.0f };
+	while (result.Radius.size() % 4 != 0)
+		MeshletBuilder::addBounds(result, padding);
+	return result;
+}
+
+// Culls the meshlets of one mesh. The frustum and camera position must be in the mesh's object
+// space (see TransformFrustum). Previous contents of the result are replaced.
+inline void CullMeshlets(const MeshletMesh& mesh, const Frustum& frustum, glm::vec3 cameraPosition, MeshletCullResult& result, Meshlet_Output output = MESHLET_OUTPUT_COMMANDS)
+{
+	result.Indices.clear();
+	result.Commands.clear();
+	result.VisibleMeshlets = 0;
+	result.VisibleTriangles = 0;
+
+	__m128 planes[6][4];
+	for (int p = 0; p < 6; p++)
+		for (int c = 0; c < 4; c++)
+			planes[p][c] = _mm_set1_ps(frustum.Planes[p][c]);
+	__m128 eyeX = _mm_set1_ps(cameraPosition.x);
+	__m128 eyeY = _mm_set1_ps(cameraPosition.y);
+	__m128 eyeZ = _mm_set1_ps(cameraPosition.z);
+	__m128 zero = _mm_setzero_ps();
+
+	size_t paddedCount = mesh.Radius.size();
+	for (size_t i = 0; i < paddedCount; i += 4) {
+		__m128 centerX = _mm_loadu_ps(&mesh.CenterX[i]);
+		__m128 centerY = _mm_loadu_ps(&mesh.CenterY[i]);
+		__m128 centerZ = _mm_loadu_ps(&mesh.CenterZ[i]);
+		__m128 radius = _mm_loadu_ps(&mesh.Radius[i]);
+		__m128 negativeRadius = _mm_sub_ps(zero, radius);
+
+		// Inside (or intersecting) all six planes
+		__m128 visible = _mm_cmpeq_ps(zero, zero);
+		for (int p = 0; p < 6; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], centerX), _mm_mul_ps(planes[p][1], centerY)), _mm_add_ps(_mm_mul_ps(planes[p][2], centerZ), planes[p][3]));
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negativeRadius));
+		}
+
+		if (_mm_movemask_ps(visible) == 0)
+			continue;
+
+		// Not entirely backfacing
+		__m128 toCenterX = _mm_sub_ps(centerX, eyeX);
+		__m128 toCenterY = _mm_sub_ps(centerY, eyeY);
+		__m128 toCenterZ = _mm_sub_ps(centerZ, eyeZ);
+		__m128 axisDot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, _mm_loadu_ps(&mesh.ConeAxisX[i])), _mm_mul_ps(toCenterY, _mm_loadu_ps(&mesh.ConeAxisY[i]))), _mm_mul_ps(toCenterZ, _mm_loadu_ps(&mesh.ConeAxisZ[i])));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(toCenterX, toCenterX), _mm_mul_ps(toCenterY, toCenterY)), _mm_mul_ps(toCenterZ, toCenterZ)));
+		__m128 backfacing = _mm_cmpge_ps(axisDot, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&mesh.ConeCutoff[i]), distance), radius));
+		visible = _mm_andnot_ps(backfacing, visible);
+
+		int mask = _mm_movemask_ps(visible);
+		for (int lane = 0; mask != 0; lane++, mask >>= 1) {
+			if (!(mask & 1))
+				continue;
+			const Meshlet& meshlet = mesh.Meshlets[i + lane];
+			unsigned int firstIndex = meshlet.TriangleOffset * 3;
+			unsigned int count = meshlet.TriangleCount * 3;
+			result.VisibleMeshlets++;
+			result.VisibleTriangles += meshlet.TriangleCount;
+
+			if (output == MESHLET_OUTPUT_INDICES) {
+				result.Indices.insert(result.Indices.end(), mesh.Indices.begin() + firstIndex, mesh.Indices.begin() + firstIndex + count);
+			}
+			else if (!result.Commands.empty() && result.Commands.back().FirstIndex + result.Commands.back().Count == firstIndex) {
+				result.Commands.back().Count += count;
+			}
+			else {
+				DrawElementsIndirectCommand command = { count, 1, firstIndex, 0, 0 };
+				result.Commands.push_back(command);
+			}
+		}
+	}
+}
+
+// Culls many mesh instances against a world space frustum, spreading the instances over the
+// job system. results must hold `count` entries.
+inline void CullMeshletInstances(const MeshletInstance* instances, size_t count, const Frustum& frustum, glm::vec3 cameraPosition, MeshletCullResult* results, Meshlet_Output output = MESHLET_OUTPUT_COMMANDS, JobSystem& jobs = GetJobSystem())
+{
+	jobs.ParallelFor(0, count, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			Frustum objectFrustum = TransformFrustum(frustum, instances[i].Model);
+			glm::vec3 objectCamera = InverseAffine(instances[i].Model).TransformPoint(cameraPosition);
+			CullMeshlets(*instances[i].Mesh, objectFrustum, objectCamera, results[i], output);
+		}
+	}, 1);
+}
+#endif
@@ -0,0 +1,608 @@
+#pragma once
+#ifndef OBJ_IMPORTER_H
+#define OBJ_IMPORTER_H
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "mesh.h"
+#include "obj_loader.h"
+
+// Multithreaded Wavefront OBJ importer for large models.
+//
+// The file is memory mapped and split at line boundaries into one chunk per thread.
+// Every thread parses its chunk into private v / vt / vn pools and triangulated face
+// corners, the pools are concatenated, and identical v/vt/vn triples are welded in
+// parallel by hashing them into shards. The result is the same indexed, interleaved
+// mesh LoadObj produces (same layout and vertex order), just much faster.
+
+struct ObjImportStats
+{
+	size_t FileBytes;
+	unsigned int Threads;
+	double ParseMilliseconds;
+	double MergeMilliseconds;
+	double WeldMilliseconds;
+	double TotalMilliseconds;
+};
+
+namespace ObjImport {
+
+	const double POWERS_OF_TEN[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline const char* skipBlanks(const char* c, const char* end)
+	{
+		while (c < end && isBlank(*c))
+			c++;
+		return c;
+	}
+
+	inline const char* skipLine(const char* c, const char* end)
+	{
+		while (c < end && *c != '\n')
+			c++;
+		return c < end ? c + 1 : end;
+	}
+
+	// Locale independent float parser. Mantissas of up to 19 digits with a decimal exponent
+	// within +-22 are converted with a single exactly rounded multiply/divide; anything
+	// else (rare in OBJ files) falls back to strtod.
+	inline const char* parseFloat(const char* c, const char* end, float& value)
+	{
+		const char* start = c;
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+')) {
+			negative = *c == '-';
+			c++;
+		}
+
+		uint64_t mantissa = 0;
+		int digits = 0;
+		int exponent = 0;
+		while (c < end && *c >= '0' && *c <= '9') {
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+				if (mantissa != 0)
+					digits++;
+			}
+			else {
+				exponent++;
+			}
+			c++;
+		}
+		if (c < end && *c == '.') {
+			c++;
+			while (c < end && *c >= '0' && *c <= '9') {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + (uint64_t)(*c - '0');
+					if (mantissa != 0)
+						digits++;
+					exponent--;
+				}
+				c++;
+			}
+		}
+		if (c < end && (*c == 'e' || *c == 'E')) {
+			c++;
+			bool negativeExponent = false;
+			if (c < end && (*c == '-' || *c == '+')) {
+				negativeExponent = *c == '-';
+				c++;
+			}
+			int explicitExponent = 0;
+			while (c < end && *c >= '0' && *c <= '9') {
+				if (explicitExponent < 10000)
+					explicitExponent = explicitExponent * 10 + (*c - '0');
+				c++;
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+		}
+
+		if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+			double result = (double) mantissa;
+			result = exponent < 0 ? result / POWERS_OF_TEN[-exponent] : result * POWERS_OF_TEN[exponent];
+			value = (float)(negative ? -result : result);
+			return c;
+		}
+
+		// Slow path: copy the token so strtod can't run past the mapped range
+		char buffer[64];
+		size_t length = (size_t)(c - start) < sizeof(buffer) - 1 ? (size_t)(c - start) : sizeof(buffer) - 1;
+		memcpy(buffer, start, length);
+		buffer[length] = '\0';
+		value = (float) strtod(buffer, nullptr);
+		return c;
+	}
+
+	inline const char* parseInt(const char* c, const char* end, long& value, bool& parsed)
+	{
+		bool negative = false;
+		if (c < end && (*c == '-' || *c == '+')) {
+			negative = *c == '-';
+			c++;
+		}
+		long result = 0;
+		parsed = false;
+		while (c < end && *c >= '0' && *c <= '9') {
+			result = result * 10 + (*c - '0');
+			parsed = true;
+			c++;
+		}
+		value = negative ? -result : result;
+		return c;
+	}
+
+	// Everything one thread produces for its slice of the file
+	struct Chunk
+	{
+		const char* Begin;
+		const char* End;
+		std::vector<glm::vec3> Positions;
+		std::vector<glm::vec2> TexCoords;
+		std::vector<glm::vec3> Normals;
+		// Triangulated corners, three per triangle
+		std::vector<ObjVertexKey> Corners;
+		// Corner components given as negative (relative) indices, stored as corner * 3 + component.
+		// Their value is relative to the start of this chunk's pools until the bases are known.
+		std::vector<unsigned int> RelativeFixups;
+		size_t PositionBase;
+		size_t TexCoordBase;
+		size_t NormalBase;
+		size_t CornerBase;
+	};
+
+	// Face corner as parsed, before it is emitted into a triangle. Negative (relative)
+	// indices are resolved against this chunk's pools; RelativeMask remembers which
+	// components still need the chunk's pool base added once it is known.
+	struct ParsedCorner
+	{
+		ObjVertexKey Key;
+		unsigned int RelativeMask;
+	};
+
+	inline int resolveIndex(long index, size_t localCount, unsigned int component, unsigned int& relativeMask)
+	{
+		if (index > 0)
+			return (int)(index - 1);
+		if (index < 0) {
+			relativeMask |= 1u << component;
+			return (int)((long) localCount + index);
+		}
+		return -1;
+	}
+
+	// v, v/vt, v//vn or v/vt/vn
+	inline const char* parseCorner(const char* c, const char* end, const Chunk& chunk, ParsedCorner& corner)
+	{
+		long index;
+		bool parsed;
+
+		corner.Key.Position = corner.Key.TexCoord = corner.Key.Normal = -1;
+		corner.RelativeMask = 0;
+		c = parseInt(c, end, index, parsed);
+		corner.Key.Position = resolveIndex(index, chunk.Positions.size(), 0, corner.RelativeMask);
+		if (c < end && *c == '/') {
+			c = parseInt(c + 1, end, index, parsed);
+			if (parsed)
+				corner.Key.TexCoord = resolveIndex(index, chunk.TexCoords.size(), 1, corner.RelativeMask);
+			if (c < end && *c == '/') {
+				c = parseInt(c + 1, end, index, parsed);
+				if (parsed)
+					corner.Key.Normal = resolveIndex(index, chunk.Normals.size(), 2, corner.RelativeMask);
+			}
+		}
+		// Skip anything unexpected up to the next separator
+		while (c < end && !isBlank(*c) && *c != '\n' && *c != '\r')
+			c++;
+		return c;
+	}
+
+	inline void emitCorner(Chunk& chunk, const ParsedCorner& corner)
+	{
+		for (unsigned int component = 0; component < 3; component++)
+			if (corner.RelativeMask & (1u << component))
+				chunk.RelativeFixups.push_back((unsigned int)(chunk.Corners.size() * 3 + component));
+		chunk.Corners.push_back(corner.Key);
+	}
+
+	inline void parseChunk(Chunk& chunk)
+	{
+		const char* c = chunk.Begin;
+		const char* end = chunk.End;
+
+		// Rough reservation from the byte count avoids most regrowth
+		size_t estimatedLines = (size_t)(end - c) / 32;
+		chunk.Positions.reserve(estimatedLines / 4);
+		chunk.Corners.reserve(estimatedLines);
+
+		while (c < end) {
+			c = skipBlanks(c, end);
+			if (c >= end)
+				break;
+
+			if (c[0] == 'v' && c + 1 < end && isBlank(c[1])) {
+				glm::vec3 p;
+				c = parseFloat(skipBlanks(c + 2, end), end, p.x);
+				c = parseFloat(skipBlanks(c, end), end, p.y);
+				c = parseFloat(skipBlanks(c, end), end, p.z);
+				chunk.Positions.push_back(p);
+			}
+			else if (c[0] == 'v' && c + 2 < end && c[1] == 't' && isBlank(c[2])) {
+				glm::vec2 t;
+				c = parseFloat(skipBlanks(c + 3, end), end, t.x);
+				c = parseFloat(skipBlanks(c, end), end, t.y);
+				chunk.TexCoords.push_back(t);
+			}
+			else if (c[0] == 'v' && c + 2 < end && c[1] == 'n' && isBlank(c[2])) {
+				glm::vec3 n;
+				c = parseFloat(skipBlanks(c + 3, end), end, n.x);
+				c = parseFloat(skipBlanks(c, end), end, n.y);
+				c = parseFloat(skipBlanks(c, end), end, n.z);
+				chunk.Normals.push_back(n);
+			}
+			else if (c[0] == 'f' && c + 1 < end && isBlank(c[1])) {
+				// Triangulate the polygon as a fan while reading it
+				ParsedCorner first, previous, current;
+				unsigned int count = 0;
+				c = skipBlanks(c + 2, end);
+				while (c < end && *c != '\n' && *c != '\r') {
+					c = parseCorner(c, end, chunk, current);
+					c = skipBlanks(c, end);
+					if (count >= 2) {
+						emitCorner(chunk, first);
+						emitCorner(chunk, previous);
+						emitCorner(chunk, current);
+					}
+					else if (count == 0) {
+						first = current;
+					}
+					previous = current;
+					count++;
+				}
+			}
+			c = skipLine(c, end);
+		}
+	}
+	// Runs body(i) for i in [0, count) with one std::thread per index
+	template <typename Body>
+	inline void runParallel(unsigned int count, const Body& body)
+	{
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < count; i++)
+			threads.push_back(std::thread(body, i));
+		body(0);
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+	}
+
+	inline uint64_t hashKey(const ObjVertexKey& key)
+	{
+		uint64_t hash = (uint64_t)(uint32_t) key.Position * 0x9E3779B97F4A7C15ull;
+		hash ^= (uint64_t)(uint32_t) key.TexCoord * 0xC2B2AE3D27D4EB4Full;
+		hash ^= (uint64_t)(uint32_t) key.Normal * 0x165667B19E3779F9ull;
+		return hash ^ (hash >> 29);
+	}
+
+	inline uint32_t shardOf(const ObjVertexKey& key, unsigned int shardCount)
+	{
+		return (uint32_t)((hashKey(key) >> 40) % shardCount);
+	}
+
+	// Open addressing (linear probing) map from vertex key to welded vertex number.
+	// Much cheaper than std::unordered_map for the tens of millions of lookups a big file needs.
+	class WeldTable
+	{
+	public:
+		WeldTable() : mask(0), count(0)
+		{
+		}
+
+		void Reserve(size_t expected)
+		{
+			size_t capacity = 16;
+			while (capacity < expected * 2)
+				capacity *= 2;
+			if (capacity > slots.size())
+				rehash(capacity);
+		}
+
+		// Returns the number stored for key, inserting nextValue if the key is new
+		uint32_t Insert(const ObjVertexKey& key, uint32_t nextValue, bool& inserted)
+		{
+			if ((count + 1) * 2 > slots.size())
+				rehash(slots.empty() ? 16 : slots.size() * 2);
+
+			size_t slot = (size_t) hashKey(key) & mask;
+			while (values[slot] != UINT32_MAX) {
+				if (slots[slot] == key) {
+					inserted = false;
+					return values[slot];
+				}
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = key;
+			values[slot] = nextValue;
+			count++;
+			inserted = true;
+			return nextValue;
+		}
+
+	private:
+		std::vector<ObjVertexKey> slots;
+		std::vector<uint32_t> values;
+		size_t mask;
+		size_t count;
+
+		void rehash(size_t capacity)
+		{
+			std::vector<ObjVertexKey> oldSlots;
+			std::vector<uint32_t> oldValues;
+			oldSlots.swap(slots);
+			oldValues.swap(values);
+
+			slots.resize(capacity);
+			values.assign(capacity, UINT32_MAX);
+			mask = capacity - 1;
+			for (size_t i = 0; i < oldSlots.size(); i++) {
+				if (oldValues[i] == UINT32_MAX)
+					continue;
+				size_t slot = (size_t) hashKey(oldSlots[i]) & mask;
+				while (values[slot] != UINT32_MAX)
+					slot = (slot + 1) & mask;
+				slots[slot] = oldSlots[i];
+				values[slot] = oldValues[i];
+			}
+		}
+	};
+
+	inline double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Parses an in-memory OBJ file. See ImportObj.
+	inline bool importFromMemory(const char* data, size_t size, MeshData& mesh, unsigned int threadCount, ObjImportStats* stats)
+	{
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		if (threadCount == 0)
+			threadCount = 1;
+		// Chunks much smaller than this aren't worth a thread
+		const size_t MIN_CHUNK_BYTES = 1 << 20;
+		if (size / threadCount < MIN_CHUNK_BYTES)
+			threadCount = (unsigned int)(size / MIN_CHUNK_BYTES) + 1;
+
+		// 1. Split at line boundaries
+		std::vector<Chunk> chunks(threadCount);
+		const char* end = data + size;
+		const char* begin = data;
+		for (unsigned int i = 0; i < threadCount; i++) {
+			const char* chunkEnd = i + 1 == threadCount ? end : data + size / threadCount * (i + 1);
+			if (chunkEnd < begin)
+				chunkEnd = begin;
+			if (chunkEnd < end)
+				chunkEnd = skipLine(chunkEnd, end);
+			chunks[i].Begin = begin;
+			chunks[i].End = chunkEnd;
+			begin = chunkEnd;
+		}
+
+		// 2. Parse every chunk into private pools
+		runParallel(threadCount, [&](unsigned int i) {
+			parseChunk(chunks[i]);
+		});
+		double parseTime = millisecondsSince(start);
+
+		// 3. Concatenate the pools and turn chunk relative indices into absolute ones
+		size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+		for (unsigned int i = 0; i < threadCount; i++) {
+			chunks[i].PositionBase = positionCount;
+			chunks[i].TexCoordBase = texCoordCount;
+			chunks[i].NormalBase = normalCount;
+			chunks[i].CornerBase = cornerCount;
+			positionCount += chunks[i].Positions.size();
+			texCoordCount += chunks[i].TexCoords.size();
+			normalCount += chunks[i].Normals.size();
+			cornerCount += chunks[i].Corners.size();
+		}
+		if (positionCount > INT_MAX || texCoordCount > INT_MAX || normalCount > INT_MAX || cornerCount > UINT_MAX) {
+			std::cout << "ERROR::OBJ::MESH_TOO_LARGE" << std::endl;
+			return false;
+		}
+
+		std::vector<glm::vec3> positions(positionCount);
+		std::vector<glm::vec2> texCoords(texCoordCount);
+		std::vector<glm::vec3> normals(normalCount);
+		std::vector<ObjVertexKey> corners(cornerCount);
+		runParallel(threadCount, [&](unsigned int i) {
+			Chunk& chunk = chunks[i];
+			if (!chunk.Positions.empty())
+				memcpy(&positions[chunk.PositionBase], &chunk.Positions[0], chunk.Positions.size() * sizeof(glm::vec3));
+			if (!chunk.TexCoords.empty())
+				memcpy(&texCoords[chunk.TexCoordBase], &chunk.TexCoords[0], chunk.TexCoords.size() * sizeof(glm::vec2));
+			if (!chunk.Normals.empty())
+				memcpy(&normals[chunk.NormalBase], &chunk.Normals[0], chunk.Normals.size() * sizeof(glm::vec3));
+
+			for (size_t f = 0; f < chunk.RelativeFixups.size(); f++) {
+				unsigned int slot = chunk.RelativeFixups[f];
+				ObjVertexKey& key = chunk.Corners[slot / 3];
+				if (slot % 3 == 0)
+					key.Position += (int) chunk.PositionBase;
+				else if (slot % 3 == 1)
+					key.TexCoord += (int) chunk.TexCoordBase;
+				else
+					key.Normal += (int) chunk.NormalBase;
+			}
+
+			// Triangles referencing a missing position are dropped, missing vt / vn become zero
+			for (size_t c = 0; c + 2 < chunk.Corners.size(); c += 3) {
+				ObjVertexKey* triangle = &chunk.Corners[c];
+				bool valid = IsObjTriangleValid(triangle, positionCount);
+				for (int k = 0; k < 3; k++) {
+					if (!valid)
+						triangle[k].Position = -1;
+					if (triangle[k].TexCoord < 0 || triangle[k].TexCoord >= (int) texCoordCount)
+						triangle[k].TexCoord = -1;
+					if (triangle[k].Normal < 0 || triangle[k].Normal >= (int) normalCount)
+						triangle[k].Normal = -1;
+				}
+			}
+
+			if (!chunk.Corners.empty())
+				memcpy(&corners[chunk.CornerBase], &chunk.Corners[0], chunk.Corners.size() * sizeof(ObjVertexKey));
+			std::vector<glm::vec3>().swap(chunk.Positions);
+			std::vector<glm::vec2>().swap(chunk.TexCoords);
+			std::vector<glm::vec3>().swap(chunk.Normals);
+			std::vector<ObjVertexKey>().swap(chunk.Corners);
+		});
+		double mergeTime = millisecondsSince(start) - parseTime;
+
+		// 4. Weld. Every shard owns the keys hashing to it, so shards are welded independently.
+		// Corners are first bucketed by shard per range, which keeps them in file order.
+		unsigned int shardCount = threadCount;
+		std::vector<uint32_t> cornerShard(cornerCount);
+		std::vector<uint32_t> cornerLocal(cornerCount);
+		std::vector<unsigned char> firstUse(cornerCount, 0);
+		std::vector<std::vector<std::vector<uint32_t> > > buckets(threadCount, std::vector<std::vector<uint32_t> >(shardCount));
+		std::vector<std::vector<ObjVertexKey> > shardKeys(shardCount);
+
+		runParallel(threadCount, [&](unsigned int i) {
+			size_t first = cornerCount * i / threadCount;
+			size_t last = cornerCount * (i + 1) / threadCount;
+			for (size_t c = first; c < last; c++) {
+				if (corners[c].Position < 0) {
+					cornerShard[c] = UINT32_MAX;
+					continue;
+				}
+				uint32_t shard = shardOf(corners[c], shardCount);
+				cornerShard[c] = shard;
+				buckets[i][shard].push_back((uint32_t) c);
+			}
+		});
+
+		runParallel(shardCount, [&](unsigned int shard) {
+			// Closed meshes average around six corners per unique vertex
+			WeldTable welded;
+			welded.Reserve(cornerCount / shardCount / 6 + 16);
+			std::vector<ObjVertexKey>& keys = shardKeys[shard];
+			for (unsigned int i = 0; i < threadCount; i++) {
+				const std::vector<uint32_t>& bucket = buckets[i][shard];
+				for (size_t b = 0; b < bucket.size(); b++) {
+					uint32_t c = bucket[b];
+					bool inserted;
+					cornerLocal[c] = welded.Insert(corners[c], (uint32_t) keys.size(), inserted);
+					if (inserted) {
+						keys.push_back(corners[c]);
+						firstUse[c] = 1;
+					}
+				}
+			}
+		});
+		std::vector<std::vector<std::vector<uint32_t> > >().swap(buckets);
+
+		std::vector<size_t> shardBase(shardCount + 1, 0);
+		for (unsigned int shard = 0; shard < shardCount; shard++)
+			shardBase[shard + 1] = shardBase[shard] + shardKeys[shard].size();
+		size_t vertexCount = shardBase[shardCount];
+
+		// Number the vertices in order of first use, which is what LoadObj produces and keeps
+		// vertex fetches roughly in index order. A prefix sum over the ranges gives every range
+		// its first vertex number and first output index.
+		std::vector<size_t> rangeVertices(threadCount + 1, 0);
+		std::vector<size_t> rangeIndices(threadCount + 1, 0);
+		runParallel(threadCount, [&](unsigned int i) {
+			size_t first = cornerCount * i / threadCount;
+			size_t last = cornerCount * (i + 1) / threadCount;
+			for (size_t c = first; c < last; c++) {
+				rangeVertices[i + 1] += firstUse[c];
+				rangeIndices[i + 1] += cornerShard[c] != UINT32_MAX ? 1 : 0;
+			}
+		});
+		for (unsigned int i = 0; i < threadCount; i++) {
+			rangeVertices[i + 1] += rangeVertices[i];
+			rangeIndices[i + 1] += rangeIndices[i];
+		}
+
+		std::vector<uint32_t> remap(vertexCount);
+		std::vector<ObjVertexKey> uniqueKeys(vertexCount);
+		runParallel(threadCount, [&](unsigned int i) {
+			size_t first = cornerCount * i / threadCount;
+			size_t last = cornerCount * (i + 1) / threadCount;
+			uint32_t vertex = (uint32_t) rangeVertices[i];
+			for (size_t c = first; c < last; c++) {
+				if (!firstUse[c])
+					continue;
+				remap[shardBase[cornerShard[c]] + cornerLocal[c]] = vertex;
+				uniqueKeys[vertex] = corners[c];
+				vertex++;
+			}
+		});
+
+		mesh.Indices.resize(rangeIndices[threadCount]);
+		runParallel(threadCount, [&](unsigned int i) {
+			size_t first = cornerCount * i / threadCount;
+			size_t last = cornerCount * (i + 1) / threadCount;
+			size_t index = rangeIndices[i];
+			for (size_t c = first; c < last; c++)
+				if (cornerShard[c] != UINT32_MAX)
+					mesh.Indices[index++] = remap[shardBase[cornerShard[c]] + cornerLocal[c]];
+		});
+
+		// 5. Write the interleaved vertices
+		bool hasNormals = normalCount > 0;
+		SetObjMeshLayout(mesh, hasNormals);
+		unsigned int floatsPerVertex = mesh.VertexStride / sizeof(float);
+		mesh.VertexCount = (unsigned int) vertexCount;
+		mesh.Vertices.resize(vertexCount * mesh.VertexStride);
+		runParallel(threadCount, [&](unsigned int i) {
+			size_t first = vertexCount * i / threadCount;
+			size_t last = vertexCount * (i + 1) / threadCount;
+			float* out = (float*)(mesh.Vertices.empty() ? nullptr : &mesh.Vertices[0]);
+			for (size_t v = first; v < last; v++)
+				WriteObjVertex(out + v * floatsPerVertex, uniqueKeys[v], positions, texCoords, normals, hasNormals);
+		});
+		mesh.ComputeBounds();
+		double weldTime = millisecondsSince(start) - parseTime - mergeTime;
+
+		if (stats != nullptr) {
+			stats->FileBytes = size;
+			stats->Threads = threadCount;
+			stats->ParseMilliseconds = parseTime;
+			stats->MergeMilliseconds = mergeTime;
+			stats->WeldMilliseconds = weldTime;
+			stats->TotalMilliseconds = millisecondsSince(start);
+		}
+		return true;
+	}
+}
+
+// Memory maps and imports an OBJ file using threadCount threads (0 = one per hardware thread)
+inline bool ImportObj(const char* path, MeshData& mesh, unsigned int threadCount = 0, ObjImportStats* stats = nullptr)
+{
+	MappedFile file;
+	if (!file.Open(path)) {
+		std::cout << "ERROR::OBJ::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+		return false;
+	}
+	return ObjImport::importFromMemory((const char*) file.Data(), file.Size(), mesh, threadCount, stats);
+}
+#endif
@@ -0,0 +1,259 @@
+#pragma once
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mesh.h"
+
+// One corner of an OBJ face: 0-based indices into the v / vt / vn pools, -1 if absent
+struct ObjVertexKey
+{
+	int Position;
+	int TexCoord;
+	int Normal;
+
+	bool operator==(const ObjVertexKey& other) const
+	{
+		return Position == other.Position && TexCoord == other.TexCoord && Normal == other.Normal;
+	}
+};
+
+struct ObjVertexKeyHash
+{
+	size_t operator()(const ObjVertexKey& key) const
+	{
+		size_t hash = (size_t)(unsigned int) key.Position * 73856093u;
+		hash ^= (size_t)(unsigned int) key.TexCoord * 19349663u;
+		hash ^= (size_t)(unsigned int) key.Normal * 83492791u;
+		return hash;
+	}
+};
+
+// Builds the attribute layout used for OBJ meshes. It matches the demos: position at
+// location 0 and texture coordinates at location 1 (5 floats, as in HelloCamera.cpp),
+// with the normal appended at location 2 when the file has any.
+inline void SetObjMeshLayout(MeshData& mesh, bool hasNormals)
+{
+	mesh.Attributes.clear();
+	MeshAttribute position = { ATTRIBUTE_POSITION, 3, GL_FLOAT, GL_FALSE, 0 };
+	MeshAttribute texCoord = { ATTRIBUTE_TEXCOORD, 2, GL_FLOAT, GL_FALSE, 3 * sizeof(float) };
+	mesh.Attributes.push_back(position);
+	mesh.Attributes.push_back(texCoord);
+	if (hasNormals) {
+		MeshAttribute normal = { ATTRIBUTE_NORMAL, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float) };
+		mesh.Attributes.push_back(normal);
+	}
+	mesh.VertexStride = (hasNormals ? 8 : 5) * sizeof(float);
+}
+
+// Writes one welded vertex in the layout produced by SetObjMeshLayout
+inline void WriteObjVertex(float* out, const ObjVertexKey& key, const std::vector<glm::vec3>& positions, const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals, bool hasNormals)
+{
+	glm::vec3 p = key.Position >= 0 ? positions[key.Position] : glm::vec3(0.0f);
+	glm::vec2 t = key.TexCoord >= 0 ? texCoords[key.TexCoord] : glm::vec2(0.0f);
+	out[0] = p.x; out[1] = p.y; out[2] = p.z;
+	out[3] = t.x; out[4] = t.y;
+	if (hasNormals) {
+		glm::vec3 n = key.Normal >= 0 ? normals[key.Normal] : glm::vec3(0.0f);
+		out[5] = n.x; out[6] = n.y; out[7] = n.z;
+	}
+}
+
+// Converts a 1-based (or negative, relative) OBJ index to a 0-based one
+inline int ResolveObjIndex(long index, size_t poolSize)
+{
+	if (index > 0)
+		return (int)(index - 1);
+	if (index < 0)
+		return (int)((long) poolSize + index);
+	return -1;
+}
+
+// True if all three corners of a triangle reference an existing position
+inline bool IsObjTriangleValid(const ObjVertexKey* corners, size_t positionCount)
+{
+	for (int i = 0; i < 3; i++)
+		if (corners[i].Position < 0 || corners[i].Position >= (int) positionCount)
+			return false;
+	return true;
+}
+
+// Straightforward std::istream based Wavefront OBJ loader. Handles v / vt / vn and
+// polygonal faces (triangulated as fans); everything else is ignored.
+inline bool LoadObj(const char* path, MeshData& mesh)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "ERROR::OBJ::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+		return false;
+	}
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> texCoords;
+	std::vector<glm::vec3> normals;
+	std::vector<ObjVertexKey> corners;
+	std::vector<ObjVertexKey> face;
+
+	std::string line;
+	std::string token;
+	while (std::getline(file, line)) {
+		std::istringstream stream(line);
+		if (!(stream >> token))
+			continue;
+
+		if (token == "v") {
+			glm::vec3 p;
+			stream >> p.x >> p.y >> p.z;
+			positions.push_back(p);
+		}
+		else if (token == "vt") {
+			glm::vec2 t;
+			stream >> t.x >> t.y;
+			texCoords.push_back(t);
+		}
+		else if (token == "vn") {
+			glm::vec3 n;
+			stream >> n.x >> n.y >> n.z;
+			normals.push_back(n);
+		}
+		else if (token == "f") {
+			face.clear();
+			std::string corner;
+			while (stream >> corner) {
+				// v, v/vt, v//vn or v/vt/vn
+				ObjVertexKey key = { -1, -1, -1 };
+				const char* c = corner.c_str();
+				char* end;
+				key.Position = ResolveObjIndex(strtol(c, &end, 10), positions.size());
+				if (*end == '/') {
+					c = end + 1;
+					if (*c != '/')
+						key.TexCoord = ResolveObjIndex(strtol(c, &end, 10), texCoords.size());
+					else
+						end = (char*) c;
+					if (*end == '/')
+						key.Normal = ResolveObjIndex(strtol(end + 1, &end, 10), normals.size());
+				}
+				face.push_back(key);
+			}
+			for (size_t i = 2; i < face.size(); i++) {
+				corners.push_back(face[0]);
+				corners.push_back(face[i - 1]);
+				corners.push_back(face[i]);
+			}
+		}
+	}
+
+	// Weld identical v/vt/vn triples into one indexed vertex
+	bool hasNormals = !normals.empty();
+	SetObjMeshLayout(mesh, hasNormals);
+	unsigned int floatsPerVertex = mesh.VertexStride / sizeof(float);
+
+	std::unordered_map<ObjVertexKey, unsigned int, ObjVertexKeyHash> welded;
+	std::vector<float> vertices;
+	mesh.Indices.clear();
+	mesh.Indices.reserve(corners.size());
+	for (size_t i = 0; i < corners.size(); i++) {
+		// Drop whole triangles that reference a missing position
+		if (i % 3 == 0 && !IsObjTriangleValid(&corners[i], positions.size())) {
+			i += 2;
+			continue;
+		}
+
+		ObjVertexKey key = corners[i];
+		if (key.TexCoord >= (int) texCoords.size())
+			key.TexCoord = -1;
+		if (key.Normal >= (int) normals.size())
+			key.Normal = -1;
+
+		std::unordered_map<ObjVertexKey, unsigned int, ObjVertexKeyHash>::iterator found = welded.find(key);
+		if (found != welded.end()) {
+			mesh.Indices.push_back(found->second);
+			continue;
+		}
+
+		unsigned int index = (unsigned int)(vertices.size() / floatsPerVertex);
+		vertices.resize(vertices.size() + floatsPerVertex);
+		WriteObjVertex(&vertices[index * floatsPerVertex], key, positions, texCoords, normals, hasNormals);
+		welded[key] = index;
+		mesh.Indices.push_back(index);
+	}
+
+	mesh.VertexCount = (unsigned int)(vertices.size() / floatsPerVertex);
+	mesh.Vertices.resize(vertices.size() * sizeof(float));
+	if (!vertices.empty())
+		memcpy(&mesh.Vertices[0], &vertices[0], mesh.Vertices.size());
+	mesh.ComputeBounds();
+	return true;
+}
+
+// Writes a float position / texcoord / normal mesh back out as Wavefront OBJ text
+inline bool SaveObj(const char* path, const MeshData& mesh)
+{
+	const MeshAttribute* position = mesh.FindAttribute(ATTRIBUTE_POSITION);
+	const MeshAttribute* texCoord = mesh.FindAttribute(ATTRIBUTE_TEXCOORD);
+	const MeshAttribute* normal = mesh.FindAttribute(ATTRIBUTE_NORMAL);
+	if (position == nullptr || position->Type != GL_FLOAT) {
+		std::cout << "ERROR::OBJ::UNSUPPORTED_LAYOUT" << std::endl;
+		return false;
+	}
+	if (texCoord != nullptr && texCoord->Type != GL_FLOAT)
+		texCoord = nullptr;
+	if (normal != nullptr && normal->Type != GL_FLOAT)
+		normal = nullptr;
+
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		std::cout << "ERROR::OBJ::FILE_NOT_SUCCESFULLY_OPENED: " << path << std::endl;
+		return false;
+	}
+
+	char line[128];
+	for (unsigned int i = 0; i < mesh.VertexCount; i++) {
+		const unsigned char* vertex = &mesh.Vertices[i * mesh.VertexStride];
+		const float* p = (const float*)(vertex + position->Offset);
+		snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", p[0], p[1], p[2]);
+		file << line;
+		if (texCoord != nullptr) {
+			const float* t = (const float*)(vertex + texCoord->Offset);
+			snprintf(line, sizeof(line), "vt %.6f %.6f\n", t[0], t[1]);
+			file << line;
+		}
+		if (normal != nullptr) {
+			const float* n = (const float*)(vertex + normal->Offset);
+			snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", n[0], n[1], n[2]);
+			file << line;
+		}
+	}
+
+	// Every vertex wrote one entry to each pool, so the same index addresses all three
+	for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+		file << "f";
+		for (int corner = 0; corner < 3; corner++) {
+			unsigned int index = mesh.Indices[i + corner] + 1;
+			if (texCoord != nullptr && normal != nullptr)
+				snprintf(line, sizeof(line), " %u/%u/%u", index, index, index);
+			else if (texCoord != nullptr)
+				snprintf(line, sizeof(line), " %u/%u", index, index);
+			else if (normal != nullptr)
+				snprintf(line, sizeof(line), " %u//%u", index, index);
+			else
+				snprintf(line, sizeof(line), " %u", index);
+			file << line;
+		}
+		file << "\n";
+	}
+
+	return (bool) file;
+}
+#endif
@@ -0,0 +1,314 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "affine.h"
+#include "mesh.h"
+
+// Draws are recorded in any order as a 64 bit sort key plus the index of their payload, sorted
+// once per frame with a radix sort and then issued in key order through a backend that skips
+// state changes that are already in effect.
+//
+// Key layout, most significant bits first:
+//
+//   opaque layers       layer:4 | program:10 | texture set:12 | vertex array:14 | depth:24
+//   RENDER_LAYER_TRANSLUCENT  layer:4 | far to near depth:24 | program:10 | texture set:12 | vertex array:14
+//
+// so opaque draws are grouped by the most expensive state first and go front to back inside
+// each group (early-z rejects what is hidden), while translucent draws go back to front for
+// correct blending whatever state that costs.
+
+const unsigned int RENDER_QUEUE_TEXTURE_UNITS = 4;	// Textures per texture set
+
+enum Render_Layer {
+	RENDER_LAYER_OPAQUE,
+	RENDER_LAYER_SKY,
+	RENDER_LAYER_TRANSLUCENT,
+	RENDER_LAYER_OVERLAY
+};
+
+// Bit widths of the key fields
+const unsigned int SORT_KEY_LAYER_BITS = 4;
+const unsigned int SORT_KEY_PROGRAM_BITS = 10;
+const unsigned int SORT_KEY_TEXTURE_BITS = 12;
+const unsigned int SORT_KEY_VERTEX_ARRAY_BITS = 14;
+const unsigned int SORT_KEY_DEPTH_BITS = 24;
+
+// Depth as a 24 bit integer with the same order: non-negative floats sort like their bit
+// patterns, so the top 24 bits keep the order of any view distance without knowing the range
+inline uint64_t QuantizeSortDepth(float depth)
+{
+	if (!(depth > 0.0f))
+		return 0;
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - SORT_KEY_DEPTH_BITS);
+}
+
+inline uint64_t MakeSortKey(Render_Layer layer, unsigned int program, unsigned int textureSet, unsigned int vertexArray, float depth)
+{
+	uint64_t state = ((uint64_t) program << (SORT_KEY_TEXTURE_BITS + SORT_KEY_VERTEX_ARRAY_BITS)) | ((uint64_t) textureSet << SORT_KEY_VERTEX_ARRAY_BITS) | vertexArray;
+	uint64_t quantized = QuantizeSortDepth(depth);
+	uint64_t key = (uint64_t) layer << (64 - SORT_KEY_LAYER_BITS);
+	if (layer == RENDER_LAYER_TRANSLUCENT) {
+		uint64_t farToNear = ((1ull << SORT_KEY_DEPTH_BITS) - 1) - quantized;
+		return key | (farToNear << (64 - SORT_KEY_LAYER_BITS - SORT_KEY_DEPTH_BITS)) | state;
+	}
+	return key | (state << SORT_KEY_DEPTH_BITS) | quantized;
+}
+
+// Everything needed to issue one draw after its state is bound
+struct RenderItem
+{
+	GLenum Mode;
+	GLint First;	// First vertex, or first index when IndexType is set
+	GLsizei Count;
+	GLenum IndexType;	// 0 for glDrawArrays
+	GLint BaseVertex;
+	GLsizei InstanceCount;
+	Affine Model;	// Uploaded to the program's "model" uniform (a mat3x4), if it has one
+};
+
+struct RenderQueueStats
+{
+	unsigned int Draws;
+	unsigned int ProgramChanges;
+	unsigned int TextureChanges;
+	unsigned int VertexArrayChanges;
+};
+
+// Remembers the bound program, vertex array and textures and only calls GL when they change.
+// Anything binding state behind its back has to call Invalidate.
+class GLStateCache
+{
+public:
+	GLStateCache()
+	{
+		Invalidate();
+	}
+
+	void Invalidate()
+	{
+		program = vertexArray = INVALID;
+		activeUnit = INVALID;
+		for (unsigned int i = 0; i < RENDER_QUEUE_TEXTURE_UNITS; i++)
+			textures[i] = INVALID;
+	}
+
+	// Each returns true if it actually changed something
+	bool UseProgram(GLuint newProgram)
+	{
+		if (newProgram == program)
+			return false;
+		glUseProgram(newProgram);
+		program = newProgram;
+		return true;
+	}
+
+	bool BindVertexArray(GLuint newVertexArray)
+	{
+		if (newVertexArray == vertexArray)
+			return false;
+		glBindVertexArray(newVertexArray);
+		vertexArray = newVertexArray;
+		return true;
+	}
+
+	bool BindTexture(unsigned int unit, GLuint texture)
+	{
+		if (textures[unit] == texture)
+			return false;
+		if (activeUnit != unit) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			activeUnit = unit;
+		}
+		glBindTexture(GL_TEXTURE_2D, texture);
+		textures[unit] = texture;
+		return true;
+	}
+
+private:
+	static const GLuint INVALID = 0xFFFFFFFFu;
+
+	GLuint program;
+	GLuint vertexArray;
+	GLuint activeUnit;
+	GLuint textures[RENDER_QUEUE_TEXTURE_UNITS];
+};
+
+class RenderQueue
+{
+public:
+	// Programs, texture sets and vertex arrays are registered once and referred to by the small
+	// ids these return, which is what fits in the key
+	unsigned int AddProgram(GLuint program)
+	{
+		ProgramEntry entry = { program, glGetUniformLocation(program, "model") };
+		programs.push_back(entry);
+		return (unsigned int) programs.size() - 1;
+	}
+
+	unsigned int AddTextureSet(const GLuint* textures, unsigned int count)
+	{
+		TextureSet set;
+		set.Count = glm::min(count, RENDER_QUEUE_TEXTURE_UNITS);
+		for (unsigned int i = 0; i < set.Count; i++)
+			set.Textures[i] = textures[i];
+		textureSets.push_back(set);
+		return (unsigned int) textureSets.size() - 1;
+	}
+
+	unsigned int AddVertexArray(GLuint vertexArray)
+	{
+		vertexArrays.push_back(vertexArray);
+		return (unsigned int) vertexArrays.size() - 1;
+	}
+
+	void Begin()
+	{
+		keys.clear();
+		indices.clear();
+		items.clear();
+	}
+
+	// Records a draw. depth is the distance from the camera (any non-negative scale).
+	void Add(Render_Layer layer, unsigned int program, unsigned int textureSet, unsigned int vertexArray, float depth, const RenderItem& item)
+	{
+		keys.push_back(MakeSortKey(layer, program, textureSet, vertexArray, depth));
+		indices.push_back((uint32_t) items.size());
+		Entry entry = { item, program, textureSet, vertexArray };
+		items.push_back(entry);
+	}
+
+	unsigned int GetCount() const
+	{
+		return (unsigned int) keys.size();
+	}
+
+	// Least significant digit radix sort of the keys (and their payload indices), 8 bits per
+	// pass. Passes where every key has the same digit, which is most of them when few states are
+	// in use, are skipped after the single counting sweep.
+	void Sort()
+	{
+		SortKeys(keys, indices, sortedKeys, sortedIndices);
+	}
+
+	// Issues the draws in key order. Returns how many state changes that took.
+	RenderQueueStats Execute(GLStateCache& state) const
+	{
+		RenderQueueStats stats = { 0, 0, 0, 0 };
+		for (size_t i = 0; i < indices.size(); i++) {
+			const Entry& entry = items[indices[i]];
+			const RenderItem& item = entry.Item;
+			const ProgramEntry& program = programs[entry.Program];
+			const TextureSet& textureSet = textureSets[entry.TextureSet];
+
+			if (state.UseProgram(program.Program))
+				stats.ProgramChanges++;
+			bool texturesChanged = false;
+			for (unsigned int unit = 0; unit < textureSet.Count; unit++)
+				texturesChanged |= state.BindTexture(unit, textureSet.Textures[unit]);
+			if (texturesChanged)
+				stats.TextureChanges++;
+			if (state.BindVertexArray(vertexArrays[entry.VertexArray]))
+				stats.VertexArrayChanges++;
+
+			if (program.ModelLocation >= 0)
+				glUniformMatrix3x4fv(program.ModelLocation, 1, GL_FALSE, &item.Model.Rows[0][0]);
+			if (item.IndexType == 0)
+				glDrawArraysInstanced(item.Mode, item.First, item.Count, item.InstanceCount);
+			else
+				glDrawElementsInstancedBaseVertex(item.Mode, item.Count, item.IndexType, (const void*)((size_t) item.First * IndexTypeSize(item.IndexType)), item.InstanceCount, item.BaseVertex);
+			stats.Draws++;
+		}
+		return stats;
+	}
+
+	// The radix sort on its own, for any key / index arrays. scratch arrays are resized as needed.
+	static void SortKeys(std::vector<uint64_t>& keys, std::vector<uint32_t>& indices, std::vector<uint64_t>& scratchKeys, std::vector<uint32_t>& scratchIndices)
+	{
+		size_t count = keys.size();
+		if (count < 2)
+			return;
+		scratchKeys.resize(count);
+		scratchIndices.resize(count);
+
+		// One sweep counts the digits of all eight passes
+		uint32_t histograms[8][256];
+		memset(histograms, 0, sizeof(histograms));
+		for (size_t i = 0; i < count; i++)
+			for (int pass = 0; pass < 8; pass++)
+				histograms[pass][(keys[i] >> (pass * 8)) & 0xFF]++;
+
+		uint64_t* sourceKeys = &keys[0];
+		uint32_t* sourceIndices = &indices[0];
+		uint64_t* targetKeys = &scratchKeys[0];
+		uint32_t* targetIndices = &scratchIndices[0];
+		for (int pass = 0; pass < 8; pass++) {
+			uint32_t* histogram = histograms[pass];
+			if (histogram[(sourceKeys[0] >> (pass * 8)) & 0xFF] == count)
+				continue;
+
+			uint32_t offsets[256];
+			uint32_t sum = 0;
+			for (int digit = 0; digit < 256; digit++) {
+				offsets[digit] = sum;
+				sum += histogram[digit];
+			}
+			for (size_t i = 0; i < count; i++) {
+				uint32_t position = offsets[(sourceKeys[i] >> (pass * 8)) & 0xFF]++;
+				targetKeys[position] = sourceKeys[i];
+				targetIndices[position] = sourceIndices[i];
+			}
+			std::swap(sourceKeys, targetKeys);
+			std::swap(sourceIndices, targetIndices);
+		}
+
+		// An odd number of passes left the result in the scratch arrays
+		if (sourceKeys != &keys[0]) {
+			keys.swap(scratchKeys);
+			indices.swap(scratchIndices);
+		}
+	}
+
+private:
+	struct ProgramEntry
+	{
+		GLuint Program;
+		GLint ModelLocation;
+	};
+
+	struct TextureSet
+	{
+		GLuint Textures[RENDER_QUEUE_TEXTURE_UNITS];
+		unsigned int Count;
+	};
+
+	// The item with the ids its key was made from, since translucent keys order them differently
+	struct Entry
+	{
+		RenderItem Item;
+		unsigned int Program;
+		unsigned int TextureSet;
+		unsigned int VertexArray;
+	};
+
+	std::vector<ProgramEntry> programs;
+	std::vector<TextureSet> textureSets;
+	std::vector<GLuint> vertexArrays;
+
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> indices;
+	std::vector<uint64_t> sortedKeys;
+	std::vector<uint32_t> sortedIndices;
+	std::vector<Entry> items;
+};
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// Offscreen framebuffer with a color and a depth renderbuffer. Scenes are drawn into it and then
+// blitted to the window, which is how the demos get depth formats the default framebuffer can't
+// be asked for, like the 32 bit float depth reverse-Z needs.
+class RenderTarget
+{
+public:
+	unsigned int FBO;
+	unsigned int ColorBuffer;
+	unsigned int DepthBuffer;
+	int Width;
+	int Height;
+
+	RenderTarget() : FBO(0), ColorBuffer(0), DepthBuffer(0), Width(0), Height(0)
+	{
+	}
+
+	// (Re)creates the framebuffer at the given size. Returns false if the driver rejects the formats.
+	bool Create(int width, int height, GLenum colorFormat = GL_RGBA8, GLenum depthFormat = GL_DEPTH_COMPONENT32F)
+	{
+		Release();
+		Width = width;
+		Height = height;
+
+		glGenRenderbuffers(1, &ColorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, ColorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, colorFormat, width, height);
+
+		glGenRenderbuffers(1, &DepthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, DepthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glGenFramebuffers(1, &FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthBuffer);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		if (status != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::RENDER_TARGET::INCOMPLETE: status 0x" << std::hex << status << std::dec << std::endl;
+			Release();
+			return false;
+		}
+		return true;
+	}
+
+	// Binds the framebuffer for drawing and sets the viewport to cover it
+	void Bind() const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glViewport(0, 0, Width, Height);
+	}
+
+	// Copies the color buffer to the window, scaled to screenWidth x screenHeight, and leaves the
+	// window framebuffer bound
+	void BlitToScreen(int screenWidth, int screenHeight) const
+	{
+		BlitToScreen(screenWidth, screenHeight, Width, Height);
+	}
+
+	// Same for only the lower left sourceWidth x sourceHeight pixels, when the scene was rendered
+	// to part of the buffer
+	void BlitToScreen(int screenWidth, int screenHeight, int sourceWidth, int sourceHeight) const
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		GLenum filter = (screenWidth == sourceWidth && screenHeight == sourceHeight) ? GL_NEAREST : GL_LINEAR;
+		glBlitFramebuffer(0, 0, sourceWidth, sourceHeight, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, filter);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	void Release()
+	{
+		if (FBO != 0)
+			glDeleteFramebuffers(1, &FBO);
+		if (ColorBuffer != 0)
+			glDeleteRenderbuffers(1, &ColorBuffer);
+		if (DepthBuffer != 0)
+			glDeleteRenderbuffers(1, &DepthBuffer);
+		FBO = ColorBuffer = DepthBuffer = 0;
+		Width = Height = 0;
+	}
+};
+#endif
@@ -0,0 +1,372 @@
+#pragma once
+#ifndef SCENE_RUNNER_H
+#define SCENE_RUNNER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "headless.h"
+
+// Runs the Hello* scenes from one executable. Every scene registers its main function under its
+// name, and SceneRunner.cpp picks scenes from the command line and runs them one after another
+// in the same window and GL context, timing each of them.
+//
+// Scenes keep their own setup, loop and clean up. Three calls stand in for the GLFW calls that
+// would otherwise create and destroy a window per scene; on their own they do exactly what those
+// did, under the runner they hand out the shared window and count the frames:
+//
+//   GLFWwindow* window = CreateSceneWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL");   glfwCreateWindow
+//   while (SceneRunning(window)) { ... }                                             !glfwWindowShouldClose
+//   ReleaseScene();                                                                   glfwTerminate
+//
+// Scenes delete the GL objects they create. In between scenes the runner only unbinds everything,
+// resets the state scenes commonly change and removes their window callbacks.
+//
+// Headless, the shared window is hidden (and its context optionally comes from EGL), so scenes
+// run on machines without a display; HelloHeadless renders offscreen either way.
+
+typedef int (*SceneMain)();
+
+struct SceneEntry
+{
+	std::string Name;
+	SceneMain Main;
+};
+
+// All registered scenes, in the order they registered in (which follows the link order)
+inline std::vector<SceneEntry>& GetScenes()
+{
+	static std::vector<SceneEntry> scenes;
+	return scenes;
+}
+
+// A static instance next to a scene registers it before main runs
+struct SceneRegistrar
+{
+	SceneRegistrar(const char* name, SceneMain main)
+	{
+		SceneEntry entry = { name, main };
+		GetScenes().push_back(entry);
+	}
+};
+
+// The Benchmark* programs register the same way. They run on the CPU only, so the runner calls
+// them without creating a window (--benchmark).
+inline std::vector<SceneEntry>& GetBenchmarks()
+{
+	static std::vector<SceneEntry> benchmarks;
+	return benchmarks;
+}
+
+struct BenchmarkRegistrar
+{
+	BenchmarkRegistrar(const char* name, SceneMain main)
+	{
+		SceneEntry entry = { name, main };
+		GetBenchmarks().push_back(entry);
+	}
+};
+
+// Command line tools like MeshConverter get the arguments after --tool <name>, with the tool's
+// name in argv[0]
+typedef int (*ToolMain)(int argc, char** argv);
+
+struct ToolEntry
+{
+	std::string Name;
+	ToolMain Main;
+};
+
+inline std::vector<ToolEntry>& GetTools()
+{
+	static std::vector<ToolEntry> tools;
+	return tools;
+}
+
+struct ToolRegistrar
+{
+	ToolRegistrar(const char* name, ToolMain main)
+	{
+		ToolEntry entry = { name, main };
+		GetTools().push_back(entry);
+	}
+};
+
+// Ignores case. Returns NULL if there is no entry of that name.
+template <typename Entry>
+inline const Entry* FindEntry(const std::vector<Entry>& entries, const std::string& name)
+{
+	auto equal = [](char a, char b) { return std::tolower((unsigned char) a) == std::tolower((unsigned char) b); };
+	for (const Entry& entry : entries)
+		if (entry.Name.size() == name.size() && std::equal(name.begin(), name.end(), entry.Name.begin(), equal))
+			return &entry;
+	return NULL;
+}
+
+inline const SceneEntry* FindScene(const std::string& name)
+{
+	return FindEntry(GetScenes(), name);
+}
+
+struct SceneRunSettings
+{
+	int Width;	// All scenes render at this size
+	int Height;
+	unsigned int Frames;	// Per scene, 0 runs each scene until its window is closed
+	bool VSync;	// Off for timings, otherwise they measure the display
+	bool Headless;	// Hidden window, see CreateHeadlessContext
+	bool Egl;	// Headless context through EGL instead of the native API
+
+	SceneRunSettings() : Width(800), Height(600), Frames(0), VSync(true), Headless(false), Egl(false)
+	{
+	}
+};
+
+struct SceneTiming
+{
+	std::string Name;
+	int Result;	// What the scene's main returned
+	unsigned int Frames;
+	double SetupMilliseconds;	// From handing out the window to the first frame
+	double Seconds;	// All frames, up to the GPU finishing the last one
+	double FramesPerSecond;
+	double MeanFrameMilliseconds;
+	double PercentileFrameMilliseconds;	// 95th percentile
+	double MaxFrameMilliseconds;
+};
+
+class SceneRunner
+{
+public:
+	SceneRunSettings Settings;
+	GLFWwindow* Window;
+
+	SceneRunner() : Window(NULL), frames(0), started(false), finished(true)
+	{
+	}
+
+	bool Create(const SceneRunSettings& settings)
+	{
+		Release();
+		Settings = settings;
+
+		if (Settings.Headless) {
+			// Window sized scenes still get a default framebuffer of the full size
+			Window = CreateHeadlessContext(Settings.Egl, Settings.Width, Settings.Height);
+			if (Window == NULL) {
+				glfwTerminate();
+				return false;
+			}
+		}
+		else {
+			glfwInit();
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+			glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+			glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+			Window = glfwCreateWindow(Settings.Width, Settings.Height, "LearnOpenGL", NULL, NULL);
+			if (Window == NULL) {
+				std::cout << "Failed to create GLFW window" << std::endl;
+				glfwTerminate();
+				return false;
+			}
+			glfwMakeContextCurrent(Window);
+			if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+				std::cout << "Failed to initialize GLAD" << std::endl;
+				Release();
+				return false;
+			}
+		}
+		glfwSwapInterval(Settings.VSync ? 1 : 0);
+		active() = this;
+		return true;
+	}
+
+	// Runs the scene's main in the shared window and returns how long its frames took
+	SceneTiming Run(const SceneEntry& scene)
+	{
+		timing = SceneTiming();
+		timing.Name = scene.Name;
+		frameMilliseconds.clear();
+		frames = 0;
+		started = false;
+		finished = false;
+		sceneStart = Clock::now();
+
+		timing.Result = scene.Main();
+		// The scene stopped on its own, on an error or because its window was closed
+		if (!finished)
+			finish();
+
+		timing.Frames = frames;
+		if (!frameMilliseconds.empty()) {
+			double sum = 0.0;
+			for (double milliseconds : frameMilliseconds) {
+				sum += milliseconds;
+				timing.MaxFrameMilliseconds = std::max(timing.MaxFrameMilliseconds, milliseconds);
+			}
+			timing.MeanFrameMilliseconds = sum / frameMilliseconds.size();
+			std::vector<double>::iterator percentile = frameMilliseconds.begin() + (frameMilliseconds.size() - 1) * 95 / 100;
+			std::nth_element(frameMilliseconds.begin(), percentile, frameMilliseconds.end());
+			timing.PercentileFrameMilliseconds = *percentile;
+		}
+		timing.FramesPerSecond = timing.Seconds > 0.0 ? frames / timing.Seconds : 0.0;
+		return timing;
+	}
+
+	void Release()
+	{
+		if (active() == this)
+			active() = NULL;
+		if (Window != NULL) {
+			glfwTerminate();
+			Window = NULL;
+		}
+	}
+
+	// The runner scenes are running under, or NULL when a scene runs on its own
+	static SceneRunner* GetActive()
+	{
+		return active();
+	}
+
+	// Hands the window to the next scene in a clean state
+	GLFWwindow* BeginScene(const char* title)
+	{
+		glfwSetWindowUserPointer(Window, NULL);
+		glfwSetFramebufferSizeCallback(Window, NULL);
+		glfwSetKeyCallback(Window, NULL);
+		glfwSetCharCallback(Window, NULL);
+		glfwSetMouseButtonCallback(Window, NULL);
+		glfwSetCursorPosCallback(Window, NULL);
+		glfwSetScrollCallback(Window, NULL);
+		glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+		glfwSetWindowShouldClose(Window, false);
+		glfwSetWindowTitle(Window, title);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glUseProgram(0);
+		glActiveTexture(GL_TEXTURE0);
+		glDisable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		glClearDepth(1.0);
+		// A reverse-Z scene leaves zero to one depth behind
+		if (GLAD_GL_ARB_clip_control)
+			glClipControl(GL_LOWER_LEFT, GL_NEGATIVE_ONE_TO_ONE);
+		glDisable(GL_CULL_FACE);
+		glDisable(GL_BLEND);
+		glDisable(GL_SCISSOR_TEST);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glViewport(0, 0, Settings.Width, Settings.Height);
+
+		sceneStart = Clock::now();
+		return Window;
+	}
+
+	// Called before each frame. Returns false once the scene has rendered its frames or its
+	// window was asked to close.
+	bool NextFrame()
+	{
+		if (finished)
+			return false;
+		Clock::time_point now = Clock::now();
+		if (!started) {
+			timing.SetupMilliseconds = milliseconds(now - sceneStart);
+			firstFrame = now;
+			started = true;
+		}
+		else {
+			frameMilliseconds.push_back(milliseconds(now - lastFrame));
+			frames++;
+		}
+		lastFrame = now;
+
+		if ((Settings.Frames > 0 && frames >= Settings.Frames) || glfwWindowShouldClose(Window)) {
+			finish();
+			return false;
+		}
+		return true;
+	}
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	SceneTiming timing;
+	std::vector<double> frameMilliseconds;
+	unsigned int frames;
+	bool started;
+	bool finished;
+	Clock::time_point sceneStart;
+	Clock::time_point firstFrame;
+	Clock::time_point lastFrame;
+
+	static SceneRunner*& active()
+	{
+		static SceneRunner* runner = NULL;
+		return runner;
+	}
+
+	static double milliseconds(Clock::duration duration)
+	{
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+
+	// Waits for the GPU so the time covers all the frames' work, not just their submission
+	void finish()
+	{
+		glFinish();
+		if (started)
+			timing.Seconds = std::chrono::duration<double>(Clock::now() - firstFrame).count();
+		finished = true;
+	}
+};
+
+// In place of glfwCreateWindow; the window hints and glfwInit still come first
+inline GLFWwindow* CreateSceneWindow(int width, int height, const char* title)
+{
+	SceneRunner* runner = SceneRunner::GetActive();
+	if (runner != NULL)
+		return runner->BeginScene(title);
+	return glfwCreateWindow(width, height, title, NULL, NULL);
+}
+
+// In place of !glfwWindowShouldClose(window) as the loop condition, called once per frame
+inline bool SceneRunning(GLFWwindow* window)
+{
+	SceneRunner* runner = SceneRunner::GetActive();
+	if (runner != NULL)
+		return runner->NextFrame();
+	return !glfwWindowShouldClose(window);
+}
+
+// In place of glfwTerminate; the runner keeps the window for the next scene
+inline void ReleaseScene()
+{
+	if (SceneRunner::GetActive() == NULL)
+		glfwTerminate();
+}
+
+// The size the scene renders at, for the projection and render targets
+inline void GetSceneSize(GLFWwindow* window, int& width, int& height)
+{
+	SceneRunner* runner = SceneRunner::GetActive();
+	if (runner != NULL) {
+		width = runner->Settings.Width;
+		height = runner->Settings.Height;
+	}
+	else
+		glfwGetFramebufferSize(window, &width, &height);
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+}
+#endif
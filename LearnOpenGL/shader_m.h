@@ -9,6 +9,63 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <vector>
+
+// Binding points of named uniform blocks. Every Shader binds its blocks of these names to them,
+// whether the block is registered before or after the Shader is built, so a buffer bound once with
+// glBindBufferBase serves all programs. size, if not 0, is checked against the size the program
+// reports, which catches C++ structs that don't match their std140 block.
+struct UniformBlockBinding
+{
+    GLuint Binding;
+    GLint Size;
+};
+
+inline std::map<std::string, UniformBlockBinding>& getUniformBlockBindings()
+{
+    static std::map<std::string, UniformBlockBinding> bindings;
+    return bindings;
+}
+
+// Programs linked by Shader, for blocks registered after them
+inline std::vector<GLuint>& getLinkedPrograms()
+{
+    static std::vector<GLuint> programs;
+    return programs;
+}
+
+inline void bindUniformBlock(GLuint program, GLuint block, const std::string &name, const UniformBlockBinding &binding)
+{
+    GLint size = 0;
+    glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    if (binding.Size != 0 && size != binding.Size)
+        std::cout << "ERROR::SHADER::UNIFORM_BLOCK_SIZE_MISMATCH: " << name << " is " << size << " bytes, expected " << binding.Size << std::endl;
+    glUniformBlockBinding(program, block, binding.Binding);
+}
+
+// Also binds the block in every program linked so far that uses it. Programs deleted since are
+// dropped from the list.
+inline void RegisterUniformBlock(const std::string &name, GLuint binding, GLint size = 0)
+{
+    UniformBlockBinding entry = { binding, size };
+    getUniformBlockBindings()[name] = entry;
+
+    std::vector<GLuint>& programs = getLinkedPrograms();
+    for (size_t i = 0; i < programs.size(); )
+    {
+        if (!glIsProgram(programs[i]))
+        {
+            programs[i] = programs.back();
+            programs.pop_back();
+            continue;
+        }
+        GLuint block = glGetUniformBlockIndex(programs[i], name.c_str());
+        if (block != GL_INVALID_INDEX)
+            bindUniformBlock(programs[i], block, name, entry);
+        i++;
+    }
+}
 
 class Shader
 {
@@ -92,6 +149,7 @@ public:
             glAttachShader(ID, geometry);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        bindUniformBlocks();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -163,8 +221,35 @@ public:
     {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
+    // ------------------------------------------------------------------------
+    void setMat3x4(const std::string &name, const glm::mat3x4 &mat) const
+    {
+        glUniformMatrix3x4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    }
+    // ------------------------------------------------------------------------
+    bool hasUniformBlock(const std::string &name) const
+    {
+        return glGetUniformBlockIndex(ID, name.c_str()) != GL_INVALID_INDEX;
+    }
 
 private:
+    // binds the active uniform blocks that have a registered binding point; the others are bound
+    // when they get registered, see RegisterUniformBlock
+    // ------------------------------------------------------------------------
+    void bindUniformBlocks()
+    {
+        getLinkedPrograms().push_back(ID);
+        GLint blockCount = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+        for (GLint block = 0; block < blockCount; block++)
+        {
+            GLchar name[256];
+            glGetActiveUniformBlockName(ID, block, sizeof(name), NULL, name);
+            std::map<std::string, UniformBlockBinding>::const_iterator binding = getUniformBlockBindings().find(name);
+            if (binding != getUniformBlockBindings().end())
+                bindUniformBlock(ID, block, name, binding->second);
+        }
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,420 @@
+#pragma once
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <glm/glm.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "frustum.h"
+
+// Loose hashed uniform grid for objects that move every frame (the BVH in bvh.h is for static
+// ones). Each object lives in the one cell holding its center, so inserting, moving and removing
+// are O(1) amortized no matter how big the object is; queries make up for it by widening their
+// search by the largest radius seen so far ("loose" cells). Only cells that were ever touched
+// exist, looked up through an open addressing hash table, so the world has no fixed bounds.
+
+const unsigned int SPATIAL_GRID_INVALID = 0xFFFFFFFFu;
+
+struct SpatialGridStats
+{
+	unsigned int Objects;
+	unsigned int Cells;
+	unsigned int OccupiedCells;
+	size_t MemoryBytes;
+	// Accumulated by the queries until ResetQueryCounters
+	uint64_t Queries;
+	uint64_t CellsVisited;
+	uint64_t ObjectsTested;
+	uint64_t ObjectsReturned;
+};
+
+class SpatialGrid
+{
+public:
+	SpatialGrid(float cellSize = 4.0f) : cellSize(cellSize), inverseCellSize(1.0f / cellSize), maxRadius(0.0f), objectCount(0)
+	{
+		ResetQueryCounters();
+		table.assign(64, SPATIAL_GRID_INVALID);
+	}
+
+	// Adds an object and returns its id. Ids of removed objects get reused.
+	unsigned int Insert(glm::vec3 center, float radius)
+	{
+		unsigned int id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		}
+		else {
+			id = (unsigned int) objects.size();
+			objects.push_back(Object());
+		}
+
+		Object& object = objects[id];
+		object.Center = center;
+		object.Radius = radius;
+		maxRadius = glm::max(maxRadius, radius);
+		object.Key = cellOf(center);
+		addToCell(id, findOrAddCell(object.Key));
+		objectCount++;
+		return id;
+	}
+
+	void Move(unsigned int id, glm::vec3 center, float radius)
+	{
+		Object& object = objects[id];
+		object.Center = center;
+		object.Radius = radius;
+		maxRadius = glm::max(maxRadius, radius);
+
+		glm::ivec3 key = cellOf(center);
+		if (key != object.Key) {
+			removeFromCell(id);
+			object.Key = key;
+			addToCell(id, findOrAddCell(key));
+		}
+	}
+
+	void Remove(unsigned int id)
+	{
+		removeFromCell(id);
+		objects[id].Cell = SPATIAL_GRID_INVALID;
+		freeIds.push_back(id);
+		objectCount--;
+	}
+
+	glm::vec3 GetCenter(unsigned int id) const
+	{
+		return objects[id].Center;
+	}
+
+	float GetRadius(unsigned int id) const
+	{
+		return objects[id].Radius;
+	}
+
+	// Moves many objects at once. New cells are worked out on threadCount threads
+	// (0 = one per hardware thread) and objects staying in their cell are updated there too;
+	// only the objects that changed cells are relinked afterwards, on the calling thread.
+	void MoveBatch(const unsigned int* ids, const glm::vec3* centers, const float* radii, size_t count, unsigned int threadCount = 0)
+	{
+		if (threadCount == 0)
+			threadCount = std::thread::hardware_concurrency();
+		threadCount = (unsigned int) glm::clamp<size_t>(count / 1024, 1, glm::max(threadCount, 1u));
+
+		std::vector<std::vector<size_t> > changed(threadCount);
+		std::vector<float> largestRadius(threadCount, 0.0f);
+		auto worker = [&](unsigned int thread) {
+			size_t begin = count * thread / threadCount;
+			size_t end = count * (thread + 1) / threadCount;
+			for (size_t i = begin; i < end; i++) {
+				Object& object = objects[ids[i]];
+				largestRadius[thread] = glm::max(largestRadius[thread], radii[i]);
+				if (cellOf(centers[i]) == object.Key) {
+					object.Center = centers[i];
+					object.Radius = radii[i];
+				}
+				else {
+					changed[thread].push_back(i);
+				}
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(worker, i));
+		worker(0);
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+
+		for (unsigned int thread = 0; thread < threadCount; thread++) {
+			maxRadius = glm::max(maxRadius, largestRadius[thread]);
+			for (size_t k = 0; k < changed[thread].size(); k++) {
+				size_t i = changed[thread][k];
+				Move(ids[i], centers[i], radii[i]);
+			}
+		}
+	}
+
+	// Appends the ids of the objects whose sphere intersects the given sphere
+	void QuerySphere(glm::vec3 center, float radius, std::vector<unsigned int>& result)
+	{
+		queries++;
+		float reach = radius + maxRadius;
+		glm::ivec3 low = cellOf(center - glm::vec3(reach));
+		glm::ivec3 high = cellOf(center + glm::vec3(reach));
+
+		// Walk the covered cells if there are fewer of them than existing cells
+		double covered = (double)(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+		if (covered <= (double) cells.size()) {
+			for (int x = low.x; x <= high.x; x++) {
+				for (int y = low.y; y <= high.y; y++) {
+					for (int z = low.z; z <= high.z; z++) {
+						unsigned int cell = findCell(glm::ivec3(x, y, z));
+						if (cell != SPATIAL_GRID_INVALID)
+							querySphereCell(cells[cell], center, radius, result);
+					}
+				}
+			}
+		}
+		else {
+			for (size_t cell = 0; cell < cells.size(); cell++) {
+				const glm::ivec3& key = cells[cell].Key;
+				if (key.x >= low.x && key.x <= high.x && key.y >= low.y && key.y <= high.y && key.z >= low.z && key.z <= high.z)
+					querySphereCell(cells[cell], center, radius, result);
+			}
+		}
+	}
+
+	// Appends the ids of the objects whose sphere intersects the frustum
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& result)
+	{
+		queries++;
+
+		// Walk the cells around the frustum corners if there are fewer of them than existing
+		// cells, otherwise (and for infinite frustums) test every existing cell
+		glm::vec3 frustumMin, frustumMax;
+		if (frustumBounds(frustum, frustumMin, frustumMax)) {
+			glm::ivec3 low = cellOf(frustumMin - glm::vec3(maxRadius));
+			glm::ivec3 high = cellOf(frustumMax + glm::vec3(maxRadius));
+			double covered = (double)(high.x - low.x + 1) * (high.y - low.y + 1) * (high.z - low.z + 1);
+			if (covered <= (double) cells.size()) {
+				for (int x = low.x; x <= high.x; x++) {
+					for (int y = low.y; y <= high.y; y++) {
+						for (int z = low.z; z <= high.z; z++) {
+							// Reject cells by their key before touching any cell memory
+							glm::ivec3 key(x, y, z);
+							if (!IsBoxInFrustum(frustum, looseCellMin(key), looseCellMax(key)))
+								continue;
+							unsigned int cell = findCell(key);
+							if (cell != SPATIAL_GRID_INVALID)
+								queryFrustumObjects(cells[cell], frustum, result);
+						}
+					}
+				}
+				return;
+			}
+		}
+
+		for (size_t c = 0; c < cells.size(); c++)
+			if (!cells[c].Objects.empty() && IsBoxInFrustum(frustum, looseCellMin(cells[c].Key), looseCellMax(cells[c].Key)))
+				queryFrustumObjects(cells[c], frustum, result);
+	}
+
+	// Drops cells that became empty and rebuilds the hash table, e.g. after objects left a region
+	void ReleaseEmptyCells()
+	{
+		std::vector<Cell> kept;
+		for (size_t c = 0; c < cells.size(); c++)
+			if (!cells[c].Objects.empty())
+				kept.push_back(cells[c]);
+		cells.swap(kept);
+
+		size_t tableSize = 64;
+		while (tableSize < cells.size() * 2)
+			tableSize *= 2;
+		table.assign(tableSize, SPATIAL_GRID_INVALID);
+		for (unsigned int c = 0; c < cells.size(); c++) {
+			insertIntoTable(c);
+			for (size_t k = 0; k < cells[c].Objects.size(); k++)
+				objects[cells[c].Objects[k]].Cell = c;
+		}
+	}
+
+	SpatialGridStats GetStats() const
+	{
+		SpatialGridStats stats;
+		stats.Objects = objectCount;
+		stats.Cells = (unsigned int) cells.size();
+		stats.OccupiedCells = 0;
+		stats.MemoryBytes = sizeof(*this) + objects.capacity() * sizeof(Object) + freeIds.capacity() * sizeof(unsigned int) + table.capacity() * sizeof(unsigned int) + cells.capacity() * sizeof(Cell);
+		for (size_t c = 0; c < cells.size(); c++) {
+			stats.OccupiedCells += cells[c].Objects.empty() ? 0 : 1;
+			stats.MemoryBytes += cells[c].Objects.capacity() * sizeof(unsigned int);
+		}
+		stats.Queries = queries;
+		stats.CellsVisited = cellsVisited;
+		stats.ObjectsTested = objectsTested;
+		stats.ObjectsReturned = objectsReturned;
+		return stats;
+	}
+
+	void ResetQueryCounters()
+	{
+		queries = cellsVisited = objectsTested = objectsReturned = 0;
+	}
+
+private:
+	struct Object
+	{
+		glm::vec3 Center;
+		float Radius;
+		// Copy of the cell's key, so checking whether an object changed cells stays local
+		glm::ivec3 Key;
+		unsigned int Cell;
+		// Position in the cell's object list
+		unsigned int Slot;
+	};
+
+	struct Cell
+	{
+		glm::ivec3 Key;
+		std::vector<unsigned int> Objects;
+	};
+
+	float cellSize;
+	float inverseCellSize;
+	float maxRadius;
+	unsigned int objectCount;
+	std::vector<Object> objects;
+	std::vector<unsigned int> freeIds;
+	std::vector<Cell> cells;
+	// Open addressing (linear probing) from cell key to index in cells
+	std::vector<unsigned int> table;
+
+	uint64_t queries;
+	uint64_t cellsVisited;
+	uint64_t objectsTested;
+	uint64_t objectsReturned;
+
+	glm::ivec3 cellOf(glm::vec3 position) const
+	{
+		return glm::ivec3(glm::floor(position * inverseCellSize));
+	}
+
+	static size_t hashKey(glm::ivec3 key)
+	{
+		uint64_t hash = (uint64_t)(uint32_t) key.x * 0x9E3779B97F4A7C15ull;
+		hash ^= (uint64_t)(uint32_t) key.y * 0xC2B2AE3D27D4EB4Full;
+		hash ^= (uint64_t)(uint32_t) key.z * 0x165667B19E3779F9ull;
+		return (size_t)(hash ^ (hash >> 29));
+	}
+
+	unsigned int findCell(glm::ivec3 key) const
+	{
+		size_t mask = table.size() - 1;
+		for (size_t slot = hashKey(key) & mask;; slot = (slot + 1) & mask) {
+			unsigned int cell = table[slot];
+			if (cell == SPATIAL_GRID_INVALID || cells[cell].Key == key)
+				return cell;
+		}
+	}
+
+	void insertIntoTable(unsigned int cell)
+	{
+		size_t mask = table.size() - 1;
+		size_t slot = hashKey(cells[cell].Key) & mask;
+		while (table[slot] != SPATIAL_GRID_INVALID)
+			slot = (slot + 1) & mask;
+		table[slot] = cell;
+	}
+
+	unsigned int findOrAddCell(glm::ivec3 key)
+	{
+		unsigned int cell = findCell(key);
+		if (cell != SPATIAL_GRID_INVALID)
+			return cell;
+
+		cell = (unsigned int) cells.size();
+		cells.push_back(Cell());
+		cells.back().Key = key;
+
+		// Keep the table at most half full
+		if (cells.size() * 2 > table.size()) {
+			table.assign(table.size() * 2, SPATIAL_GRID_INVALID);
+			for (unsigned int c = 0; c < cells.size(); c++)
+				insertIntoTable(c);
+		}
+		else {
+			insertIntoTable(cell);
+		}
+		return cell;
+	}
+
+	void addToCell(unsigned int id, unsigned int cell)
+	{
+		objects[id].Cell = cell;
+		objects[id].Slot = (unsigned int) cells[cell].Objects.size();
+		cells[cell].Objects.push_back(id);
+	}
+
+	// Swap-removes the object from its cell's list
+	void removeFromCell(unsigned int id)
+	{
+		std::vector<unsigned int>& list = cells[objects[id].Cell].Objects;
+		unsigned int slot = objects[id].Slot;
+		list[slot] = list.back();
+		objects[list[slot]].Slot = slot;
+		list.pop_back();
+	}
+
+	// Corners of the frustum from the intersections of three planes each. Returns false when
+	// the frustum has no far plane.
+	static bool frustumBounds(const Frustum& frustum, glm::vec3& boundsMin, glm::vec3& boundsMax)
+	{
+		const glm::vec4& far = frustum.Planes[FRUSTUM_FAR];
+		if (far.x == 0.0f && far.y == 0.0f && far.z == 0.0f)
+			return false;
+
+		boundsMin = glm::vec3(FLT_MAX);
+		boundsMax = glm::vec3(-FLT_MAX);
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec4 a = frustum.Planes[corner & 1 ? FRUSTUM_RIGHT : FRUSTUM_LEFT];
+			glm::vec4 b = frustum.Planes[corner & 2 ? FRUSTUM_TOP : FRUSTUM_BOTTOM];
+			glm::vec4 c = frustum.Planes[corner & 4 ? FRUSTUM_FAR : FRUSTUM_NEAR];
+			glm::vec3 bc = glm::cross(glm::vec3(b), glm::vec3(c));
+			float denominator = glm::dot(glm::vec3(a), bc);
+			if (glm::abs(denominator) < 1e-12f)
+				return false;
+			glm::vec3 p = -(a.w * bc + b.w * glm::cross(glm::vec3(c), glm::vec3(a)) + c.w * glm::cross(glm::vec3(a), glm::vec3(b))) / denominator;
+			boundsMin = glm::min(boundsMin, p);
+			boundsMax = glm::max(boundsMax, p);
+		}
+		return true;
+	}
+
+	// The loose cell: everything centered in the cell fits in it grown by maxRadius
+	glm::vec3 looseCellMin(glm::ivec3 key) const
+	{
+		return glm::vec3(key) * cellSize - glm::vec3(maxRadius);
+	}
+
+	glm::vec3 looseCellMax(glm::ivec3 key) const
+	{
+		return glm::vec3(key + glm::ivec3(1)) * cellSize + glm::vec3(maxRadius);
+	}
+
+	void queryFrustumObjects(const Cell& cell, const Frustum& frustum, std::vector<unsigned int>& result)
+	{
+		cellsVisited++;
+		for (size_t k = 0; k < cell.Objects.size(); k++) {
+			unsigned int id = cell.Objects[k];
+			objectsTested++;
+			if (IsSphereInFrustum(frustum, objects[id].Center, objects[id].Radius)) {
+				result.push_back(id);
+				objectsReturned++;
+			}
+		}
+	}
+
+	void querySphereCell(const Cell& cell, glm::vec3 center, float radius, std::vector<unsigned int>& result)
+	{
+		cellsVisited++;
+		for (size_t k = 0; k < cell.Objects.size(); k++) {
+			unsigned int id = cell.Objects[k];
+			objectsTested++;
+			glm::vec3 d = objects[id].Center - center;
+			float reach = objects[id].Radius + radius;
+			if (glm::dot(d, d) <= reach * reach) {
+				result.push_back(id);
+				objectsReturned++;
+			}
+		}
+	}
+};
+#endif
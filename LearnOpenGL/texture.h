@@ -0,0 +1,98 @@
+#pragma once
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <vector>
+
+#include "job_system.h"
+#include "stb_image.h"
+
+// Image decoded to 8 bit channels, ready for glTexImage2D
+struct DecodedImage
+{
+	unsigned char* Data;
+	int Width;
+	int Height;
+	int Channels;
+};
+
+// Reads and decodes an image file; doesn't touch GL, so it can run on any thread. Images come
+// out flipped on the y-axis if stbi_set_flip_vertically_on_load was set beforehand; that flag is
+// global to stb_image, so it is set on the main thread before decoding starts, as LoadTexture and
+// LoadTextures do. Returns false if the image couldn't be read.
+inline bool DecodeImage(const char* path, DecodedImage& image)
+{
+	image.Data = stbi_load(path, &image.Width, &image.Height, &image.Channels, 0);
+	if (!image.Data) {
+		std::cout << "Failed to load texture: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Creates a mipmapped GL_REPEAT / GL_LINEAR texture from a decoded image and frees the image
+inline unsigned int UploadTexture(DecodedImage& image)
+{
+	GLenum format = image.Channels == 4 ? GL_RGBA : (image.Channels == 1 ? GL_RED : GL_RGB);
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	// Set the texture wrapping / filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Rows of RGB images aren't necessarily 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.Width, image.Height, 0, format, GL_UNSIGNED_BYTE, image.Data);
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	stbi_image_free(image.Data);
+	image.Data = NULL;
+	return texture;
+}
+
+// Loads an image from disk into a new mipmapped GL_REPEAT / GL_LINEAR texture.
+// Returns 0 if the image couldn't be read.
+inline unsigned int LoadTexture(const char* path)
+{
+	// Tell stb_image.h to flip loaded texture's on the y-axis.
+	stbi_set_flip_vertically_on_load(true);
+
+	DecodedImage image;
+	if (!DecodeImage(path, image))
+		return 0;
+	return UploadTexture(image);
+}
+
+// Loads several textures at once. The files are decoded in parallel on the job system and each
+// one is uploaded by a main thread job as soon as it is decoded, so uploads overlap the decoding
+// of the rest. Must be called on the main thread; textures[i] is 0 for images that failed.
+inline void LoadTextures(const char* const* paths, unsigned int count, unsigned int* textures, JobSystem& jobs = GetJobSystem())
+{
+	// Before any decode job runs, the flag isn't safe to change while they do
+	stbi_set_flip_vertically_on_load(true);
+
+	std::vector<DecodedImage> images(count);
+	Job* root = jobs.Create([]() {});
+	for (unsigned int i = 0; i < count; i++) {
+		textures[i] = 0;
+		DecodedImage* image = &images[i];
+		const char* path = paths[i];
+		unsigned int* texture = &textures[i];
+		Job* decode = jobs.Create([&jobs, image, path, texture, root]() {
+			if (DecodeImage(path, *image))
+				jobs.Run(jobs.CreateMainThread([image, texture]() { *texture = UploadTexture(*image); }, root));
+		}, root);
+		jobs.Run(decode);
+	}
+	jobs.Run(root);
+	jobs.Wait(root);
+}
+#endif
@@ -0,0 +1,175 @@
+#pragma once
+#ifndef VERTEX_QUANTIZATION_H
+#define VERTEX_QUANTIZATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "mesh.h"
+
+// Compressed vertex layouts built with the glm packing helpers.
+//
+//   position  4 x unorm16 relative to the mesh bounds, or 4 x half float    8 bytes
+//   texcoord  2 x unorm16 (2 x half float if the UVs leave [0, 1])           4 bytes
+//   normal    octahedral 2 x snorm8, padded                                 4 bytes
+//   color     4 x unorm8                                                    4 bytes
+//
+// A position / texcoord / normal vertex shrinks from 32 to 16 bytes. The attributes keep
+// their locations and are declared normalized where needed, so the shader receives floats;
+// it only has to rebuild the position from the bounds and decode the octahedral normal
+// (see quantized_mesh_shader.vs).
+
+enum Position_Encoding {
+	POSITION_UNORM16,
+	POSITION_HALF
+};
+
+// Maps a unit vector onto the [-1, 1] square of an octahedron unfolded around +z
+inline glm::vec2 OctahedralEncode(glm::vec3 n)
+{
+	n /= (glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z));
+	glm::vec2 p(n.x, n.y);
+	if (n.z < 0.0f) {
+		p.x = (1.0f - glm::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+		p.y = (1.0f - glm::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return p;
+}
+
+// Inverse of OctahedralEncode, identical to octDecode in quantized_mesh_shader.vs
+inline glm::vec3 OctahedralDecode(glm::vec2 p)
+{
+	glm::vec3 n(p.x, p.y, 1.0f - glm::abs(p.x) - glm::abs(p.y));
+	float t = glm::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return glm::normalize(n);
+}
+
+// Offset / scale that turn the position attribute back into object space:
+// position = offset + attribute * scale
+inline void GetPositionDequantization(glm::vec3 boundsMin, glm::vec3 boundsMax, bool normalizedToBounds, glm::vec3& offset, glm::vec3& scale)
+{
+	if (normalizedToBounds) {
+		offset = boundsMin;
+		scale = boundsMax - boundsMin;
+	}
+	else {
+		offset = glm::vec3(0.0f);
+		scale = glm::vec3(1.0f);
+	}
+}
+
+inline void GetPositionDequantization(const MeshData& mesh, glm::vec3& offset, glm::vec3& scale)
+{
+	GetPositionDequantization(mesh.BoundsMin, mesh.BoundsMax, mesh.PositionsNormalizedToBounds, offset, scale);
+}
+
+// Converts a float mesh (position / texcoord / normal / color at the ATTRIBUTE_* locations)
+// to the compressed layout. Attributes the source doesn't have are left out.
+inline MeshData QuantizeMesh(const MeshData& source, Position_Encoding positionEncoding = POSITION_UNORM16)
+{
+	const MeshAttribute* position = source.FindAttribute(ATTRIBUTE_POSITION);
+	const MeshAttribute* texCoord = source.FindAttribute(ATTRIBUTE_TEXCOORD);
+	const MeshAttribute* normal = source.FindAttribute(ATTRIBUTE_NORMAL);
+	const MeshAttribute* color = source.FindAttribute(ATTRIBUTE_COLOR);
+	if (texCoord != nullptr && (texCoord->Type != GL_FLOAT || texCoord->Size != 2))
+		texCoord = nullptr;
+	if (normal != nullptr && (normal->Type != GL_FLOAT || normal->Size != 3))
+		normal = nullptr;
+	if (color != nullptr && (color->Type != GL_FLOAT || color->Size < 3))
+		color = nullptr;
+
+	MeshData mesh;
+	mesh.Indices = source.Indices;
+	mesh.VertexCount = source.VertexCount;
+	mesh.BoundsMin = source.BoundsMin;
+	mesh.BoundsMax = source.BoundsMax;
+	if (position == nullptr || position->Type != GL_FLOAT || position->Size != 3)
+		return mesh;
+
+	// UVs that tile outside [0, 1] can't be stored as unorm
+	bool texCoordUnorm = true;
+	if (texCoord != nullptr) {
+		for (unsigned int i = 0; i < source.VertexCount && texCoordUnorm; i++) {
+			glm::vec2 t;
+			memcpy(&t[0], &source.Vertices[i * source.VertexStride + texCoord->Offset], sizeof(t));
+			texCoordUnorm = t.x >= 0.0f && t.x <= 1.0f && t.y >= 0.0f && t.y <= 1.0f;
+		}
+	}
+
+	// Build the layout
+	GLuint offset = 0;
+	MeshAttribute positionAttribute = { ATTRIBUTE_POSITION, 4, positionEncoding == POSITION_UNORM16 ? (GLenum) GL_UNSIGNED_SHORT : (GLenum) GL_HALF_FLOAT, positionEncoding == POSITION_UNORM16 ? (GLboolean) GL_TRUE : (GLboolean) GL_FALSE, offset };
+	mesh.Attributes.push_back(positionAttribute);
+	offset += 8;
+	GLuint texCoordOffset = offset;
+	if (texCoord != nullptr) {
+		MeshAttribute attribute = { ATTRIBUTE_TEXCOORD, 2, texCoordUnorm ? (GLenum) GL_UNSIGNED_SHORT : (GLenum) GL_HALF_FLOAT, texCoordUnorm ? (GLboolean) GL_TRUE : (GLboolean) GL_FALSE, offset };
+		mesh.Attributes.push_back(attribute);
+		offset += 4;
+	}
+	GLuint normalOffset = offset;
+	if (normal != nullptr) {
+		MeshAttribute attribute = { ATTRIBUTE_NORMAL, 2, GL_BYTE, GL_TRUE, offset };
+		mesh.Attributes.push_back(attribute);
+		offset += 4;
+	}
+	GLuint colorOffset = offset;
+	if (color != nullptr) {
+		MeshAttribute attribute = { ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, offset };
+		mesh.Attributes.push_back(attribute);
+		offset += 4;
+	}
+	mesh.VertexStride = offset;
+	mesh.PositionsNormalizedToBounds = positionEncoding == POSITION_UNORM16;
+	mesh.Vertices.assign((size_t) mesh.VertexCount * mesh.VertexStride, 0);
+
+	glm::vec3 extent = source.BoundsMax - source.BoundsMin;
+	glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	for (unsigned int i = 0; i < source.VertexCount; i++) {
+		const unsigned char* in = &source.Vertices[i * source.VertexStride];
+		unsigned char* out = &mesh.Vertices[i * mesh.VertexStride];
+
+		glm::vec3 p;
+		memcpy(&p[0], in + position->Offset, sizeof(p));
+		uint64_t packedPosition;
+		if (positionEncoding == POSITION_UNORM16)
+			packedPosition = glm::packUnorm4x16(glm::vec4((p - source.BoundsMin) * inverseExtent, 1.0f));
+		else
+			packedPosition = glm::packHalf4x16(glm::vec4(p, 1.0f));
+		memcpy(out, &packedPosition, sizeof(packedPosition));
+
+		if (texCoord != nullptr) {
+			glm::vec2 t;
+			memcpy(&t[0], in + texCoord->Offset, sizeof(t));
+			uint32_t packedTexCoord = texCoordUnorm ? glm::packUnorm2x16(t) : glm::packHalf2x16(t);
+			memcpy(out + texCoordOffset, &packedTexCoord, sizeof(packedTexCoord));
+		}
+
+		if (normal != nullptr) {
+			glm::vec3 n;
+			memcpy(&n[0], in + normal->Offset, sizeof(n));
+			uint16_t packedNormal = 0;
+			if (n.x != 0.0f || n.y != 0.0f || n.z != 0.0f)
+				packedNormal = glm::packSnorm2x8(OctahedralEncode(n));
+			memcpy(out + normalOffset, &packedNormal, sizeof(packedNormal));
+		}
+
+		if (color != nullptr) {
+			glm::vec4 c(1.0f);
+			memcpy(&c[0], in + color->Offset, color->Size * sizeof(float));
+			uint32_t packedColor = glm::packUnorm4x8(c);
+			memcpy(out + colorOffset, &packedColor, sizeof(packedColor));
+		}
+	}
+
+	return mesh;
+}
+#endif